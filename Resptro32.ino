@@ -9,179 +9,164 @@
 #include "snake_game.h"
 #include "live_pixel.h"
 #include "wifi_config.h"
+#include "display_tft.h"
+#include "telemetry.h"
+#include "input.h"
+#include "menu_icons.h"
 
 TFT_eSPI tft;
-TFT_eSprite menuSprite = TFT_eSprite(&tft);
+TftDisplay tft_display(tft);
+TFT_eSprite menu_strip = TFT_eSprite(&tft);
 volatile GameState current_state = STATE_MENU;
 int menu_selection = 0;
 const char *game_names[MENU_ITEMS] = {"Snake", "Pong", "Live Pixel", "Wifi Config"};
 volatile bool menu_requested = false;
 volatile bool exit_requested = false;
+QueueHandle_t menu_input;
 
 #define ANIM_STEPS 24
 #define ANIM_DELAY 1
-bool animating = false;
 
-const unsigned char snake_icon[32] = {
-	0xc0, 0x03, 0x80, 0x01, 0x00, 0xfc, 0x01, 0xfe, 0x01, 0xb6, 0x01, 0xb6, 0x01, 0xfc, 0x0c, 0xe2, 
-	0x1e, 0xf0, 0x1f, 0x78, 0x4f, 0xbc, 0x7f, 0xfc, 0x7d, 0xfc, 0x38, 0xf8, 0x80, 0x01, 0xc0, 0x03
-};
-
-const unsigned char pong_icon[32] = {
-	0xc0, 0x03, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00, 
-	0x10, 0x48, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00, 0x80, 0x01, 0xc0, 0x03
-};
-
-const unsigned char pixel_icon[32] = {
-	0xc0, 0x03, 0x9f, 0xf9, 0x20, 0x04, 0x40, 0x02, 0x40, 0x02, 0x44, 0x22, 0x44, 0x22, 0x44, 0x22, 
-	0x44, 0x22, 0x40, 0x02, 0x40, 0x02, 0x60, 0x06, 0x7f, 0xfe, 0x3f, 0xfc, 0x9f, 0xf9, 0xc0, 0x03
-};
-
-const unsigned char wifi_icon[32] = {
-	0xc0, 0x03, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0xe0, 0x08, 0x10, 0x13, 0xc8, 
-	0x04, 0x20, 0x01, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0xc0, 0x03
-};
-
-const unsigned char* game_icons[MENU_ITEMS] = {
-    snake_icon, pong_icon, pixel_icon, wifi_icon
-};
+// Every menu item side by side in one 8-bit sprite, item 0 repeated at the
+// end so wrapping around is a plain scroll too. Built when the menu is shown;
+// a transition step only moves the source window.
+#define MENU_STRIP_Y 40
+#define MENU_STRIP_HEIGHT 80
+#define MENU_STRIP_FRAMES (MENU_ITEMS + 1)
 
 void draw_centered_text(const char *text, int y, uint16_t color, int size) {
-    tft.setTextSize(size);
-    tft.setCursor((SCREEN_WIDTH - strlen(text) * 6 * size) / 2, y);
-    tft.setTextColor(color, TFT_BLACK);
-    tft.print(text);
+    render_text((SCREEN_WIDTH - strlen(text) * 6 * size) / 2, y, text, color, TFT_BLACK, size);
 }
 
-void draw_icon_to_sprite(int x, int y, const unsigned char* icon, TFT_eSprite &sprite) {
-    // upscale 4x from 16x16
-    for (int i = 0; i < 16; i++) {
-        for (int j = 0; j < 16; j++) {
-            uint8_t bit = icon[(i * 2) + (j / 8)] & (0x80 >> (j % 8));
-            if (bit) {
-                for (int sy = 0; sy < 4; sy++) {
-                    for (int sx = 0; sx < 4; sx++) {
-                         sprite.drawPixel(x + j * 4 + sx, y + i * 4 + sy, TFT_WHITE);
-                    }
-                }
-            }
-        }
-    }
-}
+void draw_menu_item_to_sprite(int item_index, int x, TFT_eSprite &sprite) {
+    int center_x = x + SCREEN_WIDTH / 2;
 
-void draw_menu_item_to_sprite(int item_index, int x_offset, TFT_eSprite &sprite) {
-    int center_x = SCREEN_WIDTH / 2 + x_offset;
-    
-    draw_icon_to_sprite(center_x - 32, 10, game_icons[item_index], sprite);
+    sprite.drawBitmap(center_x - MENU_ICON_SCALED / 2, 0, menu_icons[item_index].bits,
+                      MENU_ICON_SCALED, MENU_ICON_SCALED, TFT_WHITE);
 
     sprite.setTextSize(1);
     sprite.setTextColor(TFT_WHITE);
     int text_x = center_x - (strlen(game_names[item_index]) * 6) / 2;
-    sprite.setCursor(text_x, 80);
+    sprite.setCursor(text_x, 70);
     sprite.print(game_names[item_index]);
 }
 
+bool build_menu_strip() {
+    if (menu_strip.created()) return true;
+
+    menu_strip.setColorDepth(8);
+    if (!menu_strip.createSprite(SCREEN_WIDTH * MENU_STRIP_FRAMES, MENU_STRIP_HEIGHT)) {
+        return false;
+    }
+    menu_strip.fillSprite(TFT_BLACK);
+    for (int frame = 0; frame < MENU_STRIP_FRAMES; frame++) {
+        draw_menu_item_to_sprite(frame % MENU_ITEMS, frame * SCREEN_WIDTH, menu_strip);
+    }
+    return true;
+}
+
+// Frees the strip for the app being launched
+void release_menu_strip() {
+    render_sync();  // The render task may still be reading it
+    menu_strip.deleteSprite();
+}
+
+void draw_menu_frame(int sx) {
+    if (menu_strip.created()) {
+        render_sprite(&menu_strip, 0, MENU_STRIP_Y, sx, 0, SCREEN_WIDTH, MENU_STRIP_HEIGHT);
+    } else {
+        // Not enough memory for the strip: just the name
+        render_rect(0, MENU_STRIP_Y, SCREEN_WIDTH, MENU_STRIP_HEIGHT, TFT_BLACK);
+        draw_centered_text(game_names[(sx / SCREEN_WIDTH) % MENU_ITEMS], MENU_STRIP_Y + 70, TFT_WHITE, 1);
+    }
+}
+
 void show_wifi_info() {
     if (wifi_is_connected()) {
-        String ipText = "WiFi: " + get_wifi_ip();
-        draw_centered_text(ipText.c_str(), 140, TFT_GREEN, 1);
+        Text<TEXT_LINE_MAX> line;
+        text_printf(&line, "WiFi: %s", get_wifi_ip());
+        draw_centered_text(line.c_str(), 140, TFT_GREEN, 1);
     } else {
         draw_centered_text("WiFi: Not Connected", 140, TFT_RED, 1);
     }
 }
 
 void show_menu() {
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
     draw_centered_text("Game Selection", 10, TFT_WHITE, 1);
     
-    menuSprite.createSprite(SCREEN_WIDTH, 100);
-    menuSprite.fillSprite(TFT_BLACK);
-    
-    draw_menu_item_to_sprite(menu_selection, 0, menuSprite);
-    
-    menuSprite.pushSprite(0, 30);
-    menuSprite.deleteSprite();
+    build_menu_strip();
+    draw_menu_frame(menu_selection * SCREEN_WIDTH);
     show_wifi_info();
 }
 
 void animate_menu_transition(int old_selection, int new_selection) {
-    animating = true;
-    
-    int direction = (new_selection > old_selection) ? -1 : 1;
-    if ((old_selection == 0 && new_selection == MENU_ITEMS - 1) || 
-        (old_selection == MENU_ITEMS - 1 && new_selection == 0)) {
-        direction = -direction;
+    int from = old_selection * SCREEN_WIDTH;
+    int to = new_selection * SCREEN_WIDTH;
+    // Wrapping around goes through the copy of item 0 at the end
+    if (old_selection == 0 && new_selection == MENU_ITEMS - 1) {
+        from = MENU_ITEMS * SCREEN_WIDTH;
+    } else if (old_selection == MENU_ITEMS - 1 && new_selection == 0) {
+        to = MENU_ITEMS * SCREEN_WIDTH;
     }
 
-    menuSprite.createSprite(SCREEN_WIDTH * 2, 100);
-
     for (int step = 1; step <= ANIM_STEPS; step++) {
-        menuSprite.fillSprite(TFT_BLACK);
-
-        int offset_old = SCREEN_WIDTH/2 + direction * (SCREEN_WIDTH * step / ANIM_STEPS);
-        int offset_new = offset_old - (direction * SCREEN_WIDTH);
+        draw_menu_frame(from + (to - from) * step / ANIM_STEPS);
+        render_sync();
 
-        draw_menu_item_to_sprite(old_selection, offset_old, menuSprite);
-        draw_menu_item_to_sprite(new_selection, offset_new, menuSprite);
-
-        menuSprite.fillSprite(TFT_BLACK);
-        draw_menu_item_to_sprite(old_selection, offset_old, menuSprite);
-        draw_menu_item_to_sprite(new_selection, offset_new, menuSprite);
-        
-        
-        menuSprite.pushSprite(0, 30, SCREEN_WIDTH/2, 0, SCREEN_WIDTH, 100);
-        
         delay(ANIM_DELAY);
     }
-    
-    menuSprite.deleteSprite();
-    animating = false;
-}
-
-void IRAM_ATTR menu_button_ISR() {
-    if (current_state != STATE_MENU) {
-        menu_requested = true;
-        exit_requested = true;
-    }
 }
 
+// A leaves any app; the rest only drive the menu
 void handle_input(void *pv) {
+    InputEvent event;
+
     while (1) {
-        if (current_state == STATE_MENU) {
-            if (!digitalRead(BTN_LEFT) && !animating) {
-                int old_selection = menu_selection;
-                menu_selection = (menu_selection - 1 + MENU_ITEMS) % MENU_ITEMS;
-                animate_menu_transition(old_selection, menu_selection);
-                vTaskDelay(pdMS_TO_TICKS(200));
-            }
-            if (!digitalRead(BTN_RIGHT) && !animating) {
-                int old_selection = menu_selection;
-                menu_selection = (menu_selection + 1) % MENU_ITEMS;
-                animate_menu_transition(old_selection, menu_selection);
-                vTaskDelay(pdMS_TO_TICKS(200));
+        xQueueReceive(menu_input, &event, portMAX_DELAY);
+
+        if (event.button == INPUT_A) {
+            if (event.type == INPUT_PRESS && current_state != STATE_MENU) {
+                TRACE_INSTANT(TRACE_MENU_BUTTON, 0);
+                menu_requested = true;
+                exit_requested = true;
             }
-            if (!digitalRead(BTN_B) && !animating) {
-                switch (menu_selection) {
-                    case 0:
-                        current_state = STATE_SNAKE;
-                        snake_launch_tasks();
-                        break;
-                    case 1:
-                        current_state = STATE_PONG;
-                        pong_launch_tasks();
-                        break;
-                    case 2:
-                        current_state = STATE_LIVE_PIXEL;
-                        live_pixel_launch_tasks();
-                        break;
-                    case 3:
-                        current_state = STATE_WIFI_CONFIG;
-                        wifi_config_launch();
-                        break;
-                }
+            continue;
+        }
+        if (current_state != STATE_MENU || event.type == INPUT_RELEASE) {
+            continue;
+        }
+
+        if (event.button == INPUT_LEFT || event.button == INPUT_RIGHT) {
+            int old_selection = menu_selection;
+            int step = event.button == INPUT_LEFT ? -1 : 1;
+            menu_selection = (menu_selection + step + MENU_ITEMS) % MENU_ITEMS;
+            animate_menu_transition(old_selection, menu_selection);
+
+            // Presses queued up during the animation are dropped, holding keeps scrolling
+            input_flush(menu_input);
+        }
+        if (event.button == INPUT_B && event.type == INPUT_PRESS) {
+            release_menu_strip();
+            switch (menu_selection) {
+                case 0:
+                    current_state = STATE_SNAKE;
+                    snake_launch_tasks();
+                    break;
+                case 1:
+                    current_state = STATE_PONG;
+                    pong_launch_tasks();
+                    break;
+                case 2:
+                    current_state = STATE_LIVE_PIXEL;
+                    live_pixel_launch_tasks();
+                    break;
+                case 3:
+                    current_state = STATE_WIFI_CONFIG;
+                    wifi_config_launch();
+                    break;
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
@@ -197,27 +182,57 @@ void try_connect_wifi() {
 }
 
 void setup() {
+    Serial.begin(115200);
     try_connect_wifi();
     tft.init();
-    tft.fillScreen(TFT_BLACK);
+    tft.initDMA();
+    renderer_init(&tft_display);
+    render_clear(TFT_BLACK);
     
-    pinMode(BTN_UP, INPUT_PULLUP);
-    pinMode(BTN_LEFT, INPUT_PULLUP);
-    pinMode(BTN_DOWN, INPUT_PULLUP);
-    pinMode(BTN_RIGHT, INPUT_PULLUP);
-    pinMode(BTN_A, INPUT_PULLUP);
-    pinMode(BTN_B, INPUT_PULLUP);
-
-    attachInterrupt(digitalPinToInterrupt(BTN_A), menu_button_ISR, FALLING);
+    input_init();
+    menu_input = input_subscribe(INPUT_ANY_STATE, INPUT_MASK(INPUT_A) | INPUT_MASK(INPUT_LEFT) |
+                                                  INPUT_MASK(INPUT_RIGHT) | INPUT_MASK(INPUT_B));
 
     snake_init_mutex();
     pong_init_mutex();
     live_pixel_init_queue();
+    telemetry_init();
 
     show_menu();
     xTaskCreate(handle_input, "MainInput", 4096, NULL, 1, NULL);
 }
 
+// Single character commands over Serial:
+//   T  dump the trace (RESPTRO_TRACE builds)
+//   s  telemetry lines over Serial on/off
+//   w  telemetry to the Live Pixel server on/off
+//   o  telemetry overlay on/off
+//   r  switch Pong between sprite and direct rendering
+void handle_serial_commands() {
+    while (Serial.available() > 0) {
+        switch (Serial.read()) {
+            case 'T':
+                trace_dump();
+                break;
+            case 's':
+                telemetry_set_serial(!telemetry_serial_enabled());
+                Serial.printf("Telemetry over Serial %s\n", telemetry_serial_enabled() ? "on" : "off");
+                break;
+            case 'w':
+                telemetry_set_websocket(!telemetry_websocket_enabled());
+                Serial.printf("Telemetry to server %s\n", telemetry_websocket_enabled() ? "on" : "off");
+                break;
+            case 'o':
+                telemetry_toggle_overlay();
+                break;
+            case 'r':
+                Serial.printf("Pong rendering %s\n",
+                              pong_toggle_render_mode() == PONG_RENDER_SPRITE ? "sprite" : "direct");
+                break;
+        }
+    }
+}
+
 void loop() {
     if (exit_requested) {
         if (current_state == STATE_SNAKE) {
@@ -238,5 +253,6 @@ void loop() {
         current_state = STATE_MENU;
         menu_requested = false;
     }
+    handle_serial_commands();
     delay(10);
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <string.h>
+#include "pixel_dispatch.h"
+#include "firmware.h"
+
+// live_pixel.cpp's receive path without the display: frames are parsed and
+// sequenced by the firmware's own code and queued in the same PixelQueue.
+// Single threaded, the caller plays both tasks, so the queue needs no lock.
+
+struct NoLock {
+    void lock() {}
+    void unlock() {}
+};
+
+struct FirmwareDisplay {
+    PixelClient client;
+    PixelQueue<NoLock> queue;
+    uint16_t canvas[PIXEL_KEYFRAME_COLORS];
+};
+
+FirmwareDisplay *firmware_display_new(void) {
+    FirmwareDisplay *display = new FirmwareDisplay();
+    pixel_client_reset(&display->client);
+    pixel_queue_reset(&display->queue);
+    for (int i = 0; i < PIXEL_KEYFRAME_COLORS; i++) {
+        display->canvas[i] = PIXEL_CLEAR_COLOR;
+    }
+    return display;
+}
+
+void firmware_display_free(FirmwareDisplay *display) {
+    delete display;
+}
+
+int firmware_display_receive(FirmwareDisplay *display, const uint8_t *buf, size_t len, uint32_t now_ms) {
+    PixelFrame frame;
+    if (!pixel_frame_parse(buf, len, &frame)) {
+        return 0;
+    }
+
+    pixel_client_dispatch(&display->client, &display->queue, frame, now_ms);
+    pixel_queue_publish(&display->queue);
+    return 1;
+}
+
+size_t firmware_display_request(FirmwareDisplay *display, uint8_t *buf) {
+    const size_t len = pixel_client_write_resync(&display->client, buf);
+    if (len > 0) {
+        return len;
+    }
+    return pixel_client_write_credit(&display->client, pixel_queue_free_records(&display->queue), buf);
+}
+
+int firmware_display_draw(FirmwareDisplay *display, int max, FirmwarePixel *out) {
+    static_assert(sizeof(FirmwarePixel) == sizeof(PixelRecord), "FirmwarePixel mirrors PixelRecord");
+
+    PixelRecord *records = (PixelRecord *)out;
+    int count = (int)pixel_ring_consume(&display->queue.ring, records, (uint32_t)max);
+    for (int i = 0; i < count; i++) {
+        display->canvas[records[i].y * PIXEL_CANVAS_SIZE + records[i].x] = records[i].color;
+    }
+
+    uint16_t pixels[PIXEL_KEYFRAME_COLORS];
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+    if (pixel_queue_take_overflow(&display->queue, pixels, dirty)) {
+        for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+            while (dirty[y]) {
+                const int x = __builtin_ctz(dirty[y]);
+                const uint16_t color = pixels[y * PIXEL_CANVAS_SIZE + x];
+                display->canvas[y * PIXEL_CANVAS_SIZE + x] = color;
+                records[count++] = PixelRecord{(uint8_t)x, (uint8_t)y, color};
+                dirty[y] &= dirty[y] - 1;
+            }
+        }
+    }
+    return count;
+}
+
+void firmware_display_canvas(const FirmwareDisplay *display, uint16_t *out) {
+    memcpy(out, display->canvas, sizeof(display->canvas));
+}
+
+FirmwareStats firmware_display_stats(const FirmwareDisplay *display) {
+    FirmwareDisplay *mutable_display = (FirmwareDisplay *)display;
+    FirmwareStats stats = {display->client.sync.gaps, display->queue.overflows,
+                           pixel_ring_used(&mutable_display->queue.ring)};
+    return stats;
+}
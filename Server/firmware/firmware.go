@@ -0,0 +1,80 @@
+// Package firmware runs the ESP32's Live Pixel receive path on the host, built
+// from pixel_dispatch.h and the headers it includes in the sketch folder,
+// for the load test and the relay's tests. The build cache doesn't notice
+// changes to those headers: build with -a after editing them.
+package firmware
+
+// #cgo CXXFLAGS: -std=c++17 -O2 -I${SRCDIR}/../..
+// #include "firmware.h"
+import "C"
+
+import "unsafe"
+
+const CanvasPixels = C.FIRMWARE_CANVAS_PIXELS
+
+type Pixel struct {
+	X, Y  uint8
+	Color uint16
+}
+
+type Stats struct {
+	Gaps      uint32 // deltas missed and recovered by a resync
+	Overflows uint32 // times the pixel ring filled up
+	RingUsed  uint32
+}
+
+// A stand-in display. Not safe for concurrent use.
+type Display struct {
+	display *C.FirmwareDisplay
+	drawn   []C.FirmwarePixel
+}
+
+func NewDisplay() *Display {
+	return &Display{display: C.firmware_display_new()}
+}
+
+func (d *Display) Free() {
+	C.firmware_display_free(d.display)
+}
+
+// Handles one binary message from the relay. Returns false if it doesn't parse.
+func (d *Display) Receive(msg []byte, nowMs uint32) bool {
+	if len(msg) == 0 {
+		return false
+	}
+	return C.firmware_display_receive(d.display, (*C.uint8_t)(unsafe.Pointer(&msg[0])), C.size_t(len(msg)), C.uint32_t(nowMs)) != 0
+}
+
+// The next RESYNC or CREDIT to send, nil if none is due
+func (d *Display) Request() []byte {
+	buf := make([]byte, C.FIRMWARE_REQUEST_MAX)
+	n := C.firmware_display_request(d.display, (*C.uint8_t)(unsafe.Pointer(&buf[0])))
+	if n == 0 {
+		return nil
+	}
+	return buf[:n]
+}
+
+// Applies up to max queued records and returns the pixels applied
+func (d *Display) Draw(max int) []Pixel {
+	if need := max + CanvasPixels; len(d.drawn) < need {
+		d.drawn = make([]C.FirmwarePixel, need)
+	}
+	n := int(C.firmware_display_draw(d.display, C.int(max), &d.drawn[0]))
+	pixels := make([]Pixel, n)
+	for i := range pixels {
+		pixels[i] = Pixel{uint8(d.drawn[i].x), uint8(d.drawn[i].y), uint16(d.drawn[i].color)}
+	}
+	return pixels
+}
+
+func (d *Display) Canvas() [CanvasPixels]uint16 {
+	var canvas [CanvasPixels]uint16
+	C.firmware_display_canvas(d.display, (*C.uint16_t)(unsafe.Pointer(&canvas[0])))
+	return canvas
+}
+
+func (d *Display) Stats() Stats {
+	stats := C.firmware_display_stats(d.display)
+	return Stats{uint32(stats.gaps), uint32(stats.overflows), uint32(stats.ring_used)}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// C interface to the firmware's Live Pixel receive path, for cgo
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FirmwareDisplay FirmwareDisplay;
+
+typedef struct {
+    uint8_t x, y;
+    uint16_t color;
+} FirmwarePixel;
+
+typedef struct {
+    uint32_t gaps;       // deltas missed and recovered by a resync
+    uint32_t overflows;  // times the pixel ring filled up
+    uint32_t ring_used;
+} FirmwareStats;
+
+#define FIRMWARE_REQUEST_MAX 8
+#define FIRMWARE_CANVAS_PIXELS 1024
+
+FirmwareDisplay *firmware_display_new(void);
+void firmware_display_free(FirmwareDisplay *display);
+// Handles one binary message from the relay. Returns false if it doesn't parse.
+int firmware_display_receive(FirmwareDisplay *display, const uint8_t *buf, size_t len, uint32_t now_ms);
+// Writes the next RESYNC or CREDIT to send into buf. Returns its length, 0 if none.
+size_t firmware_display_request(FirmwareDisplay *display, uint8_t *buf);
+// Applies up to max queued records to the canvas, or the coalesced pixels once
+// the ring is empty, and writes the pixels applied to out. Returns their count.
+// out needs room for max + FIRMWARE_CANVAS_PIXELS pixels.
+int firmware_display_draw(FirmwareDisplay *display, int max, FirmwarePixel *out);
+void firmware_display_canvas(const FirmwareDisplay *display, uint16_t *out);
+FirmwareStats firmware_display_stats(const FirmwareDisplay *display);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,376 @@
+package main
+
+import (
+	"encoding/binary"
+	"log"
+	"sync/atomic"
+	"time"
+
+	"github.com/gorilla/websocket"
+)
+
+const (
+	clientQueueSize = 64 // frames waiting for one client's writer
+	writeWait       = 10 * time.Second
+	pingPeriod      = 15 * time.Second
+	pongWait        = 60 * time.Second
+	tickPeriod      = 16 * time.Millisecond // drawing is merged into one delta per tick
+	statsPeriod     = 10 * time.Second
+)
+
+// The authoritative canvas. Every change gets the next sequence number and
+// each pixel remembers the last one that changed it, so a device that missed
+// deltas can be sent only the pixels changed since the last one it applied.
+// Only the hub goroutine touches it.
+type canvasState struct {
+	pixels    [canvasPixels]uint16
+	changedAt [canvasPixels]uint32
+	seq       uint32
+}
+
+func newCanvasState() *canvasState {
+	c := &canvasState{}
+	for i := range c.pixels {
+		c.pixels[i] = clearColor
+	}
+	return c
+}
+
+// Applies pixels as the next sequence number. Returns the ones that changed,
+// the sequence only moves on if there are any.
+func (c *canvasState) apply(pixels []pixelRecord) []pixelRecord {
+	seq := c.seq + 1
+	changed := pixels[:0:0]
+	for _, p := range pixels {
+		i := int(p.y)*canvasSize + int(p.x)
+		if c.pixels[i] == p.color {
+			continue
+		}
+		c.pixels[i] = p.color
+		c.changedAt[i] = seq
+		changed = append(changed, p)
+	}
+	if len(changed) > 0 {
+		c.seq = seq
+	}
+	return changed
+}
+
+func (c *canvasState) keyframe() []byte {
+	frame := make([]byte, keyframeSize)
+	frame[0] = pixelProtoVersion
+	frame[1] = pixelOpKeyframe
+	binary.LittleEndian.PutUint16(frame[2:], canvasPixels)
+	binary.LittleEndian.PutUint32(frame[pixelProtoHeaderSize:], c.seq)
+	for i, color := range c.pixels {
+		binary.LittleEndian.PutUint16(frame[pixelProtoHeaderSize+pixelProtoSeqSize+i*2:], color)
+	}
+	return frame
+}
+
+// What a device that has applied everything up to base needs: a PATCH of the
+// pixels changed since, or a keyframe when that is smaller, has more than
+// maxRecords records or base is unknown. Nothing if base is the current canvas,
+// since the device drops a PATCH that doesn't move it on. Also returns the
+// number of pixel records in the frame, 0 for a keyframe.
+func (c *canvasState) resync(base uint32, maxRecords int) ([]byte, int) {
+	if base == 0 || base > c.seq {
+		return c.keyframe(), 0
+	}
+	if base == c.seq {
+		return nil, 0
+	}
+	var pixels []pixelRecord
+	for i, at := range c.changedAt {
+		if at > base {
+			pixels = append(pixels, pixelRecord{uint8(i % canvasSize), uint8(i / canvasSize), c.pixels[i]})
+		}
+	}
+	if len(pixels) > maxRecords || pixelProtoHeaderSize+2*pixelProtoSeqSize+len(pixels)*pixelProtoRecordSize >= keyframeSize {
+		return c.keyframe(), 0
+	}
+	return encodeSequencedFrame(pixelOpPatch, []uint32{base, c.seq}, pixels), len(pixels)
+}
+
+// One connection. Its writer goroutine is the only one writing to ws and
+// sends whatever the hub queues; the rest belongs to the hub goroutine.
+//
+// Frames that don't fit the queue, or a device's credit (see pixel_protocol.h),
+// are not queued: the client is marked behind and later brought up to date
+// with one PATCH from sentSeq, so a slow client costs the others nothing.
+type relayClient struct {
+	ws        *websocket.Conn
+	addr      string
+	send      chan *websocket.PreparedMessage
+	wantDrain atomic.Bool // the writer tells the hub when its queue empties
+
+	credited bool   // the client grants credit
+	limit    uint32 // DELTA and PATCH records it can take in total
+	sent     uint32 // records queued so far
+	sentSeq  uint32 // the canvas the client has everything up to
+	behind   bool   // deltas after sentSeq were held back
+}
+
+// Whether the client can take records more DELTA or PATCH records
+func (c *relayClient) hasCredit(records int) bool {
+	return !c.credited || int32(c.limit-c.sent) >= int32(records)
+}
+
+// Sends queued frames and pings until the hub closes the queue
+func (c *relayClient) writePump() {
+	pingTicker := time.NewTicker(pingPeriod)
+	defer func() {
+		pingTicker.Stop()
+		c.ws.Close()
+	}()
+
+	for {
+		select {
+		case msg, ok := <-c.send:
+			if !ok {
+				c.ws.WriteControl(websocket.CloseMessage, websocket.FormatCloseMessage(1000, ""), time.Now().Add(writeWait))
+				return
+			}
+			c.ws.SetWriteDeadline(time.Now().Add(writeWait))
+			if err := c.ws.WritePreparedMessage(msg); err != nil {
+				log.Printf("Error sending frame to %s: %v", c.addr, err)
+				return // The read loop sees the closed connection and unregisters
+			}
+			if len(c.send) == 0 && c.wantDrain.CompareAndSwap(true, false) {
+				relay.drained <- c
+			}
+		case <-pingTicker.C:
+			if err := c.ws.WriteControl(websocket.PingMessage, []byte{}, time.Now().Add(writeWait)); err != nil {
+				log.Printf("Ping error to %s: %v", c.addr, err)
+				return
+			}
+		}
+	}
+}
+
+type clientValue struct {
+	client *relayClient
+	value  uint32
+}
+
+// Pixel counts since the relay started, readable from any goroutine
+type relayStats struct {
+	PixelsIn     atomic.Uint64 // pixels received from drawing clients
+	PixelsMerged atomic.Uint64 // pixels in the per-tick deltas, after merging
+	PixelsOut    atomic.Uint64 // DELTA and PATCH records queued, summed over clients
+}
+
+// The hub owns the canvas and the clients, and is the only goroutine that
+// changes either. Read loops hand it their updates, writers their empty queues.
+//
+// Incoming pixels wait in a dirty set until the next tick, where only the last
+// write to each pixel goes out, as one delta. Brush stamps from useCanvas.ts
+// and WebSocketService.kt overlap a lot, so most writes never leave the relay.
+type hub struct {
+	canvas  *canvasState
+	clients map[*relayClient]bool
+	stats   relayStats
+
+	pending      [canvasPixels]uint16
+	pendingDirty [canvasPixels]bool
+	pendingOrder []uint16 // dirty pixel indices, in first-write order
+
+	register   chan *relayClient
+	unregister chan *relayClient
+	pixels     chan []pixelRecord
+	replace    chan func(colors *[canvasPixels]uint16)
+	credit     chan clientValue
+	resync     chan clientValue
+	drained    chan *relayClient
+}
+
+var relay = newHub()
+
+func newHub() *hub {
+	return &hub{
+		canvas:     newCanvasState(),
+		clients:    make(map[*relayClient]bool),
+		register:   make(chan *relayClient),
+		unregister: make(chan *relayClient),
+		pixels:     make(chan []pixelRecord, clientQueueSize),
+		replace:    make(chan func(colors *[canvasPixels]uint16)),
+		credit:     make(chan clientValue, clientQueueSize),
+		resync:     make(chan clientValue),
+		drained:    make(chan *relayClient, clientQueueSize),
+	}
+}
+
+func (h *hub) run() {
+	tick := time.NewTicker(tickPeriod)
+	defer tick.Stop()
+	statsTick := time.NewTicker(statsPeriod)
+	defer statsTick.Stop()
+	var lastIn, lastMerged, lastOut uint64
+
+	for {
+		select {
+		case client := <-h.register:
+			h.clients[client] = true
+			client.sentSeq = h.canvas.seq
+			h.queue(client, prepare(h.canvas.keyframe()))
+			log.Printf("New client connected from %s! Total clients: %d", client.addr, len(h.clients))
+		case client := <-h.unregister:
+			if h.clients[client] {
+				delete(h.clients, client)
+				close(client.send)
+				log.Printf("Remaining clients: %d", len(h.clients))
+			}
+		case pixels := <-h.pixels:
+			h.stage(pixels)
+		case <-tick.C:
+			h.flush()
+		case <-statsTick.C:
+			in, merged, out := h.stats.PixelsIn.Load(), h.stats.PixelsMerged.Load(), h.stats.PixelsOut.Load()
+			if in != lastIn {
+				seconds := uint64(statsPeriod / time.Second)
+				log.Printf("Pixels/s: in %d, merged %d, out %d to %d clients",
+					(in-lastIn)/seconds, (merged-lastMerged)/seconds, (out-lastOut)/seconds, len(h.clients))
+			}
+			lastIn, lastMerged, lastOut = in, merged, out
+		case edit := <-h.replace:
+			h.flush() // Earlier drawing goes first
+			colors := h.canvas.pixels
+			edit(&colors)
+			h.broadcastCanvas(&colors)
+		case c := <-h.credit:
+			client := c.client
+			if !client.credited || int32(c.value-client.limit) > 0 {
+				client.limit = c.value
+			}
+			client.credited = true
+			if client.behind && client.hasCredit(1) && h.clients[client] {
+				h.catchUp(client, client.sentSeq)
+			}
+		case c := <-h.resync:
+			// The device drops deltas until answered, so anything queued after base is lost
+			if h.clients[c.client] {
+				c.client.sentSeq = c.value
+				c.client.behind = true
+				h.catchUp(c.client, c.value)
+			}
+		case client := <-h.drained:
+			if client.behind && client.hasCredit(1) && h.clients[client] {
+				h.catchUp(client, client.sentSeq)
+			}
+		}
+	}
+}
+
+func prepare(frame []byte) *websocket.PreparedMessage {
+	msg, err := websocket.NewPreparedMessage(websocket.BinaryMessage, frame)
+	if err != nil {
+		log.Fatalf("Error preparing frame: %v", err)
+	}
+	return msg
+}
+
+// Queues msg without waiting. A client with a full queue falls behind instead.
+func (h *hub) queue(client *relayClient, msg *websocket.PreparedMessage) bool {
+	select {
+	case client.send <- msg:
+		return true
+	default:
+		client.behind = true
+		client.wantDrain.Store(true)
+		return false
+	}
+}
+
+// Last write wins until the next tick
+func (h *hub) stage(pixels []pixelRecord) {
+	h.stats.PixelsIn.Add(uint64(len(pixels)))
+	for _, p := range pixels {
+		i := uint16(p.y)*canvasSize + uint16(p.x)
+		if !h.pendingDirty[i] {
+			h.pendingDirty[i] = true
+			h.pendingOrder = append(h.pendingOrder, i)
+		}
+		h.pending[i] = p.color
+	}
+}
+
+// Sends what was staged this tick as one delta
+func (h *hub) flush() {
+	if len(h.pendingOrder) == 0 {
+		return
+	}
+	pixels := make([]pixelRecord, len(h.pendingOrder))
+	for n, i := range h.pendingOrder {
+		pixels[n] = pixelRecord{uint8(i % canvasSize), uint8(i / canvasSize), h.pending[i]}
+		h.pendingDirty[i] = false
+	}
+	h.pendingOrder = h.pendingOrder[:0]
+	h.broadcastPixels(pixels)
+}
+
+// Applies pixels, at most one per canvas position, and broadcasts them as a
+// numbered delta encoded once
+func (h *hub) broadcastPixels(pixels []pixelRecord) {
+	changed := h.canvas.apply(pixels)
+	if len(changed) == 0 {
+		return
+	}
+	h.stats.PixelsMerged.Add(uint64(len(changed)))
+	msg := prepare(encodeSequencedFrame(pixelOpDelta, []uint32{h.canvas.seq}, changed))
+	for client := range h.clients {
+		if client.behind {
+			if client.hasCredit(1) && len(client.send) < cap(client.send) {
+				h.catchUp(client, client.sentSeq) // Includes this delta
+			}
+			continue
+		}
+		if !client.hasCredit(len(changed)) {
+			client.behind = true // Catches up on the next grant, within its credit
+			continue
+		}
+		if h.queue(client, msg) {
+			client.sent += uint32(len(changed))
+			client.sentSeq = h.canvas.seq
+			h.stats.PixelsOut.Add(uint64(len(changed)))
+		}
+	}
+}
+
+// Replaces the whole canvas and broadcasts it as a keyframe. Keyframes are
+// sent whatever the credit: the device draws them without queueing pixels.
+func (h *hub) broadcastCanvas(colors *[canvasPixels]uint16) {
+	pixels := make([]pixelRecord, 0, canvasPixels)
+	for i, color := range colors {
+		pixels = append(pixels, pixelRecord{uint8(i % canvasSize), uint8(i / canvasSize), color})
+	}
+
+	h.canvas.apply(pixels)
+	msg := prepare(h.canvas.keyframe())
+	for client := range h.clients {
+		if h.queue(client, msg) {
+			client.behind = false
+			client.sentSeq = h.canvas.seq
+		}
+	}
+}
+
+// Brings a client up to the current canvas with a PATCH from base, or with a
+// keyframe if the PATCH would overrun its credit: keyframes skip the pixel ring
+func (h *hub) catchUp(client *relayClient, base uint32) {
+	maxRecords := canvasPixels
+	if client.credited {
+		maxRecords = int(int32(client.limit - client.sent))
+	}
+	frame, records := h.canvas.resync(base, maxRecords)
+	if frame == nil {
+		client.sentSeq = base
+		client.behind = false
+		return
+	}
+	if h.queue(client, prepare(frame)) {
+		h.stats.PixelsOut.Add(uint64(records))
+		client.sent += uint32(records)
+		client.sentSeq = h.canvas.seq
+		client.behind = false
+	}
+}
@@ -0,0 +1,425 @@
+// Load test and latency benchmark for the Live Pixel pipeline. For every
+// combination of drawer and display counts it starts a fresh relay, has the
+// drawers replay a stroke trace the way the web and Android clients send it,
+// and connects stand-in ESP32 displays that run the firmware's own receive
+// path (see the firmware package) and draw at a fixed rate. Reports throughput,
+// draw latency from send to display, and pixels the displays end up missing.
+//
+//	cd Server && go run ./loadtest -drawers 1,4,16 -displays 1,4,16
+package main
+
+import (
+	"encoding/binary"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io"
+	"log"
+	"net"
+	"net/http"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/gorilla/websocket"
+
+	"Server/firmware"
+)
+
+// Mirrored from pixel_protocol.h
+const (
+	pixelProtoHeaderSize = 4
+	pixelProtoSeqSize    = 4
+	pixelOpKeyframe      = 0x03
+	canvasSize           = 32
+	canvasPixels         = canvasSize * canvasSize
+)
+
+const (
+	messagePeriod      = 16 * time.Millisecond // one drawer message per animation frame
+	serverPollInterval = 10 * time.Millisecond // live_pixel.cpp's SERVER_POLL_TICKS
+)
+
+var (
+	relayURL   = flag.String("url", "", "benchmark a running relay instead of starting one per run")
+	relayBin   = flag.String("relay", "", "relay binary to start, built from -server if empty")
+	serverDir  = flag.String("server", ".", "relay source directory")
+	drawerList = flag.String("drawers", "1,4,16", "drawer counts to run")
+	displayArg = flag.String("displays", "1,4,16", "display counts to run")
+	duration   = flag.Duration("duration", 5*time.Second, "how long the drawers draw in each run")
+	settle     = flag.Duration("settle", 2*time.Second, "time allowed to catch up after drawing stops")
+	tracePath  = flag.String("trace", "", "stroke trace to replay, synthetic strokes if empty")
+	rate       = flag.Int("rate", 2000, "pixels per second per drawer in the synthetic trace")
+	brush      = flag.Int("brush", 3, "brush size of the synthetic trace")
+	seed       = flag.Int64("seed", 1, "seed of the synthetic trace")
+	drawRate   = flag.Int("draw-rate", 20000, "pixels per second a display draws, 0 for no limit")
+)
+
+// The last write to each pixel and when it was sent, to time its way to the displays
+type writeLog struct {
+	mu     sync.Mutex
+	color  [canvasPixels]uint16
+	sentAt [canvasPixels]time.Time
+	gen    [canvasPixels]uint32
+}
+
+func (w *writeLog) record(pixels []pixelRecord, now time.Time) {
+	w.mu.Lock()
+	for _, p := range pixels {
+		i := int(p.y)*canvasSize + int(p.x)
+		w.color[i] = p.color
+		w.sentAt[i] = now
+		w.gen[i]++
+	}
+	w.mu.Unlock()
+}
+
+// Latencies of the drawn pixels that show a write for the first time
+func (w *writeLog) match(pixels []pixelRecord, seen *[canvasPixels]uint32, now time.Time, samples []time.Duration) []time.Duration {
+	w.mu.Lock()
+	for _, p := range pixels {
+		i := int(p.y)*canvasSize + int(p.x)
+		if w.gen[i] != 0 && w.color[i] == p.color && seen[i] != w.gen[i] {
+			seen[i] = w.gen[i]
+			samples = append(samples, now.Sub(w.sentAt[i]))
+		}
+	}
+	w.mu.Unlock()
+	return samples
+}
+
+type run struct {
+	url    string
+	trace  *trace
+	writes writeLog
+	sent   atomic.Uint64
+	drawn  atomic.Uint64
+
+	mu      sync.Mutex
+	samples []time.Duration
+}
+
+func dial(url string) *websocket.Conn {
+	ws, _, err := websocket.DefaultDialer.Dial(url, nil)
+	if err != nil {
+		log.Fatalf("Error connecting to %s: %v", url, err)
+	}
+	return ws
+}
+
+// A browser tab replaying the trace. It also takes everything the relay broadcasts.
+func (r *run) drawer(shift int, stop <-chan struct{}, done *sync.WaitGroup) {
+	defer done.Done()
+	ws := dial(r.url)
+	defer ws.Close()
+	go func() {
+		for {
+			if _, _, err := ws.ReadMessage(); err != nil {
+				return
+			}
+		}
+	}()
+
+	start := time.Now()
+	messages := r.trace.messages
+	for i := 0; ; i++ {
+		msg := messages[i%len(messages)]
+		at := start.Add(time.Duration(i/len(messages))*r.trace.length + msg.at)
+		select {
+		case <-stop:
+			return
+		case <-time.After(time.Until(at)):
+		}
+
+		pixels := shiftPixels(msg.pixels, shift)
+		r.writes.record(pixels, time.Now())
+		if err := ws.WriteMessage(websocket.TextMessage, batchMessage(pixels)); err != nil {
+			log.Printf("Error sending from drawer %d: %v", shift, err)
+			return
+		}
+		r.sent.Add(uint64(len(pixels)))
+	}
+}
+
+// An ESP32: websocket callbacks feed the firmware's receive path, and
+// server_task's poll loop draws at drawRate and sends RESYNC and CREDIT
+type display struct {
+	ws    *websocket.Conn
+	fw    *firmware.Display
+	mu    sync.Mutex
+	seen  [canvasPixels]uint32
+	start time.Time
+	read  chan struct{} // closed when the reader goroutine returns
+}
+
+func (r *run) newDisplay() *display {
+	d := &display{ws: dial(r.url), fw: firmware.NewDisplay(), start: time.Now(), read: make(chan struct{})}
+	go func() {
+		defer close(d.read)
+		for {
+			messageType, msg, err := d.ws.ReadMessage()
+			if err != nil {
+				return
+			}
+			if messageType == websocket.BinaryMessage {
+				d.mu.Lock()
+				d.fw.Receive(msg, uint32(time.Since(d.start).Milliseconds()))
+				d.mu.Unlock()
+			}
+		}
+	}()
+	return d
+}
+
+func (r *run) poll(d *display, stop <-chan struct{}, done *sync.WaitGroup) {
+	defer done.Done()
+	ticker := time.NewTicker(serverPollInterval)
+	defer ticker.Stop()
+
+	last := time.Now()
+	budget := 0.0
+	for {
+		select {
+		case <-stop:
+			return
+		case now := <-ticker.C:
+			max := canvasPixels * 64
+			if *drawRate > 0 {
+				budget += now.Sub(last).Seconds() * float64(*drawRate)
+				max = int(budget)
+			}
+			last = now
+
+			d.mu.Lock()
+			drawn := d.fw.Draw(max)
+			for req := d.fw.Request(); req != nil; req = d.fw.Request() {
+				if err := d.ws.WriteMessage(websocket.BinaryMessage, req); err != nil {
+					log.Printf("Error sending from a display: %v", err)
+				}
+			}
+			d.mu.Unlock()
+
+			pixels := make([]pixelRecord, len(drawn))
+			for i, p := range drawn {
+				pixels[i] = pixelRecord{p.X, p.Y, p.Color}
+			}
+			if *drawRate > 0 {
+				budget -= float64(len(pixels))
+				if budget < 0 {
+					budget = 0 // Coalesced pixels drawn at once don't borrow from later
+				}
+			}
+			r.drawn.Add(uint64(len(pixels)))
+			r.mu.Lock()
+			r.samples = r.writes.match(pixels, &d.seen, now, r.samples)
+			r.mu.Unlock()
+		}
+	}
+}
+
+type relayStats struct {
+	PixelsIn     uint64 `json:"pixels_in"`
+	PixelsMerged uint64 `json:"pixels_merged"`
+	PixelsOut    uint64 `json:"pixels_out"`
+}
+
+func statsURL(url string) string {
+	return strings.Replace(strings.Replace(url, "ws", "http", 1), "/ws", "/stats", 1)
+}
+
+func fetchStats(url string) (relayStats, error) {
+	var stats relayStats
+	resp, err := http.Get(statsURL(url))
+	if err != nil {
+		return stats, err
+	}
+	defer resp.Body.Close()
+	err = json.NewDecoder(resp.Body).Decode(&stats)
+	return stats, err
+}
+
+// The relay's canvas, from the keyframe a new connection gets
+func relayCanvas(url string) [canvasPixels]uint16 {
+	ws := dial(url)
+	defer ws.Close()
+	var canvas [canvasPixels]uint16
+	for {
+		_, msg, err := ws.ReadMessage()
+		if err != nil {
+			log.Fatalf("Error reading the relay's keyframe: %v", err)
+		}
+		if len(msg) >= pixelProtoHeaderSize && msg[1] == pixelOpKeyframe {
+			offset := pixelProtoHeaderSize + pixelProtoSeqSize
+			for i := range canvas {
+				canvas[i] = binary.LittleEndian.Uint16(msg[offset+i*2:])
+			}
+			return canvas
+		}
+	}
+}
+
+// Builds the relay from -server into dir
+func buildRelay(dir string) string {
+	bin := filepath.Join(dir, "relay")
+	cmd := exec.Command("go", "build", "-o", bin, ".")
+	cmd.Dir = *serverDir
+	cmd.Stdout, cmd.Stderr = os.Stderr, os.Stderr
+	if err := cmd.Run(); err != nil {
+		log.Fatalf("Error building the relay in %s: %v", *serverDir, err)
+	}
+	return bin
+}
+
+// Starts the relay on a free local port and waits until it answers
+func startRelay(bin string) (*exec.Cmd, string) {
+	listener, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		log.Fatal(err)
+	}
+	addr := listener.Addr().String()
+	listener.Close()
+
+	cmd := exec.Command(bin, "-addr", addr)
+	cmd.Stdout, cmd.Stderr = io.Discard, io.Discard
+	if err := cmd.Start(); err != nil {
+		log.Fatalf("Error starting the relay: %v", err)
+	}
+
+	url := "ws://" + addr + "/ws"
+	for deadline := time.Now().Add(10 * time.Second); ; time.Sleep(50 * time.Millisecond) {
+		if _, err := fetchStats(url); err == nil {
+			return cmd, url
+		}
+		if time.Now().After(deadline) {
+			cmd.Process.Kill()
+			log.Fatalf("The relay did not start on %s", addr)
+		}
+	}
+}
+
+func percentile(sorted []time.Duration, p float64) float64 {
+	if len(sorted) == 0 {
+		return 0
+	}
+	return float64(sorted[int(p*float64(len(sorted)-1))]) / float64(time.Millisecond)
+}
+
+func benchmark(url string, t *trace, drawers, displays int) {
+	r := &run{url: url, trace: t}
+	before, err := fetchStats(url)
+	if err != nil {
+		log.Fatalf("Error reading relay stats: %v", err)
+	}
+
+	stopDisplays := make(chan struct{})
+	var displaysDone sync.WaitGroup
+	devices := make([]*display, displays)
+	for i := range devices {
+		devices[i] = r.newDisplay()
+		displaysDone.Add(1)
+		go r.poll(devices[i], stopDisplays, &displaysDone)
+	}
+
+	stopDrawing := make(chan struct{})
+	var drawersDone sync.WaitGroup
+	for i := 0; i < drawers; i++ {
+		drawersDone.Add(1)
+		go r.drawer(i, stopDrawing, &drawersDone)
+	}
+	time.Sleep(*duration)
+	close(stopDrawing)
+	drawersDone.Wait()
+	drawn := r.drawn.Load()
+
+	time.Sleep(*settle)
+	expected := relayCanvas(url)
+	close(stopDisplays)
+	displaysDone.Wait()
+
+	dropped, overflows, gaps := 0, uint32(0), uint32(0)
+	for _, d := range devices {
+		// Nothing else touches the firmware once the reader has returned
+		d.ws.Close()
+		<-d.read
+		canvas := d.fw.Canvas()
+		for i := range canvas {
+			if canvas[i] != expected[i] {
+				dropped++
+			}
+		}
+		stats := d.fw.Stats()
+		overflows += stats.Overflows
+		gaps += stats.Gaps
+		d.fw.Free()
+	}
+
+	after, _ := fetchStats(url)
+	seconds := duration.Seconds()
+	sort.Slice(r.samples, func(i, j int) bool { return r.samples[i] < r.samples[j] })
+	fmt.Printf("%7d %8d %9.0f %9.0f %9.0f %9.0f %8.1f %8.1f %8d %9d %5d\n",
+		drawers, displays,
+		float64(r.sent.Load())/seconds,
+		float64(after.PixelsMerged-before.PixelsMerged)/seconds,
+		float64(after.PixelsOut-before.PixelsOut)/seconds,
+		float64(drawn)/seconds/float64(displays),
+		percentile(r.samples, 0.50), percentile(r.samples, 0.99),
+		dropped, overflows, gaps)
+}
+
+func parseCounts(list string) []int {
+	var counts []int
+	for _, field := range strings.Split(list, ",") {
+		n, err := strconv.Atoi(strings.TrimSpace(field))
+		if err != nil || n < 1 {
+			log.Fatalf("Bad count %q in %q", field, list)
+		}
+		counts = append(counts, n)
+	}
+	return counts
+}
+
+func main() {
+	flag.Parse()
+	drawerCounts, displayCounts := parseCounts(*drawerList), parseCounts(*displayArg)
+
+	t := syntheticTrace(10*time.Second, *rate, *brush, *seed)
+	if *tracePath != "" {
+		var err error
+		if t, err = loadTrace(*tracePath); err != nil {
+			log.Fatal(err)
+		}
+	}
+
+	bin := *relayBin
+	if *relayURL == "" && bin == "" {
+		dir, err := os.MkdirTemp("", "relay")
+		if err != nil {
+			log.Fatal(err)
+		}
+		defer os.RemoveAll(dir)
+		bin = buildRelay(dir)
+	}
+
+	fmt.Println("drawers displays   in px/s  merged/s     out/s drawn/s/d   p50 ms   p99 ms  dropped overflows  gaps")
+	for _, drawers := range drawerCounts {
+		for _, displays := range displayCounts {
+			if *relayURL != "" {
+				benchmark(*relayURL, t, drawers, displays)
+				continue
+			}
+			cmd, url := startRelay(bin)
+			benchmark(url, t, drawers, displays)
+			cmd.Process.Kill()
+			cmd.Wait()
+		}
+	}
+	fmt.Println("\nin: pixels sent by the drawers, merged: pixels in the relay's per-tick deltas,")
+	fmt.Println("out: records queued to all clients, drawn/s/d: pixels drawn per display,")
+	fmt.Println("p50/p99: send to draw on a display, dropped: pixels the displays miss at the end")
+}
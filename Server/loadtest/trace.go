@@ -0,0 +1,135 @@
+package main
+
+import (
+	"bufio"
+	"fmt"
+	"math/rand"
+	"os"
+	"strconv"
+	"strings"
+	"time"
+)
+
+type pixelRecord struct {
+	x, y  uint8
+	color uint16
+}
+
+// One drawer message, at its offset from the start of the trace
+type traceMessage struct {
+	at     time.Duration
+	pixels []pixelRecord
+}
+
+type trace struct {
+	messages []traceMessage
+	length   time.Duration // replays loop after this
+}
+
+// Reads a stroke trace: one message per line, "<ms> x,y,color;x,y,color;..."
+// with decimal coordinates and hex RGB565 colors, the "batch;" payload the
+// web and Android clients send. Lines starting with '#' are skipped.
+func loadTrace(path string) (*trace, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	t := &trace{}
+	scanner := bufio.NewScanner(f)
+	scanner.Buffer(make([]byte, 64*1024), 1024*1024)
+	for line := 1; scanner.Scan(); line++ {
+		text := strings.TrimSpace(scanner.Text())
+		if text == "" || strings.HasPrefix(text, "#") {
+			continue
+		}
+		ms, payload, ok := strings.Cut(text, " ")
+		at, err := strconv.Atoi(ms)
+		if !ok || err != nil {
+			return nil, fmt.Errorf("%s:%d: expected \"<ms> <pixels>\"", path, line)
+		}
+		var pixels []pixelRecord
+		for _, entry := range strings.Split(payload, ";") {
+			fields := strings.Split(entry, ",")
+			if len(fields) != 3 {
+				continue
+			}
+			x, errX := strconv.Atoi(fields[0])
+			y, errY := strconv.Atoi(fields[1])
+			color, errC := strconv.ParseUint(fields[2], 16, 16)
+			if errX == nil && errY == nil && errC == nil && x >= 0 && x < canvasSize && y >= 0 && y < canvasSize {
+				pixels = append(pixels, pixelRecord{uint8(x), uint8(y), uint16(color)})
+			}
+		}
+		t.messages = append(t.messages, traceMessage{time.Duration(at) * time.Millisecond, pixels})
+	}
+	if err := scanner.Err(); err != nil {
+		return nil, err
+	}
+	if len(t.messages) == 0 {
+		return nil, fmt.Errorf("%s: no messages", path)
+	}
+	t.length = t.messages[len(t.messages)-1].at + messagePeriod
+	return t, nil
+}
+
+// Strokes like useCanvas.ts sends them: square brush stamps along a wandering
+// path, one message per animation frame, about rate pixels a second
+func syntheticTrace(length time.Duration, rate, brush int, seed int64) *trace {
+	rng := rand.New(rand.NewSource(seed))
+	t := &trace{length: length}
+
+	stampsPerMessage := rate * int(messagePeriod/time.Millisecond) / 1000 / (brush * brush)
+	if stampsPerMessage < 1 {
+		stampsPerMessage = 1
+	}
+	x, y := rng.Intn(canvasSize), rng.Intn(canvasSize)
+	dx, dy := 1, 0
+	color := uint16(rng.Intn(0x10000))
+	for at := time.Duration(0); at < length; at += messagePeriod {
+		// A new stroke now and then, in a new color
+		if rng.Intn(60) == 0 {
+			x, y = rng.Intn(canvasSize), rng.Intn(canvasSize)
+			color = uint16(rng.Intn(0x10000))
+		}
+
+		pixels := make([]pixelRecord, 0, stampsPerMessage*brush*brush)
+		for s := 0; s < stampsPerMessage; s++ {
+			if rng.Intn(8) == 0 {
+				dx, dy = rng.Intn(3)-1, rng.Intn(3)-1
+			}
+			x = (x + dx + canvasSize) % canvasSize
+			y = (y + dy + canvasSize) % canvasSize
+			for by := 0; by < brush; by++ {
+				for bx := 0; bx < brush; bx++ {
+					pixels = append(pixels, pixelRecord{uint8((x + bx) % canvasSize), uint8((y + by) % canvasSize), color})
+				}
+			}
+		}
+		t.messages = append(t.messages, traceMessage{at, pixels})
+	}
+	return t
+}
+
+// Moves a trace's pixels so drawers replaying the same trace draw in different places
+func shiftPixels(pixels []pixelRecord, shift int) []pixelRecord {
+	shifted := make([]pixelRecord, len(pixels))
+	for i, p := range pixels {
+		shifted[i] = pixelRecord{uint8((int(p.x) + shift) % canvasSize), uint8((int(p.y) + shift*3) % canvasSize), p.color}
+	}
+	return shifted
+}
+
+// The "batch;" text message the web and Android clients send
+func batchMessage(pixels []pixelRecord) []byte {
+	var b strings.Builder
+	b.WriteString("batch;")
+	for i, p := range pixels {
+		if i > 0 {
+			b.WriteByte(';')
+		}
+		fmt.Fprintf(&b, "%d,%d,%x", p.x, p.y, p.color)
+	}
+	return []byte(b.String())
+}
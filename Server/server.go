@@ -1,23 +1,120 @@
 package main
 
 import (
+	"encoding/binary"
+	"flag"
 	"fmt"
 	"log"
 	"net"
 	"net/http"
+	"strconv"
 	"strings"
 	"time"
 
 	"github.com/gorilla/websocket"
 )
 
-var clients = make(map[*websocket.Conn]bool) // Connected clients
 var upgrader = websocket.Upgrader{
 	CheckOrigin:     func(r *http.Request) bool { return true }, // Allow all connections
 	ReadBufferSize:  1024,
 	WriteBufferSize: 1024,
 }
 
+// Binary Live Pixel frames, mirrored from pixel_protocol.h in the firmware:
+// [version:1][opcode:1][count:2 LE] followed by count [x:1][y:1][rgb565:2 LE] records.
+// Sequenced frames put [seq:4 LE] (PATCH: [base:4 LE][seq:4 LE]) before the payload.
+const (
+	pixelProtoVersion    = 1
+	pixelProtoHeaderSize = 4
+	pixelProtoRecordSize = 4
+	pixelProtoSeqSize    = 4
+	pixelOpPixels        = 0x01
+	pixelOpClear         = 0x02
+	pixelOpKeyframe      = 0x03
+	pixelOpDelta         = 0x04
+	pixelOpPatch         = 0x05
+	pixelOpResync        = 0x06
+	pixelOpCredit        = 0x07
+	canvasSize           = 32
+	canvasPixels         = canvasSize * canvasSize
+	keyframeSize         = pixelProtoHeaderSize + pixelProtoSeqSize + canvasPixels*2
+	clearColor           = 0xFFFF // the devices clear to white
+)
+
+type pixelRecord struct {
+	x, y  uint8
+	color uint16
+}
+
+// Parse "x1,y1,color1;x2,y2,color2;..." skipping malformed or off-canvas records
+func parseTextPixels(data string) []pixelRecord {
+	pixels := make([]pixelRecord, 0, strings.Count(data, ";")+1)
+	for _, entry := range strings.Split(data, ";") {
+		fields := strings.Split(entry, ",")
+		if len(fields) != 3 {
+			continue
+		}
+		x, errX := strconv.Atoi(fields[0])
+		y, errY := strconv.Atoi(fields[1])
+		color, errC := strconv.ParseUint(fields[2], 16, 16)
+		if errX != nil || errY != nil || errC != nil {
+			continue
+		}
+		if x < 0 || x >= canvasSize || y < 0 || y >= canvasSize {
+			continue
+		}
+		pixels = append(pixels, pixelRecord{uint8(x), uint8(y), uint16(color)})
+	}
+	return pixels
+}
+
+// Parse "full,c0,c1,..." hex colors, row by row. Missing or malformed colors are left as they were.
+func parseFullFrame(data string, colors *[canvasPixels]uint16) {
+	for i, field := range strings.SplitN(data, ",", canvasPixels) {
+		if color, err := strconv.ParseUint(strings.TrimSpace(field), 16, 16); err == nil {
+			colors[i] = uint16(color)
+		}
+	}
+}
+
+// Decode the records of an unsequenced PIXELS frame from a drawing client
+func decodePixelFrame(frame []byte) ([]pixelRecord, bool) {
+	if len(frame) < pixelProtoHeaderSize || frame[0] != pixelProtoVersion {
+		return nil, false
+	}
+	count := int(binary.LittleEndian.Uint16(frame[2:]))
+	if len(frame) != pixelProtoHeaderSize+count*pixelProtoRecordSize {
+		return nil, false
+	}
+	pixels := make([]pixelRecord, 0, count)
+	for i := 0; i < count; i++ {
+		rec := frame[pixelProtoHeaderSize+i*pixelProtoRecordSize:]
+		if rec[0] < canvasSize && rec[1] < canvasSize {
+			pixels = append(pixels, pixelRecord{rec[0], rec[1], binary.LittleEndian.Uint16(rec[2:])})
+		}
+	}
+	return pixels, true
+}
+
+// Sequenced frames, seqs holds the sequence numbers that go after the header
+func encodeSequencedFrame(opcode byte, seqs []uint32, pixels []pixelRecord) []byte {
+	offset := pixelProtoHeaderSize + len(seqs)*pixelProtoSeqSize
+	frame := make([]byte, offset+len(pixels)*pixelProtoRecordSize)
+	frame[0] = pixelProtoVersion
+	frame[1] = opcode
+	binary.LittleEndian.PutUint16(frame[2:], uint16(len(pixels)))
+	for i, seq := range seqs {
+		binary.LittleEndian.PutUint32(frame[pixelProtoHeaderSize+i*pixelProtoSeqSize:], seq)
+	}
+	for i, p := range pixels {
+		rec := frame[offset+i*pixelProtoRecordSize:]
+		rec[0] = p.x
+		rec[1] = p.y
+		binary.LittleEndian.PutUint16(rec[2:], p.color)
+	}
+	return frame
+}
+
 // Get local IP addresses to display for connection
 func getLocalIPs() []string {
 	var ips []string
@@ -43,145 +140,113 @@ func handleConnections(w http.ResponseWriter, r *http.Request) {
 		log.Printf("Error upgrading to WebSocket: %v", err)
 		return
 	}
-	defer ws.Close()
 
 	// Configure WebSocket
 	ws.SetReadLimit(65536)
-	ws.SetReadDeadline(time.Now().Add(60 * time.Second))
+	ws.SetReadDeadline(time.Now().Add(pongWait))
 	ws.SetPongHandler(func(string) error {
-		ws.SetReadDeadline(time.Now().Add(60 * time.Second))
+		ws.SetReadDeadline(time.Now().Add(pongWait))
 		return nil
 	})
 
-	// Add client to the global map
-	clients[ws] = true
+	// The hub starts the client at the current canvas, its writer sends from there
 	clientIP := r.RemoteAddr
-	log.Printf("New client connected from %s! Total clients: %d", clientIP, len(clients))
-
-	// Setup ping sender to keep connection alive
-	go func() {
-		pingTicker := time.NewTicker(15 * time.Second)
-		defer pingTicker.Stop()
-
-		for {
-			select {
-			case <-pingTicker.C:
-				if err := ws.WriteControl(websocket.PingMessage, []byte{}, time.Now().Add(10*time.Second)); err != nil {
-					log.Printf("Ping error to %s: %v", clientIP, err)
-					return
-				}
-			}
-		}
-	}()
+	client := &relayClient{ws: ws, addr: clientIP, send: make(chan *websocket.PreparedMessage, clientQueueSize)}
+	relay.register <- client
+	go client.writePump()
 
 	// Main message loop
 	for {
 		messageType, msg, err := ws.ReadMessage()
 		if err != nil {
 			log.Printf("Client %s disconnected: %v", clientIP, err)
-			delete(clients, ws)
-			log.Printf("Remaining clients: %d", len(clients))
+			relay.unregister <- client
 			break
 		}
 
 		msgStr := string(msg)
 
-		// Handle full image data transfer
+		// Handle full image data transfer, sent on as a keyframe
 		if strings.HasPrefix(msgStr, "full,") {
 			log.Printf("Received bulk image data from %s", clientIP)
-			for client := range clients {
-				if err := client.WriteMessage(messageType, msg); err != nil {
-					log.Printf("Error sending bulk data to client: %v", err)
-					client.Close()
-					delete(clients, client)
-				}
+			relay.replace <- func(colors *[canvasPixels]uint16) {
+				parseFullFrame(strings.TrimPrefix(msgStr, "full,"), colors)
 			}
 			continue
 		}
 
-		// Handle batch pixel updates
-		if strings.HasPrefix(msgStr, "batch;") {
-			pixelData := strings.TrimPrefix(msgStr, "batch;")
-			pixelUpdates := strings.Split(pixelData, ";")
-			updateCount := len(pixelUpdates)
-
-			log.Printf("Received batch update with %d pixels from %s", updateCount, clientIP)
-
-			// Split large batches into smaller chunks to prevent ESP32 crashes
-			const maxChunkSize = 32 // Maximum pixels per chunk
-
-			// Process in chunks if needed
-			if updateCount > maxChunkSize {
-				log.Printf("Splitting batch into chunks for ESP32 compatibility")
-
-				// Calculate number of chunks needed
-				chunkCount := (updateCount + maxChunkSize - 1) / maxChunkSize
-
-				for i := 0; i < chunkCount; i++ {
-					startIdx := i * maxChunkSize
-					endIdx := startIdx + maxChunkSize
-					if endIdx > updateCount {
-						endIdx = updateCount
-					}
-
-					// Create chunk from the subset of updates
-					chunkUpdates := pixelUpdates[startIdx:endIdx]
-					chunkData := strings.Join(chunkUpdates, ";")
-
-					// Format: "chunk;chunk_index;total_chunks;count;x1,y1,color1;x2,y2,color2;..."
-					chunkMsg := fmt.Sprintf("chunk;%d;%d;%d;%s", i, chunkCount, len(chunkUpdates), chunkData)
-
-					// Broadcast the chunk to all clients
-					for client := range clients {
-						if err := client.WriteMessage(websocket.TextMessage, []byte(chunkMsg)); err != nil {
-							log.Printf("Error sending chunk data to client: %v", err)
-							client.Close()
-							delete(clients, client)
-						}
-					}
-
-					// Add a small delay between chunks to prevent overwhelming the ESP32
-					if i < chunkCount-1 {
-						time.Sleep(10 * time.Millisecond)
-					}
-				}
-			} else {
-				// For small batches, use the compressed format
-				// Format: "compressed;count;x1,y1,color1;x2,y2,color2;..."
-				compressedMsg := fmt.Sprintf("compressed;%d;%s", updateCount, pixelData)
-
-				// Broadcast the compressed batch update to all clients
-				for client := range clients {
-					if err := client.WriteMessage(websocket.TextMessage, []byte(compressedMsg)); err != nil {
-						log.Printf("Error sending batch data to client: %v", err)
-						client.Close()
-						delete(clients, client)
-					}
+		// Device telemetry is for the server log only
+		if strings.HasPrefix(msgStr, "telemetry;") {
+			log.Printf("Telemetry from %s: %s", clientIP, strings.TrimPrefix(msgStr, "telemetry;"))
+			continue
+		}
+
+		if messageType == websocket.BinaryMessage {
+			// A device that missed deltas or is granting credit
+			if len(msg) == pixelProtoHeaderSize+pixelProtoSeqSize && msg[0] == pixelProtoVersion {
+				value := binary.LittleEndian.Uint32(msg[pixelProtoHeaderSize:])
+				switch msg[1] {
+				case pixelOpResync:
+					relay.resync <- clientValue{client, value}
+					continue
+				case pixelOpCredit:
+					relay.credit <- clientValue{client, value}
+					continue
 				}
 			}
+
+			if len(msg) >= pixelProtoHeaderSize && msg[0] == pixelProtoVersion && msg[1] == pixelOpClear {
+				relay.replace <- clearColors
+				continue
+			}
+
+			pixels, ok := decodePixelFrame(msg)
+			if !ok || msg[1] != pixelOpPixels {
+				log.Printf("Dropping malformed binary frame from %s", clientIP)
+				continue
+			}
+			relay.pixels <- pixels
 			continue
 		}
 
-		log.Printf("Received from %s: %s", clientIP, msgStr)
+		// Handle batch pixel updates, sent on as binary deltas
+		if strings.HasPrefix(msgStr, "batch;") {
+			pixels := parseTextPixels(strings.TrimPrefix(msgStr, "batch;"))
+			log.Printf("Received batch update with %d pixels from %s", len(pixels), clientIP)
+			relay.pixels <- pixels
+			continue
+		}
 
-		// Handle special commands
-		if strings.TrimSpace(msgStr) == "clear" {
+		// The clear command, "clear" or a pixel at -1,-1
+		if strings.TrimSpace(msgStr) == "clear" || strings.HasPrefix(msgStr, "-1,-1,") {
 			log.Printf("Clear canvas command received")
-			// You could implement special handling here
+			relay.replace <- clearColors
+			continue
 		}
 
-		// Broadcast to all connected clients
-		for client := range clients {
-			if err := client.WriteMessage(messageType, msg); err != nil {
-				log.Printf("Error sending message to client: %v", err)
-				client.Close()
-				delete(clients, client)
-			}
+		// Single pixel updates
+		if pixels := parseTextPixels(msgStr); len(pixels) > 0 {
+			relay.pixels <- pixels
+			continue
 		}
+
+		log.Printf("Ignoring message from %s: %s", clientIP, msgStr)
+	}
+}
+
+func clearColors(colors *[canvasPixels]uint16) {
+	for i := range colors {
+		colors[i] = clearColor
 	}
 }
 
 func main() {
+	// Server address
+	serverAddr := flag.String("addr", ":5173", "address to listen on")
+	flag.Parse()
+
+	go relay.run()
+
 	// Create server mux
 	mux := http.NewServeMux()
 
@@ -192,27 +257,31 @@ func main() {
 	// WebSocket route
 	mux.HandleFunc("/ws", handleConnections)
 
-	// Server address
-	serverAddr := ":5173"
+	// Pixel counters, to compare input and output rates under load
+	mux.HandleFunc("/stats", func(w http.ResponseWriter, r *http.Request) {
+		w.Header().Set("Content-Type", "application/json")
+		fmt.Fprintf(w, "{\"pixels_in\":%d,\"pixels_merged\":%d,\"pixels_out\":%d}\n",
+			relay.stats.PixelsIn.Load(), relay.stats.PixelsMerged.Load(), relay.stats.PixelsOut.Load())
+	})
 
 	// Print connection information
 	localIPs := getLocalIPs()
 	fmt.Println("Server started!")
-	fmt.Printf("- Local access: http://localhost%s\n", serverAddr)
+	fmt.Printf("- Local access: http://localhost%s\n", *serverAddr)
 
 	for _, ip := range localIPs {
-		fmt.Printf("- Network access: http://%s%s\n", ip, serverAddr)
-		fmt.Printf("- WebSocket access: ws://%s%s/ws\n", ip, serverAddr)
+		fmt.Printf("- Network access: http://%s%s\n", ip, *serverAddr)
+		fmt.Printf("- WebSocket access: ws://%s%s/ws\n", ip, *serverAddr)
 	}
 
 	fmt.Println("\nFor ESP32 auto-connect:")
 	for _, ip := range localIPs {
-		fmt.Printf("Edit ESP32 code to use: const char *SERVER_HOST = \"ws://%s%s/ws\";\n", ip, serverAddr)
+		fmt.Printf("Edit ESP32 code to use: const char *SERVER_HOST = \"ws://%s%s/ws\";\n", ip, *serverAddr)
 	}
 
 	// Start server
 	server := &http.Server{
-		Addr:         serverAddr,
+		Addr:         *serverAddr,
 		Handler:      mux,
 		ReadTimeout:  15 * time.Second,
 		WriteTimeout: 15 * time.Second,
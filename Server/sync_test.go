@@ -0,0 +1,286 @@
+package main
+
+import (
+	"encoding/binary"
+	"fmt"
+	"math/rand"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/gorilla/websocket"
+
+	"Server/firmware"
+)
+
+const (
+	retryWait    = 1200 * time.Millisecond // past PIXEL_SYNC_RETRY_MS in pixel_sync.h
+	convergeWait = 10 * time.Second
+)
+
+var startRelay sync.Once
+
+func testServer(t *testing.T) string {
+	startRelay.Do(func() { go relay.run() })
+	server := httptest.NewServer(http.HandlerFunc(handleConnections))
+	t.Cleanup(server.Close)
+	return "ws" + strings.TrimPrefix(server.URL, "http")
+}
+
+func dialTest(t *testing.T, url string) *websocket.Conn {
+	ws, _, err := websocket.DefaultDialer.Dial(url, nil)
+	if err != nil {
+		t.Fatalf("Error connecting to the relay: %v", err)
+	}
+	return ws
+}
+
+// A device running the firmware's receive path. While faulty is set, frames
+// from the relay are dropped and deltas swapped with the next frame. Lost
+// frames would never be counted against the credit, which assumes a reliable
+// link, so a faulty device doesn't grant any.
+type testDevice struct {
+	ws       *websocket.Conn
+	fw       *firmware.Display
+	mu       sync.Mutex
+	start    time.Time
+	faulty   atomic.Bool
+	credit   bool
+	drawRate int           // records drawn a second, 0 for no limit
+	read     chan struct{} // closed when the reader returns
+	polled   chan struct{} // closed when the poller returns
+}
+
+func newTestDevice(t *testing.T, url string, seed int64, faulty bool, drawRate int, stop <-chan struct{}) *testDevice {
+	d := &testDevice{ws: dialTest(t, url), fw: firmware.NewDisplay(), start: time.Now(), credit: !faulty,
+		drawRate: drawRate, read: make(chan struct{}), polled: make(chan struct{})}
+	d.faulty.Store(faulty)
+	go d.readLoop(rand.New(rand.NewSource(seed)))
+	go d.pollLoop(stop)
+	return d
+}
+
+func (d *testDevice) close() {
+	d.ws.Close()
+	<-d.read
+	<-d.polled
+	d.fw.Free()
+}
+
+func (d *testDevice) receive(msg []byte) {
+	d.mu.Lock()
+	d.fw.Receive(msg, uint32(time.Since(d.start).Milliseconds()))
+	d.mu.Unlock()
+}
+
+func (d *testDevice) readLoop(rng *rand.Rand) {
+	defer close(d.read)
+	var held []byte
+	for {
+		messageType, msg, err := d.ws.ReadMessage()
+		if err != nil {
+			return
+		}
+		if messageType != websocket.BinaryMessage {
+			continue
+		}
+		if d.faulty.Load() {
+			switch n := rng.Intn(10); {
+			case n == 0:
+				continue // Lost
+			case n == 1 && held == nil && msg[1] == pixelOpDelta:
+				held = msg // Delivered after the next one
+				continue
+			}
+		}
+		d.receive(msg)
+		if held != nil {
+			d.receive(held)
+			held = nil
+		}
+	}
+}
+
+// Draws everything queued and sends the firmware's requests, as server_task
+// and display_task do
+func (d *testDevice) pollLoop(stop <-chan struct{}) {
+	defer close(d.polled)
+	ticker := time.NewTicker(10 * time.Millisecond)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-stop:
+			return
+		case <-ticker.C:
+			max := canvasPixels * 64
+			if d.drawRate > 0 {
+				max = d.drawRate / 100
+			}
+			d.mu.Lock()
+			d.fw.Draw(max)
+			for req := d.fw.Request(); req != nil; req = d.fw.Request() {
+				if req[1] != pixelOpCredit || d.credit {
+					d.ws.WriteMessage(websocket.BinaryMessage, req)
+				}
+			}
+			d.mu.Unlock()
+		}
+	}
+}
+
+func (d *testDevice) canvas() [canvasPixels]uint16 {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+	return d.fw.Canvas()
+}
+
+// The relay's canvas, from the keyframe a new connection gets
+func relayCanvasForTest(t *testing.T, url string) [canvasPixels]uint16 {
+	ws := dialTest(t, url)
+	defer ws.Close()
+	var canvas [canvasPixels]uint16
+	for {
+		_, msg, err := ws.ReadMessage()
+		if err != nil {
+			t.Fatalf("Error reading the relay's keyframe: %v", err)
+		}
+		if len(msg) == keyframeSize && msg[1] == pixelOpKeyframe {
+			offset := pixelProtoHeaderSize + pixelProtoSeqSize
+			for i := range canvas {
+				canvas[i] = binary.LittleEndian.Uint16(msg[offset+i*2:])
+			}
+			return canvas
+		}
+	}
+}
+
+func batchMessage(pixels []pixelRecord) []byte {
+	var b strings.Builder
+	b.WriteString("batch;")
+	for i, p := range pixels {
+		if i > 0 {
+			b.WriteByte(';')
+		}
+		fmt.Fprintf(&b, "%d,%d,%x", p.x, p.y, p.color)
+	}
+	return []byte(b.String())
+}
+
+// size different pixels, in random colors
+func randomStroke(rng *rand.Rand, size int) []pixelRecord {
+	pixels := make([]pixelRecord, size)
+	for i, p := range rng.Perm(canvasPixels)[:size] {
+		// Color 1 is kept for the last stroke
+		pixels[i] = pixelRecord{uint8(p % canvasSize), uint8(p / canvasSize), uint16(2 + rng.Intn(0xFFFE))}
+	}
+	return pixels
+}
+
+func draw(t *testing.T, drawer *websocket.Conn, pixels []pixelRecord) {
+	if err := drawer.WriteMessage(websocket.TextMessage, batchMessage(pixels)); err != nil {
+		t.Fatalf("Error drawing: %v", err)
+	}
+}
+
+// Paints the whole canvas in a color nothing else uses, so the relay sends
+// one more delta, as large as they get, and waits for every device to end up
+// with the relay's canvas
+func expectConverged(t *testing.T, url string, drawer *websocket.Conn, devices []*testDevice) {
+	last := make([]pixelRecord, canvasPixels)
+	for i := range last {
+		last[i] = pixelRecord{uint8(i % canvasSize), uint8(i / canvasSize), 1}
+	}
+	draw(t, drawer, last)
+	time.Sleep(100 * time.Millisecond)
+	expected := relayCanvasForTest(t, url)
+
+	for i, d := range devices {
+		deadline := time.Now().Add(convergeWait)
+		for d.canvas() != expected {
+			if time.Now().After(deadline) {
+				canvas := d.canvas()
+				wrong := 0
+				for p := range canvas {
+					if canvas[p] != expected[p] {
+						wrong++
+					}
+				}
+				t.Fatalf("Device %d still has %d pixels that differ from the relay", i, wrong)
+			}
+			time.Sleep(20 * time.Millisecond)
+		}
+	}
+}
+
+// Devices that lose or reorder frames from the relay must still end up with
+// the relay's canvas. A lost delta is only noticed when the next one arrives,
+// so once the faults stop one more stroke is drawn, after the resync retry.
+func TestDevicesConvergeDespiteLostAndReorderedFrames(t *testing.T) {
+	url := testServer(t)
+	stop := make(chan struct{})
+	devices := make([]*testDevice, 4)
+	for i := range devices {
+		devices[i] = newTestDevice(t, url, int64(i+1), true, 0, stop)
+	}
+	defer func() {
+		close(stop)
+		for _, d := range devices {
+			d.close()
+		}
+	}()
+
+	drawer := dialTest(t, url)
+	defer drawer.Close()
+	rng := rand.New(rand.NewSource(42))
+	for n := 0; n < 300; n++ {
+		draw(t, drawer, randomStroke(rng, 1+rng.Intn(40)))
+		time.Sleep(5 * time.Millisecond)
+	}
+
+	time.Sleep(100 * time.Millisecond)
+	for _, d := range devices {
+		d.faulty.Store(false)
+	}
+	time.Sleep(retryWait)
+	expectConverged(t, url, drawer, devices)
+
+	gaps := uint32(0)
+	for _, d := range devices {
+		d.mu.Lock()
+		gaps += d.fw.Stats().Gaps
+		d.mu.Unlock()
+	}
+	if gaps == 0 {
+		t.Errorf("No device missed a delta, the faults didn't take effect")
+	}
+}
+
+// Devices that draw slower than the relay sends are paced by their credit.
+// Deltas that don't fit it are held back, and must still reach the device.
+func TestSlowDevicesConvergeWithinTheirCredit(t *testing.T) {
+	url := testServer(t)
+	stop := make(chan struct{})
+	devices := make([]*testDevice, 3)
+	for i := range devices {
+		devices[i] = newTestDevice(t, url, int64(i+1), false, 5000*(i+1), stop)
+	}
+	defer func() {
+		close(stop)
+		for _, d := range devices {
+			d.close()
+		}
+	}()
+
+	drawer := dialTest(t, url)
+	defer drawer.Close()
+	rng := rand.New(rand.NewSource(7))
+	for n := 0; n < 100; n++ {
+		draw(t, drawer, randomStroke(rng, 1+rng.Intn(canvasPixels)))
+		time.Sleep(20 * time.Millisecond)
+	}
+	expectConverged(t, url, drawer, devices)
+}
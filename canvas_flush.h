@@ -0,0 +1,138 @@
+#pragma once
+#include <string.h>
+#include "display.h"
+#include "pixel_protocol.h"
+
+// Pushes the dirty pixels of the Live Pixel canvas to a Display, upscaled to
+// CANVAS_PIXEL_SIZE. Each flush uses whichever needs fewer rectangles:
+// maximal same-color rectangles drawn with fill_rect, or mixed-color
+// rectangles streamed from the canvas. Solid brush stamps end up as one
+// fill, detailed full frames as a few blits.
+
+#define CANVAS_PIXEL_SIZE 4        // screen pixels per canvas pixel, each way
+#define CANVAS_MAX_FILL_RECTS 128  // fill_rect calls a flush may use
+
+struct CanvasRect {
+    uint8_t x, y, w, h;
+    uint16_t color;
+};
+
+// Scratch space for a flush, kept off the render task's stack
+struct CanvasFlush {
+    CanvasRect fill_rects[CANVAS_MAX_FILL_RECTS];
+    uint16_t line_buffer[PIXEL_CANVAS_SIZE * CANVAS_PIXEL_SIZE];  // one upscaled row, display byte order
+};
+
+inline uint32_t canvas_run_mask(int x, int w) {
+    return (w == PIXEL_CANVAS_SIZE) ? 0xFFFFFFFF : ((1UL << w) - 1) << x;
+}
+
+// Takes the next dirty run of row y from dirty and extends it down over the
+// rows below that have the whole run dirty. With same_color, the run and the
+// rows below must also hold a single color.
+inline CanvasRect canvas_take_dirty_rect(const uint16_t *canvas, uint32_t *dirty, int y, bool same_color) {
+    const uint16_t *row = canvas + y * PIXEL_CANVAS_SIZE;
+    const int x = __builtin_ctz(dirty[y]);
+    const uint16_t color = row[x];
+
+    int w = 1;
+    while (x + w < PIXEL_CANVAS_SIZE && (dirty[y] & (1UL << (x + w))) &&
+           (!same_color || row[x + w] == color)) {
+        w++;
+    }
+    const uint32_t run = canvas_run_mask(x, w);
+
+    int h = 1;
+    while (y + h < PIXEL_CANVAS_SIZE && (dirty[y + h] & run) == run) {
+        if (same_color) {
+            const uint16_t *below = canvas + (y + h) * PIXEL_CANVAS_SIZE + x;
+            int i = 0;
+            while (i < w && below[i] == color) i++;
+            if (i < w) break;
+        }
+        dirty[y + h] &= ~run;
+        h++;
+    }
+    dirty[y] &= ~run;
+
+    CanvasRect rect = {(uint8_t)x, (uint8_t)y, (uint8_t)w, (uint8_t)h, color};
+    return rect;
+}
+
+// Greedily merges the dirty pixels into maximal same-color rectangles. Returns
+// the number found, or -1 if more than limit are needed.
+inline int canvas_collect_fill_rects(const uint16_t *canvas, const uint32_t *dirty_in, CanvasRect *rects,
+                                     int limit) {
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+    memcpy(dirty, dirty_in, sizeof(dirty));
+
+    int count = 0;
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        while (dirty[y]) {
+            if (count == limit) return -1;
+            rects[count++] = canvas_take_dirty_rect(canvas, dirty, y, true);
+        }
+    }
+    return count;
+}
+
+inline int canvas_count_blit_rects(const uint16_t *canvas, const uint32_t *dirty_in) {
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+    memcpy(dirty, dirty_in, sizeof(dirty));
+
+    int count = 0;
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        while (dirty[y]) {
+            canvas_take_dirty_rect(canvas, dirty, y, false);
+            count++;
+        }
+    }
+    return count;
+}
+
+// Streams a canvas rectangle, each pixel repeated CANVAS_PIXEL_SIZE times
+// across and down. Returns the pixel bytes pushed.
+inline uint32_t canvas_push_rect(CanvasFlush *flush, Display *display, const uint16_t *canvas, CanvasRect rect) {
+    const int width = rect.w * CANVAS_PIXEL_SIZE;
+
+    display->set_window(rect.x * CANVAS_PIXEL_SIZE, rect.y * CANVAS_PIXEL_SIZE, width, rect.h * CANVAS_PIXEL_SIZE);
+    for (int row = rect.y; row < rect.y + rect.h; row++) {
+        const uint16_t *src = canvas + row * PIXEL_CANVAS_SIZE + rect.x;
+        for (int i = 0; i < rect.w; i++) {
+            const uint16_t color = (uint16_t)((src[i] >> 8) | (src[i] << 8));
+            uint16_t *dst = flush->line_buffer + i * CANVAS_PIXEL_SIZE;
+            for (int j = 0; j < CANVAS_PIXEL_SIZE; j++) dst[j] = color;
+        }
+        for (int line = 0; line < CANVAS_PIXEL_SIZE; line++) {
+            display->push_pixels(flush->line_buffer, width);
+        }
+    }
+    return width * rect.h * CANVAS_PIXEL_SIZE * sizeof(uint16_t);
+}
+
+// Draws the pixels set in dirty, bit x of row y. Returns the pixel bytes pushed.
+inline uint32_t canvas_flush(CanvasFlush *flush, Display *display, const uint16_t *canvas, const uint32_t *dirty_in) {
+    const int blit_count = canvas_count_blit_rects(canvas, dirty_in);
+    const int limit = blit_count < CANVAS_MAX_FILL_RECTS ? blit_count : CANVAS_MAX_FILL_RECTS;
+    const int fill_count = canvas_collect_fill_rects(canvas, dirty_in, flush->fill_rects, limit);
+    uint32_t bytes = 0;
+
+    if (fill_count >= 0) {
+        for (int i = 0; i < fill_count; i++) {
+            const CanvasRect &rect = flush->fill_rects[i];
+            display->fill_rect(rect.x * CANVAS_PIXEL_SIZE, rect.y * CANVAS_PIXEL_SIZE, rect.w * CANVAS_PIXEL_SIZE,
+                               rect.h * CANVAS_PIXEL_SIZE, rect.color);
+            bytes += rect.w * rect.h * CANVAS_PIXEL_SIZE * CANVAS_PIXEL_SIZE * sizeof(uint16_t);
+        }
+        return bytes;
+    }
+
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+    memcpy(dirty, dirty_in, sizeof(dirty));
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        while (dirty[y]) {
+            bytes += canvas_push_rect(flush, display, canvas, canvas_take_dirty_rect(canvas, dirty, y, false));
+        }
+    }
+    return bytes;
+}
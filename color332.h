@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+// RGB332 to RGB565 expansion, bit for bit as TFT_eSPI's color8to16(), so 8-bit
+// sprites look the same whether the renderer or TFT_eSPI pushes them.
+
+inline uint16_t color332_to_565(uint8_t c) {
+    static const uint8_t blue[] = {0, 11, 21, 31};
+    return (uint16_t)((c & 0xE0) << 8 | (c & 0xC0) << 5 | (c & 0x1C) << 6 | (c & 0x1C) << 3 | blue[c & 0x03]);
+}
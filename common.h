@@ -37,3 +37,9 @@ struct Position { int x; int y; };
 
 void show_menu();
 void draw_centered_text(const char *text, int y, uint16_t color, int size);
+
+#include "renderer.h"
+#include "game_loop.h"
+#include "task_stop.h"
+#include "trace.h"
+#include "text.h"
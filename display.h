@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// What the render task draws on. The firmware uses TftDisplay
+// (display_tft.h); FramebufferDisplay (display_framebuffer.h) draws into
+// memory on the host and counts what the same drawing would cost on the bus.
+//
+// Pixel buffers are RGB565 in display byte order (big-endian), the layout of
+// a 16-bit TFT_eSprite. Colors passed by value are native RGB565.
+
+class Display {
+public:
+    virtual ~Display() {}
+
+    // Brackets a batch of drawing in one bus transaction
+    virtual void begin_write() = 0;
+    virtual void end_write() = 0;
+
+    virtual void fill_rect(int x, int y, int w, int h, uint16_t color) = 0;
+    // bg == color draws without a background
+    virtual void draw_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size) = 0;
+
+    // Streams count pixels into the window set by set_window, row by row
+    virtual void set_window(int x, int y, int w, int h) = 0;
+    virtual void push_pixels(const uint16_t *pixels, uint32_t count) = 0;
+    // stride is the number of pixels between the starts of two source rows
+    virtual void push_image(int x, int y, int w, int h, const uint16_t *pixels, int stride) = 0;
+
+    // Starts a transfer and returns. pixels must stay unchanged until wait_dma()
+    virtual void push_image_dma(int x, int y, int w, int h, uint16_t *pixels) = 0;
+    virtual void wait_dma() = 0;
+};
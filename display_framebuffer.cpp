@@ -0,0 +1,89 @@
+#include "display_framebuffer.h"
+#include <string.h>
+
+// Classic 6x8 GLCD font cell, scaled by the text size
+const int GLYPH_WIDTH = 6;
+const int GLYPH_HEIGHT = 8;
+
+FramebufferDisplay::FramebufferDisplay(int width, int height, uint32_t spi_hz)
+    : width(width), height(height), spi_hz(spi_hz), framebuffer(width * height, 0), counters(),
+      win_x(0), win_y(0), win_w(0), win_h(0), cursor_x(0), cursor_y(0) {}
+
+void FramebufferDisplay::set_window(int x, int y, int w, int h) {
+    win_x = x;
+    win_y = y;
+    win_w = w;
+    win_h = h;
+    cursor_x = 0;
+    cursor_y = 0;
+
+    counters.windows++;
+    counters.spi_bytes += DISPLAY_WINDOW_BYTES;
+}
+
+// The panel wraps to the start of the window once it is full
+void FramebufferDisplay::write_pixel(uint16_t color) {
+    if (win_w <= 0 || win_h <= 0) return;
+
+    const int x = win_x + cursor_x;
+    const int y = win_y + cursor_y;
+    if (x >= 0 && x < width && y >= 0 && y < height) {
+        framebuffer[y * width + x] = color;
+    }
+
+    if (++cursor_x == win_w) {
+        cursor_x = 0;
+        if (++cursor_y == win_h) cursor_y = 0;
+    }
+    counters.pixels++;
+    counters.spi_bytes += sizeof(uint16_t);
+}
+
+void FramebufferDisplay::push_pixels(const uint16_t *pixels, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        write_pixel((uint16_t)((pixels[i] >> 8) | (pixels[i] << 8)));
+    }
+}
+
+void FramebufferDisplay::push_image(int x, int y, int w, int h, const uint16_t *pixels, int stride) {
+    set_window(x, y, w, h);
+    for (int row = 0; row < h; row++) {
+        push_pixels(pixels + row * stride, w);
+    }
+}
+
+void FramebufferDisplay::fill_rect(int x, int y, int w, int h, uint16_t color) {
+    set_window(x, y, w, h);
+    for (int i = 0; i < w * h; i++) {
+        write_pixel(color);
+    }
+}
+
+// Draws without counting, for what the panel draws but isn't costed pixel by pixel
+void FramebufferDisplay::fill_uncounted(int x, int y, int w, int h, uint16_t color) {
+    for (int row = y < 0 ? 0 : y; row < y + h && row < height; row++) {
+        for (int col = x < 0 ? 0 : x; col < x + w && col < width; col++) {
+            framebuffer[row * width + col] = color;
+        }
+    }
+}
+
+void FramebufferDisplay::draw_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size) {
+    const int cell_w = GLYPH_WIDTH * size;
+    const int cell_h = GLYPH_HEIGHT * size;
+
+    for (size_t i = 0; i < strlen(text); i++) {
+        const int cell_x = x + (int)i * cell_w;
+        if (bg != color) {
+            fill_rect(cell_x, y, cell_w, cell_h, bg);
+        } else {
+            // Transparent glyphs go out as short runs, one window per scaled glyph row and about half the cell lit
+            counters.windows += GLYPH_HEIGHT;
+            counters.pixels += cell_w * cell_h / 2;
+            counters.spi_bytes += GLYPH_HEIGHT * DISPLAY_WINDOW_BYTES + cell_w * cell_h / 2 * sizeof(uint16_t);
+        }
+        if (text[i] != ' ') {
+            fill_uncounted(cell_x, y, (GLYPH_WIDTH - 1) * size, (GLYPH_HEIGHT - 1) * size, color);
+        }
+    }
+}
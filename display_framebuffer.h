@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "display.h"
+
+// In-memory display for host benchmarks. Drawing lands in a native RGB565
+// framebuffer and is counted as the bytes the same calls would clock out to
+// an ST7735, so drawing strategies can be compared by bus cost without the
+// hardware. Text is not rasterized: each character is drawn as a solid block
+// in its cell, and costed as the glyph would be.
+
+#define DISPLAY_SPI_HZ 40000000    // SPI_FREQUENCY in User_Setup.h
+#define DISPLAY_WINDOW_BYTES 11    // CASET, RASET and RAMWR with their arguments
+
+struct DisplayCounters {
+    uint32_t transactions;  // begin_write() calls
+    uint32_t windows;       // address windows set
+    uint64_t pixels;        // pixels written to the panel
+    uint64_t spi_bytes;     // commands, arguments and pixel data
+};
+
+class FramebufferDisplay : public Display {
+public:
+    FramebufferDisplay(int width, int height, uint32_t spi_hz = DISPLAY_SPI_HZ);
+
+    void begin_write() override { counters.transactions++; }
+    void end_write() override {}
+
+    void fill_rect(int x, int y, int w, int h, uint16_t color) override;
+    void draw_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size) override;
+
+    void set_window(int x, int y, int w, int h) override;
+    void push_pixels(const uint16_t *pixels, uint32_t count) override;
+    void push_image(int x, int y, int w, int h, const uint16_t *pixels, int stride) override;
+
+    void push_image_dma(int x, int y, int w, int h, uint16_t *pixels) override { push_image(x, y, w, h, pixels, w); }
+    void wait_dma() override {}
+
+    uint16_t pixel(int x, int y) const { return framebuffer[y * width + x]; }
+    const DisplayCounters &get_counters() const { return counters; }
+    // Time the counted bytes take on the bus at spi_hz
+    double spi_seconds() const { return counters.spi_bytes * 8.0 / spi_hz; }
+    void reset_counters() { counters = DisplayCounters(); }
+
+private:
+    void write_pixel(uint16_t color);
+    void fill_uncounted(int x, int y, int w, int h, uint16_t color);
+
+    int width, height;
+    uint32_t spi_hz;
+    std::vector<uint16_t> framebuffer;
+    DisplayCounters counters;
+
+    // Current window and the next pixel push_pixels writes
+    int win_x, win_y, win_w, win_h;
+    int cursor_x, cursor_y;
+};
@@ -0,0 +1,25 @@
+#include "display_tft.h"
+
+void TftDisplay::draw_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size) {
+    tft.setTextSize(size);
+    tft.setTextColor(color, bg);
+    tft.setCursor(x, y);
+    tft.print(text);
+}
+
+void TftDisplay::push_image(int x, int y, int w, int h, const uint16_t *pixels, int stride) {
+    if (stride == w) {
+        tft.pushImage(x, y, w, h, pixels);
+        return;
+    }
+
+    tft.setAddrWindow(x, y, w, h);
+    for (int row = 0; row < h; row++) {
+        tft.pushPixels(pixels + row * stride, w);
+    }
+}
+
+void TftDisplay::push_image_dma(int x, int y, int w, int h, uint16_t *pixels) {
+    // Waits for the previous transfer, wait_dma() or endWrite() for this one
+    tft.pushImageDMA(x, y, w, h, pixels);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include "display.h"
+
+class TftDisplay : public Display {
+public:
+    explicit TftDisplay(TFT_eSPI &tft) : tft(tft) {}
+
+    void begin_write() override { tft.startWrite(); }
+    void end_write() override { tft.endWrite(); }
+
+    void fill_rect(int x, int y, int w, int h, uint16_t color) override { tft.fillRect(x, y, w, h, color); }
+    void draw_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size) override;
+
+    void set_window(int x, int y, int w, int h) override { tft.setAddrWindow(x, y, w, h); }
+    void push_pixels(const uint16_t *pixels, uint32_t count) override { tft.pushPixels(pixels, count); }
+    void push_image(int x, int y, int w, int h, const uint16_t *pixels, int stride) override;
+
+    void push_image_dma(int x, int y, int w, int h, uint16_t *pixels) override;
+    void wait_dma() override { tft.dmaWait(); }
+
+private:
+    TFT_eSPI &tft;
+};
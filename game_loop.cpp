@@ -0,0 +1,101 @@
+#include "common.h"
+#include "game_loop.h"
+
+TickType_t ms_to_ticks(uint32_t ms) {
+    const TickType_t ticks = pdMS_TO_TICKS(ms);
+    return ticks > 0 ? ticks : 1;
+}
+
+void game_loop_start(GameLoop *loop, uint32_t step_ms, uint32_t render_ms) {
+    memset(loop, 0, sizeof(*loop));
+    loop->step_ticks = ms_to_ticks(step_ms);
+    loop->render_ticks = render_ms > 0 ? ms_to_ticks(render_ms) : 0;
+    loop->frame_us_min = UINT32_MAX;
+    loop->last_wake = xTaskGetTickCount();
+    loop->last_render = loop->last_wake - loop->render_ticks;
+}
+
+void game_loop_set_step(GameLoop *loop, uint32_t step_ms) {
+    loop->step_ticks = ms_to_ticks(step_ms);
+}
+
+bool game_loop_wait(GameLoop *loop, const TaskStop *stop) {
+    const TickType_t now = xTaskGetTickCount();
+    const TickType_t late = now - (loop->last_wake + loop->step_ticks);
+
+    // vTaskDelayUntil returns at once for a missed deadline, which replays
+    // missed steps back to back. Past the catch-up limit drop them instead.
+    loop->behind = false;
+    if ((int32_t)late > 0) {
+        loop->overruns++;
+        if (late >= GAME_LOOP_MAX_CATCH_UP * loop->step_ticks) {
+            loop->dropped_steps += late / loop->step_ticks;
+            loop->last_wake = now - loop->step_ticks;
+        } else {
+            loop->behind = late >= loop->step_ticks;  // more steps are due after this one
+        }
+    }
+
+    // Steps longer than the poll interval, a slow snake's, are waited out in slices
+    const TickType_t poll = ms_to_ticks(TASK_STOP_POLL_MS);
+    const TickType_t deadline = loop->last_wake + loop->step_ticks;
+    while (!task_stop_requested(stop)) {
+        if ((int32_t)(deadline - xTaskGetTickCount()) <= (int32_t)poll) {
+            vTaskDelayUntil(&loop->last_wake, loop->step_ticks);
+            loop->frame_start_us = micros();
+            return true;
+        }
+        vTaskDelay(poll);
+    }
+    return false;
+}
+
+bool game_loop_render_due(GameLoop *loop) {
+    if (loop->behind) {
+        return false;
+    }
+    if (loop->last_wake - loop->last_render < loop->render_ticks) {
+        return false;
+    }
+
+    loop->last_render = loop->last_wake;
+    return true;
+}
+
+void game_loop_frame_done(GameLoop *loop) {
+    const uint32_t frame_us = micros() - loop->frame_start_us;
+    const uint32_t bucket = min(frame_us / GAME_LOOP_HIST_US, (uint32_t)GAME_LOOP_HIST_BUCKETS - 1);
+
+    loop->frames++;
+    loop->frame_us_total += frame_us;
+    loop->frame_us_min = min(loop->frame_us_min, frame_us);
+    loop->frame_us_max = max(loop->frame_us_max, frame_us);
+    loop->histogram[bucket]++;
+}
+
+GameLoopStats game_loop_get_stats(const GameLoop *loop) {
+    GameLoopStats stats = {};
+    stats.frames = loop->frames;
+    stats.overruns = loop->overruns;
+    stats.dropped_steps = loop->dropped_steps;
+    if (stats.frames == 0) {
+        return stats;
+    }
+
+    stats.frame_us_min = loop->frame_us_min;
+    stats.frame_us_max = loop->frame_us_max;
+    stats.frame_us_mean = loop->frame_us_total / stats.frames;
+
+    // Smallest bucket bound with at least 99% of the frames at or below it
+    const uint32_t target = stats.frames - stats.frames / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < GAME_LOOP_HIST_BUCKETS; i++) {
+        seen += loop->histogram[i];
+        if (seen >= target) {
+            stats.frame_us_p99 = i == GAME_LOOP_HIST_BUCKETS - 1 ? stats.frame_us_max
+                                                                 : (i + 1) * GAME_LOOP_HIST_US;
+            break;
+        }
+    }
+    return stats;
+}
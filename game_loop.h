@@ -0,0 +1,58 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "task_stop.h"
+
+// Fixed-timestep loop shared by the games. Steps are scheduled with
+// vTaskDelayUntil from the previous step's deadline, so the time spent
+// simulating, rendering or waiting on a mutex does not drift the tick rate.
+//
+//   game_loop_start(&loop, STEP_MS, RENDER_MS);
+//   while (game_loop_wait(&loop, &stop)) {
+//       step();
+//       if (game_loop_render_due(&loop)) render();
+//       game_loop_frame_done(&loop);
+//   }
+
+#define GAME_LOOP_MAX_CATCH_UP 4   // steps run back to back before the backlog is dropped
+#define GAME_LOOP_HIST_BUCKETS 128
+#define GAME_LOOP_HIST_US 128      // histogram bucket width, the last bucket takes everything above
+
+struct GameLoopStats {
+    uint32_t frames;
+    uint32_t overruns;       // steps that started after their deadline
+    uint32_t dropped_steps;  // steps skipped because the loop fell too far behind
+    uint32_t frame_us_min;   // step plus render time
+    uint32_t frame_us_mean;
+    uint32_t frame_us_p99;   // rounded up to the histogram bucket
+    uint32_t frame_us_max;
+};
+
+struct GameLoop {
+    TickType_t step_ticks;
+    TickType_t render_ticks;  // 0 renders after every step
+    TickType_t last_wake;
+    TickType_t last_render;
+    bool behind;
+    uint32_t frame_start_us;
+
+    uint32_t frames;
+    uint32_t overruns;
+    uint32_t dropped_steps;
+    uint32_t frame_us_min;
+    uint32_t frame_us_max;
+    uint64_t frame_us_total;
+    uint32_t histogram[GAME_LOOP_HIST_BUCKETS];
+};
+
+void game_loop_start(GameLoop *loop, uint32_t step_ms, uint32_t render_ms);
+// Takes effect from the next step
+void game_loop_set_step(GameLoop *loop, uint32_t step_ms);
+// Blocks until the next step is due. Checks stop at least every
+// TASK_STOP_POLL_MS while waiting, and returns false once it is requested.
+bool game_loop_wait(GameLoop *loop, const TaskStop *stop);
+// False while catching up, and until render_ms has passed since the last render
+bool game_loop_render_due(GameLoop *loop);
+void game_loop_frame_done(GameLoop *loop);
+// Can be called from any task; values may be one frame apart
+GameLoopStats game_loop_get_stats(const GameLoop *loop);
@@ -0,0 +1,126 @@
+#include "input.h"
+#include <freertos/timers.h>
+
+struct InputSubscriber {
+    QueueHandle_t queue;
+    int state;
+    uint16_t buttons;
+};
+
+const uint8_t BUTTON_PINS[INPUT_BUTTON_COUNT] = {BTN_UP, BTN_LEFT, BTN_DOWN, BTN_RIGHT, BTN_A, BTN_B, BTN_ALT};
+
+static InputSubscriber subscribers[INPUT_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+
+static TimerHandle_t debounce_timer;
+static TimerHandle_t repeat_timer;
+
+// Debounced state, only written by the timer callbacks
+static volatile uint16_t buttons_down = 0;
+static uint32_t press_time_us[INPUT_BUTTON_COUNT];
+
+// First edge since the button was last stable, written by the ISR
+static volatile uint32_t edge_time_us[INPUT_BUTTON_COUNT];
+static volatile uint16_t edge_pending = 0;
+static portMUX_TYPE edge_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void post_event(uint8_t button, uint8_t type, uint32_t time_us) {
+    InputEvent event = {button, type, time_us};
+
+    for (int i = 0; i < subscriber_count; i++) {
+        const InputSubscriber &sub = subscribers[i];
+        if ((sub.buttons & INPUT_MASK(button)) &&
+            (sub.state == INPUT_ANY_STATE || sub.state == current_state)) {
+            xQueueSend(sub.queue, &event, 0);  // A full queue drops the event
+        }
+    }
+}
+
+void IRAM_ATTR input_edge_ISR(void *arg) {
+    const uint8_t button = (uint8_t)(uintptr_t)arg;
+    TRACE_INSTANT(TRACE_INPUT_EDGE, button);
+
+    portENTER_CRITICAL_ISR(&edge_lock);
+    if (!(edge_pending & INPUT_MASK(button))) {
+        edge_time_us[button] = micros();
+        edge_pending |= INPUT_MASK(button);
+    }
+    portEXIT_CRITICAL_ISR(&edge_lock);
+
+    // Restarted by every bounce, so it fires once the pins have settled
+    BaseType_t woken = pdFALSE;
+    xTimerResetFromISR(debounce_timer, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void debounce_callback(TimerHandle_t timer) {
+    for (uint8_t button = 0; button < INPUT_BUTTON_COUNT; button++) {
+        const bool down = !digitalRead(BUTTON_PINS[button]);
+        const bool was_down = buttons_down & INPUT_MASK(button);
+
+        portENTER_CRITICAL(&edge_lock);
+        const uint32_t edge_us = edge_time_us[button];
+        edge_pending &= ~INPUT_MASK(button);
+        portEXIT_CRITICAL(&edge_lock);
+
+        if (down == was_down) continue;  // A bounce that settled back
+
+        if (down) {
+            buttons_down |= INPUT_MASK(button);
+            press_time_us[button] = edge_us;
+            post_event(button, INPUT_PRESS, edge_us);
+        } else {
+            buttons_down &= ~INPUT_MASK(button);
+            post_event(button, INPUT_RELEASE, edge_us);
+        }
+    }
+
+    if (buttons_down && !xTimerIsTimerActive(repeat_timer)) {
+        xTimerStart(repeat_timer, 0);
+    }
+}
+
+void repeat_callback(TimerHandle_t timer) {
+    if (!buttons_down) {
+        xTimerStop(repeat_timer, 0);
+        return;
+    }
+
+    const uint32_t now = micros();
+    for (uint8_t button = 0; button < INPUT_BUTTON_COUNT; button++) {
+        if (!(buttons_down & INPUT_MASK(button))) continue;
+        if (now - press_time_us[button] < INPUT_REPEAT_DELAY_MS * 1000UL) continue;
+
+        post_event(button, INPUT_REPEAT, now);
+    }
+}
+
+void input_init() {
+    debounce_timer = xTimerCreate("InputDebounce", pdMS_TO_TICKS(INPUT_DEBOUNCE_MS), pdFALSE, NULL,
+                                  debounce_callback);
+    repeat_timer = xTimerCreate("InputRepeat", pdMS_TO_TICKS(INPUT_REPEAT_INTERVAL_MS), pdTRUE, NULL,
+                                repeat_callback);
+
+    for (uint8_t button = 0; button < INPUT_BUTTON_COUNT; button++) {
+        pinMode(BUTTON_PINS[button], INPUT_PULLUP);
+        attachInterruptArg(digitalPinToInterrupt(BUTTON_PINS[button]), input_edge_ISR,
+                           (void *)(uintptr_t)button, CHANGE);
+    }
+}
+
+QueueHandle_t input_subscribe(int state, uint16_t buttons) {
+    if (subscriber_count == INPUT_MAX_SUBSCRIBERS) {
+        return NULL;
+    }
+
+    InputSubscriber &sub = subscribers[subscriber_count];
+    sub.queue = xQueueCreate(INPUT_QUEUE_LENGTH, sizeof(InputEvent));
+    sub.state = state;
+    sub.buttons = buttons;
+    subscriber_count++;
+    return sub.queue;
+}
+
+void input_flush(QueueHandle_t queue) { xQueueReset(queue); }
+
+bool input_is_down(uint8_t button) { return buttons_down & INPUT_MASK(button); }
@@ -0,0 +1,38 @@
+#pragma once
+#include "common.h"
+#include <freertos/queue.h>
+
+// Buttons raise GPIO interrupts; a timer reads them once they have been
+// stable for INPUT_DEBOUNCE_MS and posts press, release and repeat events to
+// the queues of the apps that subscribed to them. Apps block on their queue
+// instead of polling the pins.
+
+#define INPUT_DEBOUNCE_MS 20
+#define INPUT_REPEAT_DELAY_MS 400    // held this long before the first repeat
+#define INPUT_REPEAT_INTERVAL_MS 100
+#define INPUT_QUEUE_LENGTH 16
+#define INPUT_MAX_SUBSCRIBERS 8
+#define INPUT_ANY_STATE -1           // subscribe regardless of current_state
+
+enum InputButton : uint8_t {
+    INPUT_UP, INPUT_LEFT, INPUT_DOWN, INPUT_RIGHT, INPUT_A, INPUT_B, INPUT_ALT, INPUT_BUTTON_COUNT
+};
+
+#define INPUT_MASK(button) (1 << (button))
+#define INPUT_ARROWS (INPUT_MASK(INPUT_UP) | INPUT_MASK(INPUT_LEFT) | INPUT_MASK(INPUT_DOWN) | INPUT_MASK(INPUT_RIGHT))
+
+enum InputEventType : uint8_t { INPUT_PRESS, INPUT_RELEASE, INPUT_REPEAT };
+
+struct InputEvent {
+    uint8_t button;
+    uint8_t type;
+    uint32_t time_us;  // micros() of the first edge, or of the repeat
+};
+
+void input_init();
+// Events for buttons in the mask are queued while current_state is state.
+// Subscribe during setup, before events start flowing.
+QueueHandle_t input_subscribe(int state, uint16_t buttons);
+// Drops stale events, e.g. presses left over from the app's previous run
+void input_flush(QueueHandle_t queue);
+bool input_is_down(uint8_t button);
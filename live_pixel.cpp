@@ -1,180 +1,246 @@
 #include "live_pixel.h"
 #include "wifi_config.h"
+#include "pixel_protocol.h"
+#include "pixel_dispatch.h"
+#include "canvas_flush.h"
+#include "telemetry.h"
 
-String server_url;
+Text<TEXT_URL_MAX> server_url;
 
 using namespace websockets;
 WebsocketsClient client;
 
-QueueHandle_t pixelQueue;
-TaskHandle_t server_task_handle = NULL;
-TaskHandle_t display_task_handle = NULL;
+TaskStop server_stop;
+TaskStop display_stop;
 
-struct PixelData {
-    int x, y;
-    uint16_t color;
+struct CriticalSection {
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    void lock() { portENTER_CRITICAL(&mux); }
+    void unlock() { portEXIT_CRITICAL(&mux); }
 };
 
-String esp32_ip = "Connecting...";
+// Pixels from the network task (producer) to display_task (consumer)
+static PixelQueue<CriticalSection> pixel_queue;
+SemaphoreHandle_t pixel_ready;  // given after each publish
+
+Text<TEXT_IP_MAX> esp32_ip = {"Connecting...", 13};
 bool websocket_connected = false;
 unsigned long last_reconnect_attempt = 0;
 const unsigned long RECONNECT_INTERVAL = 5000;  // 5 seconds between reconnection attempts
+const TickType_t SERVER_POLL_TICKS = pdMS_TO_TICKS(10);  // the relay paces itself by our credits
 
 volatile bool initialization_complete = false;
 volatile bool exit_in_progress = false;
 
-void reset_screen() { tft.fillRect(0, 0, 128, 128, TFT_WHITE); }
+// Shadow copy of the 32x32 canvas. Network updates only write here, display_task
+// pushes the dirty pixels to the screen once per frame.
+const TickType_t CANVAS_FRAME_TICKS = pdMS_TO_TICKS(33);
+const int PIXEL_BATCH_SIZE = 128;
+
+static uint16_t canvas[PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE];
+static uint32_t canvas_dirty[PIXEL_CANVAS_SIZE];  // one bit per pixel, bit x of row y
+static portMUX_TYPE canvas_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile uint32_t spi_bytes_pushed = 0;
+static volatile uint32_t overdraws_avoided = 0;
+static volatile uint32_t flush_us_max = 0;
+
+// Where this canvas is in the relay's sequence. Only touched from
+// server_task, which runs the websocket callbacks.
+static PixelClient pixel_client;
+
+// Last writer wins: a pixel written again before the next flush costs no SPI traffic
+void canvas_set(int x, int y, uint16_t color) {
+    const uint32_t bit = 1UL << x;
+
+    portENTER_CRITICAL(&canvas_lock);
+    if (canvas_dirty[y] & bit) {
+        overdraws_avoided++;
+    } else if (canvas[y * PIXEL_CANVAS_SIZE + x] == color) {
+        overdraws_avoided++;  // Already on screen
+        portEXIT_CRITICAL(&canvas_lock);
+        return;
+    }
+    canvas[y * PIXEL_CANVAS_SIZE + x] = color;
+    canvas_dirty[y] |= bit;
+    portEXIT_CRITICAL(&canvas_lock);
+}
+
+void canvas_set_row(int y, const uint16_t *row) {
+    portENTER_CRITICAL(&canvas_lock);
+    overdraws_avoided += __builtin_popcount(canvas_dirty[y]);
+    memcpy(canvas + y * PIXEL_CANVAS_SIZE, row, PIXEL_CANVAS_SIZE * sizeof(uint16_t));
+    canvas_dirty[y] = 0xFFFFFFFF;
+    portEXIT_CRITICAL(&canvas_lock);
+}
+
+// Called by display_task, applies the coalesced pixels once the ring is drained
+void merge_overflow() {
+    static uint16_t pixels[PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE];
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+
+    if (!pixel_queue_take_overflow(&pixel_queue, pixels, dirty)) {
+        return;
+    }
 
-void draw_image(uint16_t *colorArray, int width, int height) {
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int index = y * width + x;
-            int px = x * 4;
-            int py = y * 4;
-            tft.fillRect(px, py, 4, 4, colorArray[index]);
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        const uint16_t *row = pixels + y * PIXEL_CANVAS_SIZE;
+        if (dirty[y] == 0xFFFFFFFF) {
+            canvas_set_row(y, row);
+            continue;
+        }
+        while (dirty[y]) {
+            const int x = __builtin_ctz(dirty[y]);
+            canvas_set(x, y, row[x]);
+            dirty[y] &= dirty[y] - 1;
         }
     }
 }
 
-void on_msg_callback(WebsocketsMessage message) {
-    String msg = message.data();
-
-    if (msg.startsWith("full,")) {
-        String pixelData = msg.substring(5);
-        uint16_t imageArray[1024];
-        int index = 0;
-
-        while (pixelData.length() > 0 && index < 1024) {
-            int commaPos = pixelData.indexOf(',');
-            String colorHex;
-
-            if (commaPos > 0) {
-                colorHex = pixelData.substring(0, commaPos);
-                pixelData = pixelData.substring(commaPos + 1);
-            } else {
-                colorHex = pixelData;
-                pixelData = "";
-            }
+// Publishes the staged pixels and wakes display_task
+void publish_pixels() {
+    pixel_queue_publish(&pixel_queue);
+    xSemaphoreGive(pixel_ready);
+}
 
-            imageArray[index] = (uint16_t)strtol(colorHex.c_str(), NULL, 16);
-            index++;
-        }
+void queue_pixel(int x, int y, uint16_t color) {
+    PixelRecord pixel = {(uint8_t)x, (uint8_t)y, color};
+    pixel_queue_push(&pixel_queue, pixel);
+}
+
+// Only call while the network and display tasks are stopped
+void reset_pixel_pipeline() {
+    pixel_queue_reset(&pixel_queue);
+}
+
+void reset_screen() {
+    // Coalesced, so pixels already in the ring are applied before the clear
+    pixel_queue_replace_canvas(&pixel_queue, nullptr);
+    xSemaphoreGive(pixel_ready);
+}
 
-        draw_image(imageArray, 32, 32);
+// Scratch space for flush_canvas, which only runs on the render task
+static CanvasFlush canvas_flush_scratch;
+
+// Pushes the dirty pixels to the display, see canvas_flush.h. Runs on the
+// render task, which holds the bus.
+void flush_canvas(void *) {
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+    bool any_dirty = false;
+
+    portENTER_CRITICAL(&canvas_lock);
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        dirty[y] = canvas_dirty[y];
+        canvas_dirty[y] = 0;
+        any_dirty |= dirty[y] != 0;
+    }
+    portEXIT_CRITICAL(&canvas_lock);
+
+    if (!any_dirty) {
         return;
     }
 
-    // Static buffer for pixel data to avoid repeated memory allocation
-    static PixelData pixelBuffer[64];  // Fixed-size buffer for pixel data
+    // Pixels written during the flush are marked dirty again and go out next frame
+    spi_bytes_pushed += canvas_flush(&canvas_flush_scratch, render_display(), canvas, dirty);
+}
 
-    // Handle chunked batch updates (new optimized format)
-    if (msg.startsWith("chunk;")) {
-        // Format: "chunk;chunk_index;total_chunks;count;x1,y1,color1;x2,y2,color2;..."
-        int firstSemi = msg.indexOf(';');
-        int secondSemi = msg.indexOf(';', firstSemi + 1);
-        int thirdSemi = msg.indexOf(';', secondSemi + 1);
-        int fourthSemi = msg.indexOf(';', thirdSemi + 1);
+// Decodes a "full," hex payload row by row into the coalescing buffer
+void draw_full_frame(const char *p, const char *end) {
+    uint16_t row[PIXEL_CANVAS_SIZE];
 
-        if (firstSemi < 0 || secondSemi < 0 || thirdSemi < 0 || fourthSemi < 0) {
-            return;  // Invalid format
+    pixel_queue_publish(&pixel_queue);
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        p = pixel_text_decode_row(p, end, row, PIXEL_CANVAS_SIZE);
+        if (!p) {
+            break;  // Truncated frame, keep the rows decoded so far
         }
+        pixel_queue_coalesce_row(&pixel_queue, y, row);
+    }
+}
 
-        // Parse chunk metadata
-        int chunkIndex = msg.substring(firstSemi + 1, secondSemi).toInt();
-        int totalChunks = msg.substring(secondSemi + 1, thirdSemi).toInt();
-        int chunkSize = msg.substring(thirdSemi + 1, fourthSemi).toInt();
-        String pixelData = msg.substring(fourthSemi + 1);
-
-        // Process pixels in this chunk
-        int pixelCount = 0;
-
-        // Parse all pixels in this chunk
-        while (pixelData.length() > 0 && pixelCount < chunkSize && pixelCount < 64) {
-            int semicolonPos = pixelData.indexOf(';');
-            String pixelInfo;
-
-            if (semicolonPos > 0) {
-                pixelInfo = pixelData.substring(0, semicolonPos);
-                pixelData = pixelData.substring(semicolonPos + 1);
-            } else {
-                pixelInfo = pixelData;
-                pixelData = "";
-            }
+// Queues the records of a binary frame straight from the message buffer
+void queue_binary_frame(const uint8_t *buf, size_t len) {
+    PixelFrame frame;
+    if (!pixel_frame_parse(buf, len, &frame)) {
+        return;  // Unknown version or truncated frame
+    }
 
-            // Process individual pixel
-            int x, y;
-            uint16_t colorRGB565;
-            sscanf(pixelInfo.c_str(), "%d,%d,%hx", &x, &y, &colorRGB565);
-
-            if (x >= 0 && x < 32 && y >= 0 && y < 32) {
-                // Store in our buffer
-                pixelBuffer[pixelCount].x = x;
-                pixelBuffer[pixelCount].y = y;
-                pixelBuffer[pixelCount].color = colorRGB565;
-                pixelCount++;
-            }
+    pixel_client_dispatch(&pixel_client, &pixel_queue, frame, millis());
+}
+
+// Asks the relay for what this canvas missed and grants it the room left in
+// the pixel queue, from server_task
+void send_requests() {
+    uint8_t request[PIXEL_CLIENT_REQUEST_MAX];
+    size_t len = pixel_client_write_resync(&pixel_client, request);
+    if (len > 0) {
+        client.sendBinary((const char *)request, len);
+    }
+
+    len = pixel_client_write_credit(&pixel_client, pixel_queue_free_records(&pixel_queue), request);
+    if (len > 0) {
+        client.sendBinary((const char *)request, len);
+    }
+}
+
+// Queues up to count ';'-separated "x,y,color" records, parsed in place
+void queue_text_pixels(const char *p, const char *end, int count) {
+    int x, y;
+    uint16_t colorRGB565;
+
+    while (count > 0 && p < end) {
+        p = pixel_text_parse_record(p, end, &x, &y, &colorRGB565);
+        if (!p) {
+            return;  // Malformed record, drop the rest of the message
         }
 
-        // Process all pixels directly to screen for better performance
-        for (int i = 0; i < pixelCount; i++) {
-            int px = pixelBuffer[i].x * 4;
-            int py = pixelBuffer[i].y * 4;
-            tft.fillRect(px, py, 4, 4, pixelBuffer[i].color);
+        if (pixel_in_canvas(x, y)) {
+            queue_pixel(x, y, colorRGB565);
         }
+        count--;
+    }
+}
 
+void handle_message(const std::string &raw, bool binary) {
+    if (binary) {
+        queue_binary_frame((const uint8_t *)raw.data(), raw.size());
         return;
     }
 
-    // Handle compressed batch pixel updates (legacy support)
-    if (msg.startsWith("compressed;")) {
-        // Format: "compressed;count;x1,y1,color1;x2,y2,color2;..."
-        String countStr = msg.substring(11, msg.indexOf(';', 11));
-        int expectedCount = countStr.toInt();
-        String batchData = msg.substring(msg.indexOf(';', 11) + 1);
-
-        // Limit the number of pixels we process to avoid memory issues
-        const int maxPixels = 64;
-        int pixelCount = 0;
-
-        // Parse pixels up to our buffer size
-        while (batchData.length() > 0 && pixelCount < maxPixels && pixelCount < expectedCount) {
-            int semicolonPos = batchData.indexOf(';');
-            String pixelInfo;
-
-            if (semicolonPos > 0) {
-                pixelInfo = batchData.substring(0, semicolonPos);
-                batchData = batchData.substring(semicolonPos + 1);
-            } else {
-                pixelInfo = batchData;
-                batchData = "";
-            }
+    const char *msg = raw.c_str();
+    const char *end = msg + raw.size();
 
-            // Process individual pixel
-            int x, y;
-            uint16_t colorRGB565;
-            sscanf(pixelInfo.c_str(), "%d,%d,%hx", &x, &y, &colorRGB565);
-
-            if (x >= 0 && x < 32 && y >= 0 && y < 32) {
-                // Store in our buffer
-                pixelBuffer[pixelCount].x = x;
-                pixelBuffer[pixelCount].y = y;
-                pixelBuffer[pixelCount].color = colorRGB565;
-                pixelCount++;
-            }
-        }
+    if (strncmp(msg, "full,", 5) == 0) {
+        draw_full_frame(msg + 5, end);
+        return;
+    }
 
-        // Process all pixels directly to screen
-        for (int i = 0; i < pixelCount; i++) {
-            int px = pixelBuffer[i].x * 4;
-            int py = pixelBuffer[i].y * 4;
-            tft.fillRect(px, py, 4, 4, pixelBuffer[i].color);
+    // Handle chunked batch updates
+    if (strncmp(msg, "chunk;", 6) == 0) {
+        // Format: "chunk;chunk_index;total_chunks;count;x1,y1,color1;x2,y2,color2;..."
+        const char *p = pixel_text_skip_fields(msg, end, 3);
+        int count;
+        if (!p || !(p = pixel_text_parse_int(p, end, &count)) || p >= end || *p != ';') {
+            return;  // Invalid format
         }
+        queue_text_pixels(p + 1, end, count);
+        return;
+    }
 
+    // Handle compressed batch pixel updates (legacy support)
+    if (strncmp(msg, "compressed;", 11) == 0) {
+        // Format: "compressed;count;x1,y1,color1;x2,y2,color2;..."
+        const char *p = pixel_text_skip_fields(msg, end, 1);
+        int count;
+        if (!p || !(p = pixel_text_parse_int(p, end, &count)) || p >= end || *p != ';') {
+            return;  // Invalid format
+        }
+        queue_text_pixels(p + 1, end, count);
         return;
     }
 
     // Legacy batch format support
-    if (msg.startsWith("batch;")) {
+    if (strncmp(msg, "batch;", 6) == 0) {
         // Just ignore old format batches, as we now use compressed format
         return;
     }
@@ -182,88 +248,82 @@ void on_msg_callback(WebsocketsMessage message) {
     // Handle single pixel updates and clear command
     int x, y;
     uint16_t colorRGB565;
-    sscanf(message.data().c_str(), "%d,%d,%hx", &x, &y, &colorRGB565);
+    if (!pixel_text_parse_record(msg, end, &x, &y, &colorRGB565)) {
+        return;
+    }
 
     if (x == -1 && y == -1) {
         reset_screen();
     }
 
-    if (x >= 0 && x < 32 && y >= 0 && y < 32) {
-        PixelData pixel = {x, y, colorRGB565};
-
-        if (uxQueueSpacesAvailable(pixelQueue) > 0) {
-            xQueueSend(pixelQueue, &pixel, portMAX_DELAY);
-        }
+    if (pixel_in_canvas(x, y)) {
+        queue_pixel(x, y, colorRGB565);
     }
 }
 
+void on_msg_callback(WebsocketsMessage message) {
+    TRACE_BEGIN(TRACE_WS_MESSAGE);
+    // rawData() references the library's buffer, data() would copy it into a String
+    handle_message(message.rawData(), message.isBinary());
+    publish_pixels();
+    TRACE_END(TRACE_WS_MESSAGE);
+}
+
 void on_events_callback(WebsocketsEvent event, String data) {
     if (event == WebsocketsEvent::ConnectionOpened) {
         websocket_connected = true;
-        tft.fillScreen(TFT_BLACK);
+        pixel_client_reset(&pixel_client);  // The relay sends a keyframe first
+        render_clear(TFT_BLACK);
         reset_screen();
         draw_centered_text("Connected!", 135, TFT_GREEN, 1);
-        String ipText = "IP: " + esp32_ip;
-        draw_centered_text(ipText.c_str(), 145, TFT_WHITE, 1);
+        Text<TEXT_LINE_MAX> line;
+        text_printf(&line, "IP: %s", esp32_ip.c_str());
+        draw_centered_text(line.c_str(), 145, TFT_WHITE, 1);
     } else if (event == WebsocketsEvent::ConnectionClosed) {
         websocket_connected = false;
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("Disconnected", 135, TFT_RED, 1);
         draw_centered_text("Reconnecting...", 145, TFT_WHITE, 1);
     }
 }
 
-void display_task(void *pvParameters) {
-    PixelData pixel;
-    PixelData pixelBatch[32];
-    int batchCount = 0;
-    TickType_t lastYield = xTaskGetTickCount();
-
-    while (true) {
-        batchCount = 0;
-        while (batchCount < 32 && xQueueReceive(pixelQueue, &pixelBatch[batchCount], 0) == pdTRUE) {
-            batchCount++;
+// Applies everything the network task has published to the canvas
+void apply_pixels() {
+    PixelRecord batch[PIXEL_BATCH_SIZE];
+    uint32_t count;
+
+    while ((count = pixel_ring_consume(&pixel_queue.ring, batch, PIXEL_BATCH_SIZE)) > 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            canvas_set(batch[i].x, batch[i].y, batch[i].color);
         }
+    }
 
-        if (batchCount > 0) {
-            int startX = pixelBatch[0].x;
-            int startY = pixelBatch[0].y;
-            uint16_t currentColor = pixelBatch[0].color;
-            int width = 1;
-
-            for (int i = 1; i < batchCount; i++) {
-                if (pixelBatch[i].y == startY && pixelBatch[i].x == startX + width && pixelBatch[i].color == currentColor) {
-                    width++;
-                } else {
-                    int px = startX * 4;
-                    int py = startY * 4;
-                    tft.fillRect(px, py, width * 4, 4, currentColor);
-
-                    startX = pixelBatch[i].x;
-                    startY = pixelBatch[i].y;
-                    currentColor = pixelBatch[i].color;
-                    width = 1;
-                }
-            }
+    merge_overflow();
+}
 
-            int px = startX * 4;
-            int py = startY * 4;
-            tft.fillRect(px, py, width * 4, 4, currentColor);
+void display_task(void *pvParameters) {
+    TickType_t next_flush = xTaskGetTickCount() + CANVAS_FRAME_TICKS;
+
+    while (!task_stop_requested(&display_stop)) {
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(now - next_flush) >= 0) {
+            uint32_t flush_start = micros();
+            TRACE_BEGIN(TRACE_CANVAS_FLUSH);
+            render_call(flush_canvas, NULL);
+            render_sync();
+            TRACE_END(TRACE_CANVAS_FLUSH);
+            uint32_t flush_us = micros() - flush_start;
+            if (flush_us > flush_us_max) flush_us_max = flush_us;
+            next_flush = now + CANVAS_FRAME_TICKS;
+            continue;
+        }
 
-            if (xTaskGetTickCount() - lastYield > pdMS_TO_TICKS(20)) {
-                vTaskDelay(1);
-                lastYield = xTaskGetTickCount();
-            }
-        } else {
-            if (xQueueReceive(pixelQueue, &pixel, pdMS_TO_TICKS(20))) {
-                int px = pixel.x * 4;
-                int py = pixel.y * 4;
-                tft.fillRect(px, py, 4, 4, pixel.color);
-            } else {
-                vTaskDelay(1);
-            }
+        // Apply published pixels to the canvas until the next frame is due
+        if (xSemaphoreTake(pixel_ready, next_flush - now) == pdTRUE) {
+            apply_pixels();
         }
     }
+    task_stop_exit(&display_stop);
 }
 
 void connect_server() {
@@ -274,7 +334,7 @@ void connect_server() {
     }
 
     if (WiFi.status() != WL_CONNECTED) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("WiFi Disconnected", 60, TFT_RED, 1);
         draw_centered_text("Press A to exit", 80, TFT_WHITE, 1);
         exit_requested = true;
@@ -287,16 +347,17 @@ void connect_server() {
     }
     last_reconnect_attempt = current_time;
 
-    tft.fillScreen(TFT_BLACK);
-    String ipText = "IP: " + esp32_ip;
-    draw_centered_text(ipText.c_str(), 135, TFT_WHITE, 1);
+    render_clear(TFT_BLACK);
+    Text<TEXT_LINE_MAX> line;
+    text_printf(&line, "IP: %s", esp32_ip.c_str());
+    draw_centered_text(line.c_str(), 135, TFT_WHITE, 1);
     draw_centered_text("Connect server...", 145, TFT_WHITE, 1);
 
-    server_url = get_ws_url();  // Get the configured WebSocket URL
+    get_ws_url(&server_url);  // Get the configured WebSocket URL
     bool connected = client.connect(server_url.c_str());
     
     if (!connected) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("Connect failed", 135, TFT_RED, 1);
         draw_centered_text("Press A to exit", 15, TFT_WHITE, 1);
         exit_requested = true;  // Request exit
@@ -307,21 +368,41 @@ void connect_server() {
 }
 
 void server_task(void *pvParameters) {
-    while (true) {
+    static char telemetry_line[TELEMETRY_LINE_MAX];
+    TickType_t last_telemetry = xTaskGetTickCount();
+
+    while (!task_stop_requested(&server_stop)) {
         if (client.available()) {
             client.poll();
+            send_requests();
+
+            // The client is only used from this task, so telemetry is sent from here too
+            TickType_t now = xTaskGetTickCount();
+            if (telemetry_websocket_enabled() && now - last_telemetry >= pdMS_TO_TICKS(TELEMETRY_PERIOD_MS)) {
+                const int prefix = snprintf(telemetry_line, sizeof(telemetry_line), "telemetry;");
+                telemetry_format(telemetry_line + prefix, sizeof(telemetry_line) - prefix);
+                client.send(telemetry_line);
+                last_telemetry = now;
+            }
         } else if (!websocket_connected && !exit_requested) {
             connect_server();
         }
 
-        vTaskDelay(pdMS_TO_TICKS(100));
+        vTaskDelay(SERVER_POLL_TICKS);
     }
+    task_stop_exit(&server_stop);
+}
+
+LivePixelStats live_pixel_get_stats() {
+    LivePixelStats stats = {spi_bytes_pushed, overdraws_avoided, pixel_queue.overflows,
+                            pixel_ring_used(&pixel_queue.ring), flush_us_max, pixel_client.sync.gaps};
+    return stats;
 }
 
 void live_pixel_init_queue() {
-    // Create a smaller queue size - we're now processing pixels in chunks
-    // so we don't need such a large queue
-    pixelQueue = xQueueCreate(256, sizeof(PixelData));
+    pixel_ready = xSemaphoreCreateBinary();
+    task_stop_init(&server_stop);
+    task_stop_init(&display_stop);
 }
 
 void live_pixel_launch_tasks() {
@@ -329,15 +410,15 @@ void live_pixel_launch_tasks() {
     exit_in_progress = false;
     websocket_connected = false;
     last_reconnect_attempt = 0;
-    esp32_ip = "Connecting...";
-    server_task_handle = NULL;
-    display_task_handle = NULL;
+    text_set(&esp32_ip, "Connecting...");
+    task_stop_reset(&server_stop);
+    task_stop_reset(&display_stop);
 
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
     draw_centered_text("Starting Live Pixel...", 40, TFT_WHITE, 1);
     
     if (WiFi.status() != WL_CONNECTED) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("No WiFi Connection", 40, TFT_YELLOW, 1);
         draw_centered_text("Live Pixel requires WiFi", 60, TFT_WHITE, 1);
         draw_centered_text("Go to WiFi Config", 80, TFT_WHITE, 1);
@@ -350,7 +431,7 @@ void live_pixel_launch_tasks() {
         return;
     }
 
-    xQueueReset(pixelQueue);
+    reset_pixel_pipeline();
 
     if (exit_in_progress) {
         live_pixel_exit();
@@ -358,11 +439,12 @@ void live_pixel_launch_tasks() {
     }
 
     // Get WiFi IP address
-    esp32_ip = WiFi.localIP().toString();
+    format_ip(&esp32_ip, WiFi.localIP());
     
-    tft.fillScreen(TFT_BLACK);
-    String ipText = "IP: " + esp32_ip;
-    draw_centered_text(ipText.c_str(), 135, TFT_WHITE, 1);
+    render_clear(TFT_BLACK);
+    Text<TEXT_LINE_MAX> line;
+    text_printf(&line, "IP: %s", esp32_ip.c_str());
+    draw_centered_text(line.c_str(), 135, TFT_WHITE, 1);
     draw_centered_text("Connect server...", 145, TFT_WHITE, 1);
 
     if (exit_in_progress) {
@@ -380,8 +462,8 @@ void live_pixel_launch_tasks() {
         return;
     }
 
-    xTaskCreatePinnedToCore(server_task, "server_task", 12288, NULL, 1, &server_task_handle, 0);
-    xTaskCreatePinnedToCore(display_task, "display_task", 8192, NULL, 1, &display_task_handle, 1);
+    xTaskCreatePinnedToCore(server_task, "server_task", 12288, NULL, 1, &server_stop.task, 0);
+    xTaskCreatePinnedToCore(display_task, "display_task", 8192, NULL, 1, &display_stop.task, 1);
 
     initialization_complete = true;
 }
@@ -394,19 +476,14 @@ void live_pixel_exit() {
         vTaskDelay(pdMS_TO_TICKS(100));
     }
 
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
 
-    if (server_task_handle != NULL) {
-        vTaskDelete(server_task_handle);
-        server_task_handle = NULL;
-    }
-
-    if (display_task_handle != NULL) {
-        vTaskDelete(display_task_handle);
-        display_task_handle = NULL;
-    }
+    // Both finish what they are doing first: the websocket client, the pixel
+    // queue and render_sync() are left in a consistent state
+    task_stop_join(&server_stop);
+    task_stop_join(&display_stop);
 
-    xQueueReset(pixelQueue);
+    reset_pixel_pipeline();
 
     if (websocket_connected) {
         client.close();
@@ -415,11 +492,11 @@ void live_pixel_exit() {
 
     websocket_connected = false;
     last_reconnect_attempt = 0;
-    esp32_ip = "Connecting...";
+    text_set(&esp32_ip, "Connecting...");
     initialization_complete = false;
     exit_in_progress = false;
 
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
     menu_requested = true;
     vTaskDelay(pdMS_TO_TICKS(50));
 }
@@ -3,6 +3,16 @@
 #include <WiFi.h>
 #include <ArduinoWebsockets.h>
 
+struct LivePixelStats {
+    uint32_t spi_bytes_pushed;   // bytes sent to the display by canvas flushes
+    uint32_t overdraws_avoided;  // pixel writes merged before reaching the display
+    uint32_t ring_overflows;     // times the pixel ring filled up and pixels were coalesced
+    uint32_t ring_used;          // records waiting in the pixel ring
+    uint32_t flush_us_max;       // slowest canvas flush, queueing included
+    uint32_t sync_gaps;          // relay deltas missed and recovered by a resync
+};
+
+LivePixelStats live_pixel_get_stats();
 void live_pixel_init_queue();
 void live_pixel_launch_tasks();
 void live_pixel_exit();
\ No newline at end of file
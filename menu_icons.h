@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+// Menu icons, drawn as 16x16 1-bit bitmaps and upscaled 4x at compile time
+// into the row-major, MSB-first layout drawBitmap() takes, so drawing one is
+// a single call with no per-pixel scaling on the device.
+
+#define MENU_ICON_SIZE 16
+#define MENU_ICON_SCALE 4
+#define MENU_ICON_SCALED (MENU_ICON_SIZE * MENU_ICON_SCALE)
+
+constexpr uint8_t snake_icon[32] = {
+	0xc0, 0x03, 0x80, 0x01, 0x00, 0xfc, 0x01, 0xfe, 0x01, 0xb6, 0x01, 0xb6, 0x01, 0xfc, 0x0c, 0xe2,
+	0x1e, 0xf0, 0x1f, 0x78, 0x4f, 0xbc, 0x7f, 0xfc, 0x7d, 0xfc, 0x38, 0xf8, 0x80, 0x01, 0xc0, 0x03
+};
+
+constexpr uint8_t pong_icon[32] = {
+	0xc0, 0x03, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0x00,
+	0x10, 0x48, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00, 0x80, 0x01, 0xc0, 0x03
+};
+
+constexpr uint8_t pixel_icon[32] = {
+	0xc0, 0x03, 0x9f, 0xf9, 0x20, 0x04, 0x40, 0x02, 0x40, 0x02, 0x44, 0x22, 0x44, 0x22, 0x44, 0x22,
+	0x44, 0x22, 0x40, 0x02, 0x40, 0x02, 0x60, 0x06, 0x7f, 0xfe, 0x3f, 0xfc, 0x9f, 0xf9, 0xc0, 0x03
+};
+
+constexpr uint8_t wifi_icon[32] = {
+	0xc0, 0x03, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0xe0, 0x08, 0x10, 0x13, 0xc8,
+	0x04, 0x20, 0x01, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0xc0, 0x03
+};
+
+struct ScaledIcon {
+    uint8_t bits[MENU_ICON_SCALED * MENU_ICON_SCALED / 8];
+};
+
+constexpr ScaledIcon scale_icon(const uint8_t (&icon)[32]) {
+    ScaledIcon scaled = {};
+    for (int y = 0; y < MENU_ICON_SCALED; y++) {
+        for (int x = 0; x < MENU_ICON_SCALED; x++) {
+            const int sx = x / MENU_ICON_SCALE;
+            const int sy = y / MENU_ICON_SCALE;
+            if (icon[sy * 2 + sx / 8] & (0x80 >> (sx % 8))) {
+                scaled.bits[y * (MENU_ICON_SCALED / 8) + x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+    }
+    return scaled;
+}
+
+// In menu order, see game_names
+constexpr ScaledIcon menu_icons[] = {
+    scale_icon(snake_icon), scale_icon(pong_icon), scale_icon(pixel_icon), scale_icon(wifi_icon)
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "pixel_protocol.h"
+#include "pixel_sync.h"
+#include "pixel_credit.h"
+#include "pixel_ring.h"
+
+// The device's side of a relay connection: what to do with each frame, and
+// the RESYNC and CREDIT requests to send back. Drawing is left to the caller,
+// so the host load test runs the same logic as live_pixel.cpp.
+
+#define PIXEL_CLIENT_REQUEST_MAX (PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE)
+
+struct PixelClient {
+    PixelSync sync;
+    PixelCredit credit;
+    bool resync_requested;
+};
+
+enum PixelClientAction : uint8_t {
+    PIXEL_CLIENT_IGNORE,
+    PIXEL_CLIENT_CLEAR,
+    PIXEL_CLIENT_KEYFRAME,  // replace the canvas with the frame's colors
+    PIXEL_CLIENT_RECORDS,   // queue the frame's pixel records
+};
+
+// On every (re)connection
+inline void pixel_client_reset(PixelClient *client) {
+    pixel_sync_reset(&client->sync);
+    pixel_credit_reset(&client->credit);
+    client->resync_requested = false;
+}
+
+inline PixelClientAction pixel_client_accept(PixelClient *client, const PixelFrame &frame, uint32_t now_ms) {
+    switch (frame.opcode) {
+        case PIXEL_OP_CLEAR:
+            return PIXEL_CLIENT_CLEAR;
+        case PIXEL_OP_KEYFRAME:
+            pixel_sync_keyframe(&client->sync, frame.seq);
+            return PIXEL_CLIENT_KEYFRAME;
+        case PIXEL_OP_DELTA: {
+            pixel_credit_receive(&client->credit, frame.count);
+            const PixelSyncAction action = pixel_sync_delta(&client->sync, frame.seq, now_ms);
+            if (action == PIXEL_SYNC_RESYNC) client->resync_requested = true;
+            return action == PIXEL_SYNC_APPLY ? PIXEL_CLIENT_RECORDS : PIXEL_CLIENT_IGNORE;
+        }
+        case PIXEL_OP_PATCH:
+            pixel_credit_receive(&client->credit, frame.count);
+            if (pixel_sync_patch(&client->sync, frame.base, frame.seq) != PIXEL_SYNC_APPLY) {
+                return PIXEL_CLIENT_IGNORE;
+            }
+            return PIXEL_CLIENT_RECORDS;
+        case PIXEL_OP_PIXELS:
+            return PIXEL_CLIENT_RECORDS;  // Unsequenced, from an older relay
+        default:
+            return PIXEL_CLIENT_IGNORE;
+    }
+}
+
+// Writes a pending RESYNC into buf. Returns its length, 0 if there is none.
+inline size_t pixel_client_write_resync(PixelClient *client, uint8_t *buf) {
+    if (!client->resync_requested) return 0;
+
+    client->resync_requested = false;
+    return pixel_frame_write_resync(buf, client->sync.synced ? client->sync.seq : 0);
+}
+
+// Writes a CREDIT grant for free_records of room in the pixel ring into buf
+// when one is due. Returns its length, 0 if none is.
+inline size_t pixel_client_write_credit(PixelClient *client, uint32_t free_records, uint8_t *buf) {
+    uint32_t limit;
+    if (!pixel_credit_update(&client->credit, free_records, free_records == PIXEL_RING_SIZE, &limit)) return 0;
+
+    return pixel_frame_write_credit(buf, limit);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+// Receive credits for the relay (see pixel_protocol.h). The limit is
+// cumulative, received records plus the room left in the pixel pipeline, so
+// a lost or repeated grant does no harm. A new grant is only sent once it
+// frees at least PIXEL_CREDIT_STEP records, to keep the upstream traffic low,
+// or once the pipeline is empty: the relay may be holding back a delta larger
+// than the credit it has left, and nothing else would move the limit on.
+
+#define PIXEL_CREDIT_STEP 256
+
+struct PixelCredit {
+    uint32_t received;    // DELTA and PATCH records since the connection opened
+    uint32_t advertised;  // the last limit sent
+    bool granted;         // one has been sent on this connection
+};
+
+inline void pixel_credit_reset(PixelCredit *credit) {
+    credit->received = 0;
+    credit->advertised = 0;
+    credit->granted = false;
+}
+
+inline void pixel_credit_receive(PixelCredit *credit, uint32_t records) {
+    credit->received += records;
+}
+
+// free_records is the room left in the pipeline, drained whether it is empty.
+// Returns true with the new limit in *limit when it is worth sending.
+inline bool pixel_credit_update(PixelCredit *credit, uint32_t free_records, bool drained, uint32_t *limit) {
+    const uint32_t next = credit->received + free_records;
+    const int32_t freed = (int32_t)(next - credit->advertised);
+    if (credit->granted && freed < PIXEL_CREDIT_STEP && !(drained && freed > 0)) {
+        return false;
+    }
+
+    credit->advertised = next;
+    credit->granted = true;
+    *limit = next;
+    return true;
+}
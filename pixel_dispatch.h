@@ -0,0 +1,47 @@
+#pragma once
+#include "pixel_client.h"
+#include "pixel_queue.h"
+
+// Queues what pixel_client_accept() makes of a relay frame. Shared by
+// live_pixel.cpp and the host load test, so both queue the same pixels for
+// the same frames. The caller publishes afterwards.
+
+#define PIXEL_CLEAR_COLOR 0xFFFF  // white
+
+// Replaces the whole canvas through the coalescing buffer, after the pixels
+// already staged: with the colors of keyframe, or PIXEL_CLEAR_COLOR if null.
+template <typename Lock>
+inline void pixel_queue_replace_canvas(PixelQueue<Lock> *queue, const PixelFrame *keyframe) {
+    uint16_t row[PIXEL_CANVAS_SIZE];
+
+    pixel_queue_publish(queue);
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        for (int x = 0; x < PIXEL_CANVAS_SIZE; x++) {
+            row[x] = keyframe ? pixel_frame_color(*keyframe, y * PIXEL_CANVAS_SIZE + x) : PIXEL_CLEAR_COLOR;
+        }
+        pixel_queue_coalesce_row(queue, y, row);
+    }
+}
+
+template <typename Lock>
+inline void pixel_client_dispatch(PixelClient *client, PixelQueue<Lock> *queue, const PixelFrame &frame,
+                                  uint32_t now_ms) {
+    switch (pixel_client_accept(client, frame, now_ms)) {
+        case PIXEL_CLIENT_CLEAR:
+            pixel_queue_replace_canvas(queue, nullptr);
+            break;
+        case PIXEL_CLIENT_KEYFRAME:
+            pixel_queue_replace_canvas(queue, &frame);
+            break;
+        case PIXEL_CLIENT_RECORDS:
+            for (uint16_t i = 0; i < frame.count; i++) {
+                const PixelRecord pixel = pixel_frame_record(frame, i);
+                if (pixel_in_canvas(pixel.x, pixel.y)) {
+                    pixel_queue_push(queue, pixel);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
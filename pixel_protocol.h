@@ -0,0 +1,257 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Live Pixel wire format shared by the firmware and the relay.
+//
+// Binary frames (little-endian), read in place from the websocket buffer:
+//   [version:1][opcode:1][count:2][record 0]...[record count-1]
+// where each pixel record is [x:1][y:1][rgb565:2].
+//
+// The relay keeps the authoritative canvas and numbers every change. Its
+// frames carry sequence numbers between the header and the payload:
+//   KEYFRAME [seq:4] then count = 32*32 colors [rgb565:2], row by row
+//   DELTA    [seq:4] then count pixel records, applies on top of seq - 1
+//   PATCH    [base:4][seq:4] then count pixel records: every pixel changed
+//            after base, bringing a canvas at base up to seq
+// A device that sees a gap sends RESYNC [seq:4] with the last sequence it
+// applied and is answered with a PATCH, or a KEYFRAME if that is smaller.
+//
+// Flow control: the device sends CREDIT [limit:4], the total number of
+// DELTA and PATCH records the relay may have sent it since the connection
+// opened. The relay holds deltas back once it reaches the limit and sends
+// one PATCH of everything it held back when the device grants more.
+
+#define PIXEL_PROTO_VERSION 1
+#define PIXEL_PROTO_HEADER_SIZE 4
+#define PIXEL_PROTO_RECORD_SIZE 4
+#define PIXEL_CANVAS_SIZE 32
+
+enum PixelOpcode : uint8_t {
+    PIXEL_OP_PIXELS = 0x01,  // count pixel records
+    PIXEL_OP_CLEAR = 0x02,   // no records, count is 0
+    PIXEL_OP_KEYFRAME = 0x03,
+    PIXEL_OP_DELTA = 0x04,
+    PIXEL_OP_PATCH = 0x05,
+    PIXEL_OP_RESYNC = 0x06,  // device to relay, count is 0
+    PIXEL_OP_CREDIT = 0x07,  // device to relay, count is 0
+};
+
+#define PIXEL_PROTO_SEQ_SIZE 4
+#define PIXEL_PROTO_COLOR_SIZE 2
+#define PIXEL_KEYFRAME_COLORS (PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE)
+
+struct PixelRecord {
+    uint8_t x;
+    uint8_t y;
+    uint16_t color;
+};
+
+struct PixelFrame {
+    uint8_t opcode;
+    uint16_t count;
+    uint32_t base;           // PATCH only
+    uint32_t seq;            // 0 for unsequenced frames
+    const uint8_t *records;  // points into the message buffer, not copied
+};
+
+inline uint32_t pixel_read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline void pixel_write_u32(uint8_t *p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = value >> 24;
+}
+
+inline bool pixel_in_canvas(int x, int y) {
+    return x >= 0 && x < PIXEL_CANVAS_SIZE && y >= 0 && y < PIXEL_CANVAS_SIZE;
+}
+
+// Validates the header and record length. Returns false for frames from
+// another protocol version or with a count that does not match the length.
+inline bool pixel_frame_parse(const uint8_t *buf, size_t len, PixelFrame *frame) {
+    if (len < PIXEL_PROTO_HEADER_SIZE || buf[0] != PIXEL_PROTO_VERSION) {
+        return false;
+    }
+
+    frame->opcode = buf[1];
+    frame->count = (uint16_t)(buf[2] | (buf[3] << 8));
+    frame->base = 0;
+    frame->seq = 0;
+
+    size_t offset = PIXEL_PROTO_HEADER_SIZE;
+    size_t record_size = PIXEL_PROTO_RECORD_SIZE;
+    switch (frame->opcode) {
+        case PIXEL_OP_KEYFRAME:
+            record_size = PIXEL_PROTO_COLOR_SIZE;
+            // fall through
+        case PIXEL_OP_DELTA:
+        case PIXEL_OP_RESYNC:
+            if (len < offset + PIXEL_PROTO_SEQ_SIZE) return false;
+            frame->seq = pixel_read_u32(buf + offset);
+            offset += PIXEL_PROTO_SEQ_SIZE;
+            break;
+        case PIXEL_OP_PATCH:
+            if (len < offset + 2 * PIXEL_PROTO_SEQ_SIZE) return false;
+            frame->base = pixel_read_u32(buf + offset);
+            frame->seq = pixel_read_u32(buf + offset + PIXEL_PROTO_SEQ_SIZE);
+            offset += 2 * PIXEL_PROTO_SEQ_SIZE;
+            break;
+    }
+    frame->records = buf + offset;
+
+    if (frame->opcode == PIXEL_OP_KEYFRAME && frame->count != PIXEL_KEYFRAME_COLORS) return false;
+    return len >= offset + (size_t)frame->count * record_size;
+}
+
+inline PixelRecord pixel_frame_record(const PixelFrame &frame, uint16_t index) {
+    const uint8_t *rec = frame.records + (size_t)index * PIXEL_PROTO_RECORD_SIZE;
+    PixelRecord pixel = {rec[0], rec[1], (uint16_t)(rec[2] | (rec[3] << 8))};
+    return pixel;
+}
+
+// Color i of a KEYFRAME, row by row
+inline uint16_t pixel_frame_color(const PixelFrame &frame, uint16_t index) {
+    const uint8_t *color = frame.records + (size_t)index * PIXEL_PROTO_COLOR_SIZE;
+    return (uint16_t)(color[0] | (color[1] << 8));
+}
+
+inline void pixel_frame_write_header(uint8_t *buf, uint8_t opcode, uint16_t count) {
+    buf[0] = PIXEL_PROTO_VERSION;
+    buf[1] = opcode;
+    buf[2] = count & 0xFF;
+    buf[3] = count >> 8;
+}
+
+// A RESYNC request, PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE bytes
+inline size_t pixel_frame_write_resync(uint8_t *buf, uint32_t seq) {
+    pixel_frame_write_header(buf, PIXEL_OP_RESYNC, 0);
+    pixel_write_u32(buf + PIXEL_PROTO_HEADER_SIZE, seq);
+    return PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE;
+}
+
+// A CREDIT grant, PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE bytes
+inline size_t pixel_frame_write_credit(uint8_t *buf, uint32_t limit) {
+    pixel_frame_write_header(buf, PIXEL_OP_CREDIT, 0);
+    pixel_write_u32(buf + PIXEL_PROTO_HEADER_SIZE, limit);
+    return PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE;
+}
+
+inline void pixel_frame_write_record(uint8_t *buf, uint16_t index, PixelRecord pixel) {
+    uint8_t *rec = buf + PIXEL_PROTO_HEADER_SIZE + (size_t)index * PIXEL_PROTO_RECORD_SIZE;
+    rec[0] = pixel.x;
+    rec[1] = pixel.y;
+    rec[2] = pixel.color & 0xFF;
+    rec[3] = pixel.color >> 8;
+}
+
+// Text format, kept for older relays and senders:
+//   "x,y,color" with decimal coordinates and a hex RGB565 color,
+// several of them separated by ';' in "chunk;" and "compressed;" messages.
+
+#define PIXEL_TEXT_INT_DIGITS 9  // any more could overflow an int
+
+// Parses a decimal int. Returns a pointer just past it, or NULL if there are
+// no digits or more than PIXEL_TEXT_INT_DIGITS of them.
+inline const char *pixel_text_parse_int(const char *p, const char *end, int *value) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+
+    const char *start = p;
+    int result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (p - start == PIXEL_TEXT_INT_DIGITS) return NULL;
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    if (p == start) return NULL;
+
+    *value = negative ? -result : result;
+    return p;
+}
+
+// Hex digit values indexed by character, -1 for non-hex characters
+static const int8_t PIXEL_HEX_TABLE[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+inline int pixel_hex_digit(char c) { return PIXEL_HEX_TABLE[(uint8_t)c]; }
+
+inline const char *pixel_text_parse_hex(const char *p, const char *end, uint16_t *value) {
+    const char *start = p;
+    uint16_t result = 0;
+    int digit;
+    while (p < end && (digit = pixel_hex_digit(*p)) >= 0) {
+        result = (uint16_t)((result << 4) | digit);
+        p++;
+    }
+    if (p == start) return NULL;
+
+    *value = result;
+    return p;
+}
+
+// Parses one "x,y,color" record starting at p. Returns a pointer just past
+// the record and its ';' separator, or NULL if the record is malformed.
+inline const char *pixel_text_parse_record(const char *p, const char *end,
+                                           int *x, int *y, uint16_t *color) {
+    p = pixel_text_parse_int(p, end, x);
+    if (!p || p >= end || *p++ != ',') return NULL;
+    p = pixel_text_parse_int(p, end, y);
+    if (!p || p >= end || *p++ != ',') return NULL;
+    p = pixel_text_parse_hex(p, end, color);
+    if (!p) return NULL;
+
+    while (p < end && *p != ';') p++;
+    return p < end ? p + 1 : p;
+}
+
+// Skips count ';'-separated fields, returning the start of the next one.
+inline const char *pixel_text_skip_fields(const char *p, const char *end, int count) {
+    while (count > 0 && p < end) {
+        if (*p++ == ';') count--;
+    }
+    return count == 0 ? p : NULL;
+}
+
+// Decodes the next width comma-separated hex colors of a "full," payload
+// into row in a single pass. Returns a pointer to the next row, or NULL if
+// the payload ends before the row is complete.
+inline const char *pixel_text_decode_row(const char *p, const char *end,
+                                         uint16_t *row, int width) {
+    for (int x = 0; x < width; x++) {
+        if (p >= end) return NULL;
+
+        uint16_t color = 0;
+        int digit;
+        while (p < end && (digit = PIXEL_HEX_TABLE[(uint8_t)*p]) >= 0) {
+            color = (uint16_t)((color << 4) | digit);
+            p++;
+        }
+        row[x] = color;
+
+        if (p < end) p++;  // ','
+    }
+    return p;
+}
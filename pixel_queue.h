@@ -0,0 +1,99 @@
+#pragma once
+#include <string.h>
+#include "pixel_ring.h"
+
+// The Live Pixel pipeline from the network task to the display task: a
+// PixelRing, with a coalescing buffer behind it for pixels that don't fit,
+// full frames and clears. While coalesced pixels are pending the producer
+// keeps writing there, and the consumer only takes them once the older
+// pixels in the ring are applied, so the order of writes is kept.
+//
+// Lock guards the coalescing buffer and needs lock() and unlock(): a portMUX
+// critical section on the ESP32, std::mutex or a no-op on the host.
+
+template <typename Lock>
+struct PixelQueue {
+    PixelRing ring;
+    uint32_t pending;  // producer's staged head
+    uint16_t overflow_pixels[PIXEL_KEYFRAME_COLORS];
+    uint32_t overflow_dirty[PIXEL_CANVAS_SIZE];  // bit x of row y
+    volatile bool overflow_pending;
+    uint32_t overflows;  // times the ring filled up
+    Lock lock;
+};
+
+// Only call while neither side is running
+template <typename Lock>
+inline void pixel_queue_reset(PixelQueue<Lock> *queue) {
+    pixel_ring_reset(&queue->ring);
+    queue->pending = 0;
+    memset(queue->overflow_dirty, 0, sizeof(queue->overflow_dirty));
+    queue->overflow_pending = false;
+}
+
+// Producer: makes the staged pixels visible to the consumer
+template <typename Lock>
+inline void pixel_queue_publish(PixelQueue<Lock> *queue) {
+    pixel_ring_publish(&queue->ring, queue->pending);
+}
+
+// Producer: writes pixel to the coalescing buffer
+template <typename Lock>
+inline void pixel_queue_coalesce(PixelQueue<Lock> *queue, PixelRecord pixel) {
+    queue->lock.lock();
+    queue->overflow_pixels[pixel.y * PIXEL_CANVAS_SIZE + pixel.x] = pixel.color;
+    queue->overflow_dirty[pixel.y] |= 1UL << pixel.x;
+    queue->overflow_pending = true;
+    queue->lock.unlock();
+}
+
+// Producer: replaces row y through the coalescing buffer. Publish first, so
+// pixels already staged are applied before it.
+template <typename Lock>
+inline void pixel_queue_coalesce_row(PixelQueue<Lock> *queue, int y, const uint16_t *row) {
+    queue->lock.lock();
+    memcpy(queue->overflow_pixels + y * PIXEL_CANVAS_SIZE, row, PIXEL_CANVAS_SIZE * sizeof(uint16_t));
+    queue->overflow_dirty[y] = 0xFFFFFFFF;
+    queue->overflow_pending = true;
+    queue->lock.unlock();
+}
+
+// Producer: stages pixel in the ring, or coalesces it once the ring is full
+template <typename Lock>
+inline void pixel_queue_push(PixelQueue<Lock> *queue, PixelRecord pixel) {
+    if (!queue->overflow_pending) {
+        if (pixel_ring_stage(&queue->ring, &queue->pending, pixel)) {
+            return;
+        }
+        queue->overflows++;
+        // Publish what fit so it is applied before the coalesced pixels
+        pixel_queue_publish(queue);
+    }
+    pixel_queue_coalesce(queue, pixel);
+}
+
+// Producer: records the consumer has room for. While coalesced pixels are
+// waiting the ring counts as full, the consumer is behind.
+template <typename Lock>
+inline uint32_t pixel_queue_free_records(PixelQueue<Lock> *queue) {
+    return queue->overflow_pending ? 0 : PIXEL_RING_SIZE - pixel_ring_used(&queue->ring);
+}
+
+// Consumer: once the ring is drained, moves the coalesced pixels and their
+// dirty bits out. Returns false if there are none or the ring isn't empty yet.
+template <typename Lock>
+inline bool pixel_queue_take_overflow(PixelQueue<Lock> *queue, uint16_t *pixels, uint32_t *dirty) {
+    if (!queue->overflow_pending) return false;
+
+    queue->lock.lock();
+    if (pixel_ring_used(&queue->ring) > 0) {
+        queue->lock.unlock();
+        return false;  // Published just before the overflow, apply those first
+    }
+    memcpy(pixels, queue->overflow_pixels, sizeof(queue->overflow_pixels));
+    memcpy(dirty, queue->overflow_dirty, sizeof(queue->overflow_dirty));
+    memset(queue->overflow_dirty, 0, sizeof(queue->overflow_dirty));
+    queue->overflow_pending = false;
+    queue->lock.unlock();
+    return true;
+}
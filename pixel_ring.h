@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include "pixel_protocol.h"
+
+// Single-producer single-consumer ring of packed pixel records, used to hand
+// pixels from the network task to the display task without a kernel lock.
+// The producer stages records past the published head and makes a whole batch
+// visible with one store; the consumer frees a whole batch the same way.
+
+#define PIXEL_RING_SIZE 1024  // power of two
+#define PIXEL_RING_ALIGN 64   // keep the two indices on separate cache lines
+
+struct PixelRing {
+    alignas(PIXEL_RING_ALIGN) std::atomic<uint32_t> head;  // written by the producer
+    alignas(PIXEL_RING_ALIGN) std::atomic<uint32_t> tail;  // written by the consumer
+    alignas(PIXEL_RING_ALIGN) PixelRecord records[PIXEL_RING_SIZE];
+};
+
+// Only call while neither side is running
+inline void pixel_ring_reset(PixelRing *ring) {
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+}
+
+// Producer: stages one record at *pending, which starts at the published head.
+// Returns false if the ring is full.
+inline bool pixel_ring_stage(PixelRing *ring, uint32_t *pending, PixelRecord pixel) {
+    if (*pending - ring->tail.load(std::memory_order_acquire) >= PIXEL_RING_SIZE) {
+        return false;
+    }
+    ring->records[*pending & (PIXEL_RING_SIZE - 1)] = pixel;
+    (*pending)++;
+    return true;
+}
+
+// Producer: makes every record staged up to pending visible to the consumer
+inline void pixel_ring_publish(PixelRing *ring, uint32_t pending) {
+    ring->head.store(pending, std::memory_order_release);
+}
+
+// Consumer: copies out up to max records and frees them. Returns the count.
+inline uint32_t pixel_ring_consume(PixelRing *ring, PixelRecord *out, uint32_t max) {
+    const uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint32_t count = ring->head.load(std::memory_order_acquire) - tail;
+    if (count > max) count = max;
+
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = ring->records[(tail + i) & (PIXEL_RING_SIZE - 1)];
+    }
+    ring->tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+inline uint32_t pixel_ring_used(PixelRing *ring) {
+    return ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+
+// Tracks which of the relay's canvas sequence numbers the device has
+// applied, and decides for each sequenced frame whether to apply it, drop
+// it, or ask for a resync (see pixel_protocol.h). Until a KEYFRAME or a
+// PATCH answers, deltas are dropped: the answer covers them.
+
+#define PIXEL_SYNC_RETRY_MS 1000  // a resync that isn't answered is asked for again
+
+enum PixelSyncAction : uint8_t {
+    PIXEL_SYNC_APPLY,
+    PIXEL_SYNC_DROP,
+    PIXEL_SYNC_RESYNC,  // drop it and send RESYNC with seq
+};
+
+struct PixelSync {
+    uint32_t seq;      // last sequence applied
+    bool synced;       // a keyframe has been applied since connecting
+    bool waiting;      // a RESYNC is outstanding
+    uint32_t sent_ms;  // when it was sent
+    uint32_t gaps;     // deltas found missing, for telemetry
+};
+
+// On every (re)connection: the relay starts with a keyframe
+inline void pixel_sync_reset(PixelSync *sync) {
+    sync->seq = 0;
+    sync->synced = false;
+    sync->waiting = false;
+    sync->sent_ms = 0;
+}
+
+inline PixelSyncAction pixel_sync_keyframe(PixelSync *sync, uint32_t seq) {
+    sync->seq = seq;
+    sync->synced = true;
+    sync->waiting = false;
+    return PIXEL_SYNC_APPLY;
+}
+
+inline PixelSyncAction pixel_sync_delta(PixelSync *sync, uint32_t seq, uint32_t now_ms) {
+    if (sync->synced && (int32_t)(seq - sync->seq) <= 0) return PIXEL_SYNC_DROP;  // Already covered
+
+    if (sync->waiting) {
+        if (now_ms - sync->sent_ms < PIXEL_SYNC_RETRY_MS) return PIXEL_SYNC_DROP;
+    } else if (!sync->synced) {
+        // The keyframe went missing; RESYNC from 0 asks for a new one
+    } else if (seq == sync->seq + 1) {
+        sync->seq = seq;
+        return PIXEL_SYNC_APPLY;
+    } else {
+        sync->gaps += seq - sync->seq - 1;
+    }
+
+    sync->waiting = true;
+    sync->sent_ms = now_ms;
+    return PIXEL_SYNC_RESYNC;
+}
+
+// A PATCH only fits the canvas it was computed for
+inline PixelSyncAction pixel_sync_patch(PixelSync *sync, uint32_t base, uint32_t seq) {
+    if (!sync->synced || base != sync->seq || (int32_t)(seq - sync->seq) <= 0) return PIXEL_SYNC_DROP;
+
+    sync->seq = seq;
+    sync->waiting = false;
+    return PIXEL_SYNC_APPLY;
+}
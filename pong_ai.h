@@ -0,0 +1,81 @@
+#pragma once
+#include "pong_physics.h"
+
+// Pong AI paddle. The intercept is solved in closed form: the ball's
+// vertical path is unfolded through the walls, so the point where it meets
+// the paddle face is one division and one modulo away however many times
+// it bounces. Difficulty only changes the profile the AI plays with.
+
+struct PongAiProfile {
+    uint8_t reaction_steps;  // steps after the ball turns before the AI re-aims
+    uint8_t aim_noise;       // the aim point is off by up to this many pixels
+    uint8_t max_speed;       // pixels per step
+};
+
+struct PongAi {
+    int target_y;   // paddle top the AI is moving to
+    uint8_t wait;   // steps left before re-aiming
+    bool incoming;  // the ball was heading for the AI when it last aimed
+};
+
+// Reflects y into [lo, hi] the way the walls do
+inline fix16 pong_fold(int64_t y, fix16 lo, fix16 hi) {
+    const int64_t span = hi - lo;
+    int64_t m = (y - lo) % (2 * span);
+    if (m < 0) m += 2 * span;
+    if (m > span) m = 2 * span - m;
+    return (fix16)(lo + m);
+}
+
+// Top of the ball when it reaches face_x, counting wall bounces. Returns
+// false if the ball isn't moving towards face_x.
+inline bool pong_predict_intercept(const PongBall *ball, fix16 face_x, fix16 *y) {
+    if (ball->dx == 0 || (ball->dx > 0) != (face_x > ball->x)) return false;
+
+    // Steps to the face in Q16.16, then the unfolded vertical distance
+    const int64_t t = ((int64_t)(face_x - ball->x) * FIX16_ONE) / ball->dx;
+    const int64_t unfolded = ball->y + ((int64_t)ball->dy * t >> FIX16_SHIFT);
+    *y = pong_fold(unfolded, PONG_TOP, PONG_BOTTOM);
+    return true;
+}
+
+inline void pong_ai_reset(PongAi *ai, int paddle_y) {
+    ai->target_y = paddle_y;
+    ai->wait = 0;
+    ai->incoming = false;
+}
+
+// Moves the right paddle one step and returns its new top. noise is any
+// non-negative random number; it is only used when the AI re-aims, so the
+// same ball, profile and noise always give the same paddle.
+inline int pong_ai_step(PongAi *ai, const PongAiProfile *profile, const PongBall *ball,
+                        int paddle_y, int noise) {
+    const bool incoming = ball->dx > 0;
+    if (incoming != ai->incoming) {
+        ai->incoming = incoming;
+        ai->wait = profile->reaction_steps;
+    }
+
+    if (ai->wait > 0) {
+        ai->wait--;
+    } else {
+        fix16 ball_y;
+        int center = PONG_HEIGHT / 2;  // Wait in the middle while the ball heads away
+        if (pong_predict_intercept(ball, PONG_AI_FACE, &ball_y)) {
+            center = fix16_round(ball_y) + PONG_BALL_SIZE / 2;
+            if (profile->aim_noise) {
+                center += noise % (2 * profile->aim_noise + 1) - profile->aim_noise;
+            }
+        }
+        ai->target_y = center - PONG_PADDLE_HEIGHT / 2;
+    }
+
+    int move = ai->target_y - paddle_y;
+    if (move > profile->max_speed) move = profile->max_speed;
+    if (move < -profile->max_speed) move = -profile->max_speed;
+
+    int y = paddle_y + move;
+    if (y < PONG_BORDER) y = PONG_BORDER;
+    if (y > PONG_HEIGHT - PONG_BORDER - PONG_PADDLE_HEIGHT) y = PONG_HEIGHT - PONG_BORDER - PONG_PADDLE_HEIGHT;
+    return y;
+}
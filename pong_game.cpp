@@ -1,17 +1,18 @@
 #include "pong_game.h"
+#include "pong_step.h"
+#include "input.h"
 
-enum Difficulty { EASY, NORMAL, HARD, IMPOSSIBLE };
 const char* DIFFICULTY_NAMES[] = {"Easy", "Normal", "Hard", "Impossible"};
 const int SCORE_LIMITS[] = {5, 10, 15, 20};
-const int NUM_DIFFICULTIES = 4;
+const int NUM_DIFFICULTIES = PONG_DIFFICULTIES;
 const int NUM_SCORE_LIMITS = 4;
 
 struct PongGame {
+    PongState state;  // see pong_step.h
+    // state in screen pixels, for drawing
     Position player;
     Position ai;
     Position ball;
-    float ball_dx;
-    float ball_dy;
     int player_score;
     int ai_score;
     uint8_t running;
@@ -19,44 +20,61 @@ struct PongGame {
     int score_limit;
 };
 
-const int PADDLE_WIDTH = 4;
-const int PADDLE_HEIGHT = 20;
-const int BALL_SIZE = 4;
-const float BALL_SPEED_INCREASE = 0.5;  // How much to increase speed on each hit
-const float MAX_BALL_SPEED_X = 5.0;     // Maximum horizontal ball speed
-const float MAX_BALL_SPEED_Y = 3.0;     // Maximum vertical ball speed
+const int PADDLE_WIDTH = PONG_PADDLE_WIDTH;
+const int PADDLE_HEIGHT = PONG_PADDLE_HEIGHT;
+const int BALL_SIZE = PONG_BALL_SIZE;
 const int MAX_SCORE = 20;
+const int PONG_STEP_MS = 30;    // Ball and paddle speeds are per step
+const int PONG_RENDER_MS = 30;
+
+// Direct mode, the default, draws only what moved straight to the panel.
+// Sprite mode, behind the 'r' serial command, draws the whole playfield into
+// two 128x32 band sprites and pushes each with DMA while the next band, or
+// the next frame, is computed. It falls back to direct mode if the bands
+// can't be allocated.
+const int BAND_HEIGHT = 32;
+const int BAND_COUNT = SCREEN_HEIGHT / BAND_HEIGHT;
 
 PongGame pong;
+PongRenderMode pong_render_mode = PONG_RENDER_DIRECT;
+volatile PongRenderMode pong_requested_mode = PONG_RENDER_DIRECT;
+PongRenderMode pong_applied_mode;  // the request pong_render_mode follows
+PongRenderStats pong_render_stats;
+GameLoop pong_loop;
+TFT_eSprite pong_bands[2] = {TFT_eSprite(&tft), TFT_eSprite(&tft)};
 SemaphoreHandle_t pong_mutex;
-TaskHandle_t pong_task_handle = NULL;
-TaskHandle_t pong_input_task_handle = NULL;
+TaskStop pong_stop;
+QueueHandle_t pong_input;
+
+// Waits for the next button event. False once the task is asked to stop.
+bool wait_pong_input(InputEvent *event) {
+    while (xQueueReceive(pong_input, event, pdMS_TO_TICKS(TASK_STOP_POLL_MS)) != pdTRUE) {
+        if (task_stop_requested(&pong_stop)) return false;
+    }
+    return true;
+}
 
 void show_pong_settings() {
     static int selected_option = 0;  
     static int difficulty_idx = 1;   
     static int score_limit_idx = 0;  
     bool settings_done = false;
+    InputEvent event;
 
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
 
-    while (!settings_done && current_state == STATE_PONG) {
+    while (!settings_done) {
 
         draw_centered_text("Pong Settings", 20, TFT_WHITE, 1);
 
-        tft.setTextSize(1);
         if (selected_option == 0) {
-            tft.setTextColor(TFT_GREEN);
-            tft.setCursor(10, 50);
-            tft.print(">");
+            render_text(10, 50, ">", TFT_GREEN, TFT_GREEN, 1);
         }
         draw_centered_text("Difficulty:", 50, TFT_BLUE, 1);
         draw_centered_text(DIFFICULTY_NAMES[difficulty_idx], 65, TFT_YELLOW, 1);
 
         if (selected_option == 1) {
-            tft.setTextColor(TFT_GREEN);
-            tft.setCursor(10, 90);
-            tft.print(">");
+            render_text(10, 90, ">", TFT_GREEN, TFT_GREEN, 1);
         }
         draw_centered_text("Score Limit:", 90, TFT_BLUE, 1);
         char score_text[3];
@@ -67,297 +85,191 @@ void show_pong_settings() {
         draw_centered_text("LEFT/RIGHT: Change", 140, TFT_CYAN, 1);
         draw_centered_text("Press B to start", 150, TFT_GREEN, 1);
 
-        if (!digitalRead(BTN_UP)) {
-            int old_option = selected_option;
-            selected_option = 0;
-
-            tft.setTextColor(TFT_BLACK);
-            tft.setCursor(10, old_option == 0 ? 50 : 90);
-            tft.print(">");
-            while (!digitalRead(BTN_UP)) { delay(10); }
-            delay(50);
+        // Nothing changes until a button is pressed, holding LEFT/RIGHT repeats
+        if (!wait_pong_input(&event)) {
+            return;
         }
-        if (!digitalRead(BTN_DOWN)) {
-            int old_option = selected_option;
-            selected_option = 1;
-
-            tft.setTextColor(TFT_BLACK);
-            tft.setCursor(10, old_option == 0 ? 50 : 90);
-            tft.print(">");
-            while (!digitalRead(BTN_DOWN)) { delay(10); }
-            delay(50);
+        if (event.type == INPUT_RELEASE) {
+            continue;
         }
-        if (!digitalRead(BTN_LEFT)) {
-            if (selected_option == 0) {
-                difficulty_idx = (difficulty_idx - 1 + NUM_DIFFICULTIES) % NUM_DIFFICULTIES;
 
-                tft.fillRect(0, 65, SCREEN_WIDTH, 10, TFT_BLACK);
-            } else {
-                score_limit_idx = (score_limit_idx - 1 + NUM_SCORE_LIMITS) % NUM_SCORE_LIMITS;
+        if (event.button == INPUT_UP || event.button == INPUT_DOWN) {
+            int old_option = selected_option;
+            selected_option = event.button == INPUT_UP ? 0 : 1;
 
-                tft.fillRect(0, 105, SCREEN_WIDTH, 10, TFT_BLACK);
-            }
-            while (!digitalRead(BTN_LEFT)) { delay(10); }
-            delay(50);
+            render_text(10, old_option == 0 ? 50 : 90, ">", TFT_BLACK, TFT_BLACK, 1);
         }
-        if (!digitalRead(BTN_RIGHT)) {
+        if (event.button == INPUT_LEFT || event.button == INPUT_RIGHT) {
+            const int step = event.button == INPUT_LEFT ? -1 : 1;
             if (selected_option == 0) {
-                difficulty_idx = (difficulty_idx + 1) % NUM_DIFFICULTIES;
+                difficulty_idx = (difficulty_idx + step + NUM_DIFFICULTIES) % NUM_DIFFICULTIES;
 
-                tft.fillRect(0, 65, SCREEN_WIDTH, 10, TFT_BLACK);
+                render_rect(0, 65, SCREEN_WIDTH, 10, TFT_BLACK);
             } else {
-                score_limit_idx = (score_limit_idx + 1) % NUM_SCORE_LIMITS;
+                score_limit_idx = (score_limit_idx + step + NUM_SCORE_LIMITS) % NUM_SCORE_LIMITS;
 
-                tft.fillRect(0, 105, SCREEN_WIDTH, 10, TFT_BLACK);
+                render_rect(0, 105, SCREEN_WIDTH, 10, TFT_BLACK);
             }
-            while (!digitalRead(BTN_RIGHT)) { delay(10); }
-            delay(50);
         }
-        if (!digitalRead(BTN_B)) {
+        if (event.button == INPUT_B && event.type == INPUT_PRESS) {
             settings_done = true;
-            while (!digitalRead(BTN_B)) { delay(10); }
-            delay(50);
         }
-
-        delay(10);
     }
 
     pong.difficulty = static_cast<Difficulty>(difficulty_idx);
     pong.score_limit = SCORE_LIMITS[score_limit_idx];
 }
 
+void sync_positions() {
+    pong.player = {BORDER_SIZE, pong.state.player_y};
+    pong.ai = {SCREEN_WIDTH - BORDER_SIZE - PADDLE_WIDTH, pong.state.ai_y};
+    pong.ball = {fix16_round(pong.state.ball.x), fix16_round(pong.state.ball.y)};
+    pong.player_score = pong.state.player_score;
+    pong.ai_score = pong.state.ai_score;
+}
+
 void initialize_pong_game() {
-    show_pong_settings();  
-    
+    show_pong_settings();
+    if (task_stop_requested(&pong_stop)) {
+        return;
+    }
+
     xSemaphoreTake(pong_mutex, portMAX_DELAY);
 
-    float base_speed = 2.0f;
-    if (pong.difficulty == IMPOSSIBLE) {
-        base_speed = 3.0f;
-    } else if (pong.difficulty == HARD) {
-        base_speed = 2.5f;
-    }
+    pong.running = 1;
+    pong_reset(&pong.state, &PONG_RULES[pong.difficulty], esp_random());
+    sync_positions();
 
-    pong = (PongGame){
-        .player = {BORDER_SIZE, (SCREEN_HEIGHT - PADDLE_HEIGHT) / 2},
-        .ai = {SCREEN_WIDTH - BORDER_SIZE - PADDLE_WIDTH,
-               (SCREEN_HEIGHT - PADDLE_HEIGHT) / 2},
-        .ball = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2},
-        .ball_dx = (rand() % 2) ? base_speed : -base_speed,
-        .ball_dy = ((float)(rand() % 3) - 1.0f) * 0.6f,
-        .player_score = 0,
-        .ai_score = 0,
-        .running = 1,
-        .difficulty = pong.difficulty,
-        .score_limit = pong.score_limit 
-    };
-
-    tft.fillScreen(TFT_BLACK);
-    tft.fillRect(0, 0, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);
-    tft.fillRect(0, SCREEN_HEIGHT - BORDER_SIZE, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);
+    render_clear(TFT_BLACK);
+    render_rect(0, 0, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);
+    render_rect(0, SCREEN_HEIGHT - BORDER_SIZE, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);
 
     xSemaphoreGive(pong_mutex);
 }
 
-void pong_input_task(void *pv) {
-    const int MOVE_SPEED = 3;
-
-    while (current_state == STATE_PONG) {
-        xSemaphoreTake(pong_mutex, portMAX_DELAY);
-
-        if (!digitalRead(BTN_UP)) {
-            pong.player.y =
-                constrain(pong.player.y - MOVE_SPEED, BORDER_SIZE,
-                          SCREEN_HEIGHT - BORDER_SIZE - PADDLE_HEIGHT);
-        }
-        if (!digitalRead(BTN_DOWN)) {
-            pong.player.y =
-                constrain(pong.player.y + MOVE_SPEED, BORDER_SIZE,
-                          SCREEN_HEIGHT - BORDER_SIZE - PADDLE_HEIGHT);
-        }
-
-        xSemaphoreGive(pong_mutex);
-        vTaskDelay(pdMS_TO_TICKS(20));
-    }
+void erase_previous_positions(int prev_player_y, int prev_ai_y, Position prev_ball) {
+    render_rect(pong.player.x, prev_player_y, PADDLE_WIDTH, PADDLE_HEIGHT,
+                TFT_BLACK);
+    render_rect(pong.ai.x, prev_ai_y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_BLACK);
+    render_rect(prev_ball.x, prev_ball.y, BALL_SIZE, BALL_SIZE, TFT_BLACK);
 }
 
-void erase_previous_positions(int prev_player_y, int prev_ai_y, Position prev_ball) {
-    tft.fillRect(pong.player.x, prev_player_y, PADDLE_WIDTH, PADDLE_HEIGHT,
-                 TFT_BLACK);
-    tft.fillRect(pong.ai.x, prev_ai_y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_BLACK);
-    tft.fillRect(prev_ball.x, prev_ball.y, BALL_SIZE, BALL_SIZE, TFT_BLACK);
+// The paddle moves while UP or DOWN is held, read from the debounced button state each step
+void update_game() {
+    const int move = input_is_down(INPUT_DOWN) - input_is_down(INPUT_UP);
+    pong_step(&pong.state, &PONG_RULES[pong.difficulty], move);
+    sync_positions();
 }
 
-void update_ball_position() {
-    pong.ball.x += round(pong.ball_dx);
-    pong.ball.y += round(pong.ball_dy);
+void draw_score(int x, int score) {
+    char text[12];
+    snprintf(text, sizeof(text), "%d", score);
+    render_text(x, BORDER_SIZE + 2, text, TFT_WHITE, TFT_WHITE, 1);
 }
 
-void handle_wall_collisions() {
-    if (pong.ball.y <= BORDER_SIZE ||
-        pong.ball.y >= SCREEN_HEIGHT - BORDER_SIZE - BALL_SIZE) {
-        pong.ball_dy = -pong.ball_dy;
-    }
+bool ball_over_scores(Position ball) {
+    return ball.y < BORDER_SIZE + 12;
 }
 
-void handle_paddle_collisions() {
-    // Player paddle collision
-    if (pong.ball.x <= BORDER_SIZE + PADDLE_WIDTH &&
-        pong.ball.y + BALL_SIZE > pong.player.y &&
-        pong.ball.y < pong.player.y + PADDLE_HEIGHT) {
-        
-        // Increase speed on hit
-        pong.ball_dx = min(abs(pong.ball_dx) + BALL_SPEED_INCREASE, MAX_BALL_SPEED_X);
-        
-        // Add spin effect based on where the paddle is hit
-        int hit_pos = (pong.ball.y + BALL_SIZE/2) - pong.player.y;
-        float relative_pos = (float)hit_pos / PADDLE_HEIGHT;
-        pong.ball_dy += (relative_pos - 0.5) * 2;  // -1.0 to +1.0 added to current speed
-        
-        // Cap vertical speed
-        if (pong.ball_dy > MAX_BALL_SPEED_Y) pong.ball_dy = MAX_BALL_SPEED_Y;
-        if (pong.ball_dy < -MAX_BALL_SPEED_Y) pong.ball_dy = -MAX_BALL_SPEED_Y;
-    }
+// Direct mode: erase and redraw the moving objects with fillRect. Scores are
+// only redrawn when they change or the ball has crossed them.
+void render_frame_direct(int prev_player_y, int prev_ai_y, Position prev_ball, bool scores_changed) {
+    erase_previous_positions(prev_player_y, prev_ai_y, prev_ball);
 
-    // AI paddle collision
-    if (pong.ball.x + BALL_SIZE >= SCREEN_WIDTH - BORDER_SIZE - PADDLE_WIDTH &&
-        pong.ball.y + BALL_SIZE > pong.ai.y &&
-        pong.ball.y < pong.ai.y + PADDLE_HEIGHT) {
-        
-        // Increase speed on hit
-        pong.ball_dx = -min(abs(pong.ball_dx) + BALL_SPEED_INCREASE, MAX_BALL_SPEED_X);
-        
-        // AI spin effects - different behavior based on difficulty
-        int hit_pos = (pong.ball.y + BALL_SIZE/2) - pong.ai.y;
-        float relative_pos = (float)hit_pos / PADDLE_HEIGHT;
-        
-        if (pong.difficulty == IMPOSSIBLE) {
-            // AI aims away from player paddle
-            if (pong.player.y > SCREEN_HEIGHT/2) {
-                pong.ball_dy = -2.0f - (rand() % 200) / 100.0f;  // Aim upward
-            } else {
-                pong.ball_dy = 2.0f + (rand() % 200) / 100.0f;  // Aim downward
-            }
-        } else {
-            // Normal spin based on hit position
-            pong.ball_dy += (relative_pos - 0.5) * 2;
-        }
-        
-        // Cap vertical speed
-        if (pong.ball_dy > MAX_BALL_SPEED_Y) pong.ball_dy = MAX_BALL_SPEED_Y;
-        if (pong.ball_dy < -MAX_BALL_SPEED_Y) pong.ball_dy = -MAX_BALL_SPEED_Y;
+    render_rect(pong.player.x, pong.player.y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
+    render_rect(pong.ai.x, pong.ai.y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
+    render_rect(pong.ball.x, pong.ball.y, BALL_SIZE, BALL_SIZE, TFT_WHITE);
+
+    if (scores_changed || ball_over_scores(prev_ball) || ball_over_scores(pong.ball)) {
+        render_rect(SCREEN_WIDTH/4 - 10, BORDER_SIZE + 2, 20, 10, TFT_BLACK); // Clear score area
+        render_rect(3*SCREEN_WIDTH/4 - 10, BORDER_SIZE + 2, 20, 10, TFT_BLACK);
+        draw_score(SCREEN_WIDTH/4 - 8, pong.player_score);
+        draw_score(3*SCREEN_WIDTH/4 - 8, pong.ai_score);
     }
 }
 
-void update_ai_paddle() {
-    // Calculate prediction frames based on difficulty and ball speed
-    float speed_factor = min(6.0f / abs(pong.ball_dx), 1.0f);  // Adjust prediction based on ball speed
-    
-    const int base_prediction_frames = pong.difficulty == EASY ? 1 : 
-                                      (pong.difficulty == NORMAL ? 3 : 
-                                      (pong.difficulty == HARD ? 8 : 15));
-                                      
-    const int prediction_frames = round(base_prediction_frames * speed_factor);
-    
-    const int max_speed = pong.difficulty == EASY ? 2 : 
-                         (pong.difficulty == NORMAL ? 4 : 
-                         (pong.difficulty == HARD ? 6 : 8));
-    
-    // For IMPOSSIBLE difficulty: speed up ball occasionally during gameplay
-    if (pong.difficulty == IMPOSSIBLE && abs(pong.ball_dx) < MAX_BALL_SPEED_X && 
-        (pong.ball.x == SCREEN_WIDTH / 2 || rand() % 100 < 2)) {
-        // Small chance (2%) to increase ball speed during play
-        pong.ball_dx = (pong.ball_dx > 0) ? 
-            min(pong.ball_dx + 0.2f, MAX_BALL_SPEED_X) : 
-            max(pong.ball_dx - 0.2f, -MAX_BALL_SPEED_X);
-    }
-    
-    // Calculate predicted ball position
-    const int prediction_y = pong.ball.y + round(pong.ball_dy * prediction_frames);
-    const int ai_center = pong.ai.y + PADDLE_HEIGHT / 2;
-    
-    // Add randomness based on difficulty
-    int randomOffset = 0;
-    if (pong.difficulty == EASY) randomOffset = rand() % 11 - 5;      // -5 to +5
-    else if (pong.difficulty == NORMAL) randomOffset = rand() % 7 - 3; // -3 to +3
-    else if (pong.difficulty == HARD) randomOffset = 0;               // Perfect
-    else if (pong.difficulty == IMPOSSIBLE) {
-        // AI will always predict perfectly and aim for center hit
-        randomOffset = -1; // Slight advantage to hit ball toward center
-    }
-    
-    const int target_y = prediction_y - PADDLE_HEIGHT / 2 + randomOffset;
-
-    const int constrained_target = constrain(
-        target_y, BORDER_SIZE, SCREEN_HEIGHT - BORDER_SIZE - PADDLE_HEIGHT);
-
-    // For IMPOSSIBLE, make the AI movement even smoother
-    int divider = (pong.difficulty == IMPOSSIBLE) ? 1 : 2;
-    pong.ai.y += constrain((constrained_target - ai_center) / divider, -max_speed, max_speed);
-    pong.ai.y = constrain(pong.ai.y, BORDER_SIZE, 
-                         SCREEN_HEIGHT - BORDER_SIZE - PADDLE_HEIGHT);
-    
-    // For IMPOSSIBLE, add perfect interception capability
-    if (pong.difficulty == IMPOSSIBLE && pong.ball_dx > 0 && 
-        pong.ball.x > SCREEN_WIDTH * 3/4) {
-        // When ball is moving toward AI and past 3/4 of screen, AI will directly move to intercept
-        pong.ai.y = constrain(pong.ball.y - PADDLE_HEIGHT/2, 
-                          BORDER_SIZE, 
-                          SCREEN_HEIGHT - BORDER_SIZE - PADDLE_HEIGHT);
+void draw_band(TFT_eSprite &band, int y0) {
+    band.fillSprite(TFT_BLACK);
+    band.fillRect(0, -y0, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);
+    band.fillRect(0, SCREEN_HEIGHT - BORDER_SIZE - y0, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);
+    band.fillRect(pong.player.x, pong.player.y - y0, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
+    band.fillRect(pong.ai.x, pong.ai.y - y0, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
+    band.fillRect(pong.ball.x, pong.ball.y - y0, BALL_SIZE, BALL_SIZE, TFT_WHITE);
+
+    if (y0 == 0) {
+        band.setTextSize(1);
+        band.setTextColor(TFT_WHITE);
+        band.setCursor(SCREEN_WIDTH/4 - 8, BORDER_SIZE + 2);
+        band.print(pong.player_score);
+        band.setCursor(3*SCREEN_WIDTH/4 - 8, BORDER_SIZE + 2);
+        band.print(pong.ai_score);
     }
 }
 
-void reset_ball(bool player_scored) {
-    pong.ball.x = SCREEN_WIDTH / 2;
-    pong.ball.y =
-        BORDER_SIZE + rand() % (SCREEN_HEIGHT - 2 * BORDER_SIZE - BALL_SIZE);
-
-    // Determine base speed based on difficulty
-    float base_speed = 2.0f;
-    if (pong.difficulty == IMPOSSIBLE) {
-        base_speed = 3.0f;
-    } else if (pong.difficulty == HARD) {
-        base_speed = 2.5f;
-    }
+// Sprite mode: each band is drawn while the previous one is on its way to the
+// display, and the last transfer overlaps the next frame's simulation.
+// Returns the time spent waiting for the display.
+uint32_t render_frame_sprite() {
+    static int next_buffer = 0;  // keeps alternating across frames
+    uint32_t wait_us = 0;
 
-    if (player_scored) {
-        pong.ball_dx = -base_speed;
-    } else {
-        pong.ball_dx = base_speed;
-    }
-    
-    // Set vertical speed based on difficulty
-    if (pong.difficulty == IMPOSSIBLE) {
-        pong.ball_dy = ((float)(rand() % 5) - 2.0f) * 0.8f;  // More vertical movement
-    } else {
-        pong.ball_dy = ((float)(rand() % 3) - 1.0f) * 0.6f;  // Standard vertical movement
+    for (int i = 0; i < BAND_COUNT; i++) {
+        TFT_eSprite &band = pong_bands[next_buffer];
+        next_buffer ^= 1;
+        draw_band(band, i * BAND_HEIGHT);
+
+        // Wait for the previous transfer so its buffer is free for the next band
+        uint32_t wait_start = micros();
+        render_sync();
+        wait_us += micros() - wait_start;
+
+        render_blit_dma(0, i * BAND_HEIGHT, SCREEN_WIDTH, BAND_HEIGHT, (uint16_t *)band.getPointer());
     }
+    return wait_us;
 }
 
-void update_scores() {
-    if (pong.ball.x < 0) {
-        pong.ai_score++;
-        reset_ball(false);
+void delete_bands() {
+    render_sync();  // The last band may still be in flight
+    pong_bands[0].deleteSprite();
+    pong_bands[1].deleteSprite();
+}
+
+bool create_bands() {
+    for (int i = 0; i < 2; i++) {
+        pong_bands[i].setColorDepth(16);
+        if (!pong_bands[i].createSprite(SCREEN_WIDTH, BAND_HEIGHT)) {
+            delete_bands();
+            return false;
+        }
     }
-    if (pong.ball.x > SCREEN_WIDTH) {
-        pong.player_score++;
-        reset_ball(true);
+    return true;
+}
+
+// Both modes leave the screen showing the previous positions, so direct mode
+// can take over from sprite mode by erasing them. Stats restart per mode.
+void apply_render_mode(PongRenderMode mode) {
+    pong_applied_mode = mode;
+    if (mode == PONG_RENDER_SPRITE && !create_bands()) {
+        mode = PONG_RENDER_DIRECT;
+    } else if (mode == PONG_RENDER_DIRECT && pong_render_mode == PONG_RENDER_SPRITE) {
+        delete_bands();
     }
+    pong_render_mode = mode;
+    pong_render_stats = PongRenderStats();
+    pong_render_stats.mode = mode;
 }
 
-void render_game_state() {
-    tft.fillRect(pong.player.x, pong.player.y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
-    tft.fillRect(pong.ai.x, pong.ai.y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
-    tft.fillRect(pong.ball.x, pong.ball.y, BALL_SIZE, BALL_SIZE, TFT_WHITE);
+PongRenderStats pong_get_render_stats() { return pong_render_stats; }
 
-    tft.setCursor(SCREEN_WIDTH / 4 - 8, BORDER_SIZE + 2);
-    tft.print(pong.player_score);
-    tft.setCursor(3 * SCREEN_WIDTH / 4 - 8, BORDER_SIZE + 2);
-    tft.print(pong.ai_score);
+PongRenderMode pong_toggle_render_mode() {
+    pong_requested_mode = pong_requested_mode == PONG_RENDER_SPRITE ? PONG_RENDER_DIRECT : PONG_RENDER_SPRITE;
+    return pong_requested_mode;
 }
 
+GameLoopStats pong_get_loop_stats() { return game_loop_get_stats(&pong_loop); }
+
 void pong_gameover() {
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
     const char *result =
         pong.player_score > pong.ai_score ? "You Win!" : "Game Over!";
     draw_centered_text(result, 60, TFT_WHITE, 2);
@@ -368,71 +280,93 @@ void pong_gameover() {
 
 void pong_task(void *pv) {
     initialize_pong_game();
-    static int prev_player_y = pong.player.y;
-    static int prev_ai_y = pong.ai.y;
-    static Position prev_ball = pong.ball;
 
-    while (current_state == STATE_PONG) {
+    // What is on screen, which lags the simulation when renders are skipped
+    int prev_player_y = pong.player.y;
+    int prev_ai_y = pong.ai.y;
+    Position prev_ball = pong.ball;
+    int prev_score_total = 0;
+
+    game_loop_start(&pong_loop, PONG_STEP_MS, PONG_RENDER_MS);
+
+    while (game_loop_wait(&pong_loop, &pong_stop)) {
+        TRACE_BEGIN(TRACE_PONG_TICK);
         xSemaphoreTake(pong_mutex, portMAX_DELAY);
 
         if (!pong.running) {
             xSemaphoreGive(pong_mutex);
             pong_gameover();
-            vTaskSuspend(NULL);
-            vTaskSuspend(pong_input_task_handle);
+            task_stop_wait(&pong_stop);
             break;
         }
 
-        erase_previous_positions(prev_player_y, prev_ai_y, prev_ball);
-        update_ball_position();
-        handle_wall_collisions();
-        handle_paddle_collisions();
-        update_ai_paddle();
-        update_scores();
-        
-        // Render game elements
-        tft.fillRect(pong.player.x, pong.player.y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
-        tft.fillRect(pong.ai.x, pong.ai.y, PADDLE_WIDTH, PADDLE_HEIGHT, TFT_WHITE);
-        tft.fillRect(pong.ball.x, pong.ball.y, BALL_SIZE, BALL_SIZE, TFT_WHITE);
-        
-        // Always render score on top
-        tft.setTextColor(TFT_WHITE);
-        tft.fillRect(SCREEN_WIDTH/4 - 10, BORDER_SIZE + 2, 20, 10, TFT_BLACK); // Clear score area
-        tft.fillRect(3*SCREEN_WIDTH/4 - 10, BORDER_SIZE + 2, 20, 10, TFT_BLACK);
-        tft.setCursor(SCREEN_WIDTH/4 - 8, BORDER_SIZE + 2);
-        tft.print(pong.player_score);
-        tft.setCursor(3*SCREEN_WIDTH/4 - 8, BORDER_SIZE + 2);
-        tft.print(pong.ai_score);
+        uint32_t frame_start = micros();
+
+        update_game();
 
         if (pong.player_score >= pong.score_limit || pong.ai_score >= pong.score_limit) {
             pong.running = 0;
         }
 
-        prev_player_y = pong.player.y;
-        prev_ai_y = pong.ai.y;
-        prev_ball = pong.ball;
+        // Render game elements
+        if (game_loop_render_due(&pong_loop)) {
+            const PongRenderMode requested = pong_requested_mode;
+            if (requested != pong_applied_mode) {
+                apply_render_mode(requested);
+            }
+
+            uint32_t wait_us;
+            if (pong_render_mode == PONG_RENDER_SPRITE) {
+                wait_us = render_frame_sprite();
+            } else {
+                int score_total = pong.player_score + pong.ai_score;
+                render_frame_direct(prev_player_y, prev_ai_y, prev_ball, score_total != prev_score_total);
+                prev_score_total = score_total;
+
+                uint32_t wait_start = micros();
+                render_sync();
+                wait_us = micros() - wait_start;
+            }
+
+            uint32_t frame_us = micros() - frame_start;
+            pong_render_stats.frames++;
+            pong_render_stats.frame_us_total += frame_us;
+            pong_render_stats.frame_us_max = max(pong_render_stats.frame_us_max, frame_us);
+            pong_render_stats.spi_wait_us_total += wait_us;
+
+            prev_player_y = pong.player.y;
+            prev_ai_y = pong.ai.y;
+            prev_ball = pong.ball;
+        }
 
         xSemaphoreGive(pong_mutex);
-        vTaskDelay(pdMS_TO_TICKS(30));
+        TRACE_END(TRACE_PONG_TICK);
+        game_loop_frame_done(&pong_loop);
     }
+    task_stop_exit(&pong_stop);
 }
 
-void pong_init_mutex() { pong_mutex = xSemaphoreCreateMutex(); }
+void pong_init_mutex() {
+    pong_mutex = xSemaphoreCreateMutex();
+    task_stop_init(&pong_stop);
+    pong_input = input_subscribe(STATE_PONG, INPUT_ARROWS | INPUT_MASK(INPUT_B));
+}
 
 void pong_launch_tasks() {
-    initialize_pong_game();
-    xTaskCreate(pong_task, "PongTask", 4096, NULL, 1, &pong_task_handle);
-    xTaskCreate(pong_input_task, "PongInput", 4096, NULL, 1, &pong_input_task_handle);
+    pong_render_mode = PONG_RENDER_DIRECT;  // No bands to delete yet
+    apply_render_mode(pong_requested_mode);
+
+    // pong_task shows the settings and sets up the game
+    input_flush(pong_input);
+    task_stop_reset(&pong_stop);
+    xTaskCreate(pong_task, "PongTask", 4096, NULL, 1, &pong_stop.task);
 }
 
 void pong_exit() {
-    if (pong_task_handle != NULL) {
-        vTaskDelete(pong_task_handle);
-        pong_task_handle = NULL;
-    }
-    
-    if (pong_input_task_handle != NULL) {
-        vTaskDelete(pong_input_task_handle);
-        pong_input_task_handle = NULL;
+    // Waits for the frame in progress, so the bands are no longer in flight
+    task_stop_join(&pong_stop);
+
+    if (pong_render_mode == PONG_RENDER_SPRITE) {
+        delete_bands();
     }
 }
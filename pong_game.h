@@ -1,6 +1,21 @@
 #pragma once
 #include "common.h"
 
+enum PongRenderMode { PONG_RENDER_DIRECT, PONG_RENDER_SPRITE };
+
+struct PongRenderStats {
+    PongRenderMode mode;
+    uint32_t frames;
+    uint32_t frame_us_total;     // simulation plus drawing, per frame
+    uint32_t frame_us_max;
+    uint32_t spi_wait_us_total;  // time the game task spent waiting on the display
+};
+
+PongRenderStats pong_get_render_stats();
+// Switches between the render modes, from the next frame or the next game.
+// Returns the mode asked for.
+PongRenderMode pong_toggle_render_mode();
+GameLoopStats pong_get_loop_stats();
 void pong_launch_tasks();
 void pong_init_mutex();
 void pong_exit();
\ No newline at end of file
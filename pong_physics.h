@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+
+// Pong ball physics in Q16.16 fixed point. Each step sweeps the ball along
+// its velocity and resolves the earliest wall or paddle contact first, so a
+// fast ball can't skip over a paddle, and the same inputs give the same
+// result on the host and the device.
+
+#define PONG_WIDTH 128          // SCREEN_WIDTH
+#define PONG_HEIGHT 160         // SCREEN_HEIGHT
+#define PONG_BORDER 4           // BORDER_SIZE
+#define PONG_PADDLE_WIDTH 4
+#define PONG_PADDLE_HEIGHT 20
+#define PONG_BALL_SIZE 4
+#define PONG_MAX_CONTACTS 4     // per step, the rest of the step is dropped
+
+typedef int32_t fix16;
+
+#define FIX16_SHIFT 16
+#define FIX16_ONE (1 << FIX16_SHIFT)
+
+// For constants: evaluated at compile time, so no float reaches the device
+constexpr fix16 fix16_const(double v) { return (fix16)(v * FIX16_ONE + (v >= 0 ? 0.5 : -0.5)); }
+
+inline fix16 fix16_from_int(int v) { return (fix16)(v * FIX16_ONE); }
+inline int fix16_floor(fix16 v) { return v >> FIX16_SHIFT; }
+inline int fix16_round(fix16 v) { return (v + FIX16_ONE / 2) >> FIX16_SHIFT; }
+inline fix16 fix16_abs(fix16 v) { return v < 0 ? -v : v; }
+inline fix16 fix16_mul(fix16 a, fix16 b) { return (fix16)(((int64_t)a * b) >> FIX16_SHIFT); }
+inline fix16 fix16_div(fix16 a, fix16 b) { return (fix16)(((int64_t)a * FIX16_ONE) / b); }
+
+inline fix16 fix16_clamp(fix16 v, fix16 lo, fix16 hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+// Top-left corner in pixels, velocity in pixels per step
+struct PongBall {
+    fix16 x, y;
+    fix16 dx, dy;
+};
+
+enum PongHit : uint8_t {
+    PONG_HIT_WALL = 0x01,
+    PONG_HIT_PLAYER = 0x02,  // left paddle
+    PONG_HIT_AI = 0x04,      // right paddle
+};
+
+struct PongContact {
+    uint8_t hits;        // PongHit flags
+    fix16 player_offset;  // ball center below the paddle top at the last hit of each paddle
+    fix16 ai_offset;
+};
+
+const fix16 PONG_TOP = fix16_const(PONG_BORDER);
+const fix16 PONG_BOTTOM = fix16_const(PONG_HEIGHT - PONG_BORDER - PONG_BALL_SIZE);
+const fix16 PONG_PLAYER_FACE = fix16_const(PONG_BORDER + PONG_PADDLE_WIDTH);
+const fix16 PONG_AI_FACE = fix16_const(PONG_WIDTH - PONG_BORDER - PONG_PADDLE_WIDTH - PONG_BALL_SIZE);
+
+// Fraction of the step until pos reaches target, if that happens within limit
+inline bool pong_time_of_impact(fix16 pos, fix16 velocity, fix16 target, fix16 limit, fix16 *t) {
+    if (velocity == 0) return false;
+    if ((velocity < 0 && pos < target) || (velocity > 0 && pos > target)) return false;  // Already past
+
+    // In 64 bits, a slow ball far from the target would overflow Q16.16
+    const int64_t hit = ((int64_t)(target - pos) * FIX16_ONE) / velocity;
+    if (hit > limit) return false;
+    *t = (fix16)hit;
+    return true;
+}
+
+inline bool pong_paddle_overlaps(fix16 ball_y, int paddle_y) {
+    return ball_y + fix16_const(PONG_BALL_SIZE) > fix16_from_int(paddle_y) &&
+           ball_y < fix16_from_int(paddle_y + PONG_PADDLE_HEIGHT);
+}
+
+// Advances the ball by one step. Walls reflect dy, paddle faces reflect dx;
+// how the game speeds up or spins the ball after a hit is up to the caller.
+// Paddles are only solid on their inner face, and the ball leaves the field
+// past them.
+inline PongContact pong_physics_step(PongBall *ball, int player_y, int ai_y) {
+    PongContact contact = {0, 0, 0};
+    fix16 remaining = FIX16_ONE;
+
+    for (int i = 0; i < PONG_MAX_CONTACTS && remaining > 0; i++) {
+        fix16 t = remaining;
+        fix16 hit_t;
+        uint8_t hit = 0;
+
+        const fix16 wall = ball->dy < 0 ? PONG_TOP : PONG_BOTTOM;
+        if (pong_time_of_impact(ball->y, ball->dy, wall, t, &hit_t)) {
+            t = hit_t;
+            hit = PONG_HIT_WALL;
+        }
+
+        const bool left = ball->dx < 0;
+        const fix16 face = left ? PONG_PLAYER_FACE : PONG_AI_FACE;
+        if (pong_time_of_impact(ball->x, ball->dx, face, t, &hit_t)) {
+            // Where the ball is vertically at that moment decides whether it hits the paddle
+            const fix16 y_at = ball->y + fix16_mul(ball->dy, hit_t);
+            if (pong_paddle_overlaps(y_at, left ? player_y : ai_y)) {
+                t = hit_t;
+                hit = left ? PONG_HIT_PLAYER : PONG_HIT_AI;
+            }
+        }
+
+        ball->x += fix16_mul(ball->dx, t);
+        ball->y += fix16_mul(ball->dy, t);
+        remaining -= t;
+
+        if (hit == PONG_HIT_WALL) {
+            ball->y = wall;
+            ball->dy = -ball->dy;
+        } else if (hit) {
+            const int paddle_y = hit == PONG_HIT_PLAYER ? player_y : ai_y;
+            const fix16 offset = ball->y + fix16_const(PONG_BALL_SIZE / 2.0) - fix16_from_int(paddle_y);
+            ball->x = face;
+            ball->dx = -ball->dx;
+            if (hit == PONG_HIT_PLAYER) {
+                contact.player_offset = offset;
+            } else {
+                contact.ai_offset = offset;
+            }
+        }
+        contact.hits |= hit;
+    }
+    return contact;
+}
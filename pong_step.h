@@ -0,0 +1,137 @@
+#pragma once
+#include "pong_ai.h"
+
+// One Pong step as a pure function of the game state, the difficulty and
+// the player's move. Randomness comes from a seed in the state, so a game
+// replays exactly from its seed. No allocation and no globals, so the host
+// can run many games at once (tools/pong_selfplay.cpp).
+
+#define PONG_PADDLE_SPEED 4  // player, pixels per step
+
+enum Difficulty { EASY, NORMAL, HARD, IMPOSSIBLE };
+#define PONG_DIFFICULTIES 4
+
+struct PongRules {
+    PongAiProfile ai;
+    fix16 serve_speed;       // horizontal, pixels per step
+    uint8_t serve_angles;    // the serve's dy is one of this many steps, centered on 0
+    fix16 serve_angle_step;
+    bool ai_aims_away;       // the AI returns the ball away from the player instead of spinning it
+};
+
+const fix16 PONG_SPEED_INCREASE = fix16_const(0.5);  // on each paddle hit
+const fix16 PONG_MAX_SPEED_X = fix16_const(5.0);
+const fix16 PONG_MAX_SPEED_Y = fix16_const(3.0);
+
+// Indexed by Difficulty
+const PongRules PONG_RULES[PONG_DIFFICULTIES] = {
+    {{6, 10, 2}, fix16_const(2.0), 3, fix16_const(0.6), false},  // EASY
+    {{4, 6, 3}, fix16_const(2.0), 3, fix16_const(0.6), false},   // NORMAL
+    {{2, 3, 5}, fix16_const(2.5), 3, fix16_const(0.6), false},   // HARD
+    {{0, 0, 8}, fix16_const(3.0), 5, fix16_const(0.8), true},    // IMPOSSIBLE
+};
+
+struct PongState {
+    int player_y;  // paddle tops
+    int ai_y;
+    PongBall ball;
+    PongAi ai;
+    uint16_t player_score;
+    uint16_t ai_score;
+    uint32_t seed;  // xorshift32, never 0
+};
+
+enum PongEvent : uint8_t {
+    PONG_EVENT_PLAYER_HIT = 0x01,
+    PONG_EVENT_AI_HIT = 0x02,
+    PONG_EVENT_PLAYER_SCORED = 0x04,
+    PONG_EVENT_AI_SCORED = 0x08,
+};
+
+// 0 .. 2^31 - 1
+inline int pong_random(PongState *state) {
+    uint32_t x = state->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->seed = x;
+    return (int)(x >> 1);
+}
+
+inline int pong_clamp_paddle(int y) {
+    if (y < PONG_BORDER) return PONG_BORDER;
+    if (y > PONG_HEIGHT - PONG_BORDER - PONG_PADDLE_HEIGHT) return PONG_HEIGHT - PONG_BORDER - PONG_PADDLE_HEIGHT;
+    return y;
+}
+
+// From the middle of the field at a random height, towards whoever just scored
+inline void pong_serve(PongState *state, const PongRules *rules, bool towards_player) {
+    PongBall *ball = &state->ball;
+    ball->x = fix16_from_int(PONG_WIDTH / 2);
+    ball->y = fix16_from_int(PONG_BORDER + pong_random(state) % (PONG_HEIGHT - 2 * PONG_BORDER - PONG_BALL_SIZE));
+    ball->dx = towards_player ? -rules->serve_speed : rules->serve_speed;
+    ball->dy = (pong_random(state) % rules->serve_angles - rules->serve_angles / 2) * rules->serve_angle_step;
+}
+
+inline void pong_reset(PongState *state, const PongRules *rules, uint32_t seed) {
+    state->player_y = (PONG_HEIGHT - PONG_PADDLE_HEIGHT) / 2;
+    state->ai_y = (PONG_HEIGHT - PONG_PADDLE_HEIGHT) / 2;
+    state->player_score = 0;
+    state->ai_score = 0;
+    state->seed = seed ? seed : 1;
+    pong_ai_reset(&state->ai, state->ai_y);
+
+    pong_serve(state, rules, pong_random(state) % 2);
+    state->ball.y = fix16_from_int(PONG_HEIGHT / 2);
+}
+
+// -1.0 at the top of the paddle to +1.0 at the bottom, from the ball center at impact
+inline fix16 pong_paddle_spin(fix16 hit_offset) {
+    return (2 * hit_offset - fix16_from_int(PONG_PADDLE_HEIGHT)) / PONG_PADDLE_HEIGHT;
+}
+
+inline fix16 pong_hit_speed(fix16 dx) {
+    const fix16 speed = fix16_abs(dx) + PONG_SPEED_INCREASE;
+    return speed < PONG_MAX_SPEED_X ? speed : PONG_MAX_SPEED_X;
+}
+
+// player_move is -1 (up), 0 or 1 (down). Returns PongEvent flags.
+inline uint8_t pong_step(PongState *state, const PongRules *rules, int player_move) {
+    uint8_t events = 0;
+    state->player_y = pong_clamp_paddle(state->player_y + player_move * PONG_PADDLE_SPEED);
+
+    // Sweep the ball, then speed it up and spin it for each paddle it hit
+    PongBall *ball = &state->ball;
+    const PongContact contact = pong_physics_step(ball, state->player_y, state->ai_y);
+
+    if (contact.hits & PONG_HIT_PLAYER) {
+        ball->dx = pong_hit_speed(ball->dx);
+        ball->dy += pong_paddle_spin(contact.player_offset);
+        events |= PONG_EVENT_PLAYER_HIT;
+    }
+    if (contact.hits & PONG_HIT_AI) {
+        ball->dx = -pong_hit_speed(ball->dx);
+        if (rules->ai_aims_away) {
+            const fix16 aim = fix16_const(2.0) + (pong_random(state) % 200) * FIX16_ONE / 100;
+            ball->dy = state->player_y > PONG_HEIGHT / 2 ? -aim : aim;
+        } else {
+            ball->dy += pong_paddle_spin(contact.ai_offset);
+        }
+        events |= PONG_EVENT_AI_HIT;
+    }
+    ball->dy = fix16_clamp(ball->dy, -PONG_MAX_SPEED_Y, PONG_MAX_SPEED_Y);
+
+    state->ai_y = pong_ai_step(&state->ai, &rules->ai, ball, state->ai_y, pong_random(state));
+
+    const int ball_x = fix16_round(ball->x);
+    if (ball_x < 0) {
+        state->ai_score++;
+        pong_serve(state, rules, false);
+        events |= PONG_EVENT_AI_SCORED;
+    } else if (ball_x > PONG_WIDTH) {
+        state->player_score++;
+        pong_serve(state, rules, true);
+        events |= PONG_EVENT_PLAYER_SCORED;
+    }
+    return events;
+}
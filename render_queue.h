@@ -0,0 +1,167 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include "display.h"
+#include "color332.h"
+
+// The render task's command queue and what each command draws, apart from
+// the task itself (renderer.cpp), so a host program can run the same
+// commands against a FramebufferDisplay.
+
+#define RENDER_TEXT_MAX 32
+#define RENDER_QUEUE_SIZE 64  // power of two
+#define RENDER_ROW_MAX 128    // SCREEN_WIDTH, the widest 8-bit sprite row
+
+enum DrawOp : uint8_t {
+    DRAW_CLEAR, DRAW_RECT, DRAW_TEXT, DRAW_BLIT, DRAW_BLIT_DMA, DRAW_SPRITE, DRAW_CALL, DRAW_FENCE
+};
+
+struct DrawCommand {
+    uint8_t op;
+    uint8_t size;
+    int16_t x, y, w, h;
+    uint16_t color, bg;
+    union {
+        char text[RENDER_TEXT_MAX];
+        const uint16_t *pixels;
+        uint16_t *dma_pixels;
+        struct {
+            const void *sprite_pixels;  // 8 or 16 bits deep, rows of stride pixels
+            int16_t sx, sy, stride;
+            uint8_t depth;
+        };
+        struct {
+            void (*fn)(void *);
+            void *arg;
+        };
+        void *waiter;  // the task to wake, a TaskHandle_t on the device
+    };
+};
+
+// Bounded multi-producer single-consumer queue. Each slot's sequence number
+// tells producers when it is free and the render task when it is filled, so
+// producers on both cores never take a lock.
+struct RenderSlot {
+    std::atomic<uint32_t> sequence;
+    DrawCommand command;
+};
+
+struct RenderQueue {
+    RenderSlot slots[RENDER_QUEUE_SIZE];
+    std::atomic<uint32_t> enqueue_pos;
+    uint32_t dequeue_pos;
+};
+
+// Only call while nothing is pushing or popping
+inline void render_queue_reset(RenderQueue *queue) {
+    for (uint32_t i = 0; i < RENDER_QUEUE_SIZE; i++) {
+        queue->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    queue->enqueue_pos.store(0, std::memory_order_relaxed);
+    queue->dequeue_pos = 0;
+}
+
+// Any producer. Returns false if the queue is full.
+inline bool render_queue_push(RenderQueue *queue, const DrawCommand &cmd) {
+    uint32_t pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+
+    while (true) {
+        RenderSlot &slot = queue->slots[pos & (RENDER_QUEUE_SIZE - 1)];
+        const int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+
+        if (diff == 0) {
+            if (queue->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.command = cmd;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;  // Full
+        } else {
+            pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// The render task only
+inline bool render_queue_pop(RenderQueue *queue, DrawCommand *cmd) {
+    RenderSlot &slot = queue->slots[queue->dequeue_pos & (RENDER_QUEUE_SIZE - 1)];
+    if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (queue->dequeue_pos + 1)) < 0) {
+        return false;  // Empty, or the producer has not finished writing the slot
+    }
+
+    *cmd = slot.command;
+    slot.sequence.store(queue->dequeue_pos + RENDER_QUEUE_SIZE, std::memory_order_release);
+    queue->dequeue_pos++;
+    return true;
+}
+
+// The display commands are drawn on, and the render task's scratch space.
+// 8-bit sprites are RGB332; each row is expanded to RGB565 in display byte order.
+struct RenderTarget {
+    Display *display;
+    int width, height;
+    uint16_t palette_332[256];
+    uint16_t sprite_row[RENDER_ROW_MAX];
+};
+
+inline void render_target_init(RenderTarget *target, Display *display, int width, int height) {
+    target->display = display;
+    target->width = width;
+    target->height = height;
+    for (int c = 0; c < 256; c++) {
+        const uint16_t color = color332_to_565((uint8_t)c);
+        target->palette_332[c] = (uint16_t)(color << 8 | color >> 8);
+    }
+}
+
+inline void render_push_sprite_8(RenderTarget *target, const DrawCommand &cmd) {
+    const uint8_t *pixels = (const uint8_t *)cmd.sprite_pixels;
+
+    target->display->set_window(cmd.x, cmd.y, cmd.w, cmd.h);
+    for (int row = 0; row < cmd.h; row++) {
+        const uint8_t *src = pixels + (cmd.sy + row) * cmd.stride + cmd.sx;
+        for (int i = 0; i < cmd.w; i++) {
+            target->sprite_row[i] = target->palette_332[src[i]];
+        }
+        target->display->push_pixels(target->sprite_row, cmd.w);
+    }
+}
+
+// Draws cmd. A DRAW_FENCE only waits for the DMA here; the caller wakes cmd.waiter.
+inline void render_execute(RenderTarget *target, const DrawCommand &cmd) {
+    Display *display = target->display;
+
+    switch (cmd.op) {
+        case DRAW_CLEAR:
+            display->fill_rect(0, 0, target->width, target->height, cmd.color);
+            break;
+        case DRAW_RECT:
+            display->fill_rect(cmd.x, cmd.y, cmd.w, cmd.h, cmd.color);
+            break;
+        case DRAW_TEXT:
+            display->draw_text(cmd.x, cmd.y, cmd.text, cmd.color, cmd.bg, cmd.size);
+            break;
+        case DRAW_BLIT:
+            display->push_image(cmd.x, cmd.y, cmd.w, cmd.h, cmd.pixels, cmd.w);
+            break;
+        case DRAW_BLIT_DMA:
+            display->push_image_dma(cmd.x, cmd.y, cmd.w, cmd.h, cmd.dma_pixels);
+            break;
+        case DRAW_SPRITE: {
+            if (cmd.depth == 8) {
+                render_push_sprite_8(target, cmd);
+                break;
+            }
+            const uint16_t *pixels = (const uint16_t *)cmd.sprite_pixels;
+            display->push_image(cmd.x, cmd.y, cmd.w, cmd.h, pixels + cmd.sy * cmd.stride + cmd.sx, cmd.stride);
+            break;
+        }
+        case DRAW_CALL:
+            cmd.fn(cmd.arg);
+            break;
+        case DRAW_FENCE:
+            display->wait_dma();
+            break;
+    }
+}
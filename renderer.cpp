@@ -0,0 +1,134 @@
+#include "common.h"
+#include "render_queue.h"
+
+static RenderQueue queue;
+static RenderTarget target;
+
+TaskHandle_t render_task_handle = NULL;
+
+void submit(const DrawCommand &cmd) {
+    while (true) {
+        // Keep the submitting task from being preempted or deleted halfway
+        // through a push, which would stall the render task on that slot
+        vTaskSuspendAll();
+        const bool pushed = render_queue_push(&queue, cmd);
+        xTaskResumeAll();
+
+        if (pushed) break;
+        vTaskDelay(1);  // Full, let the render task catch up
+    }
+    xTaskNotifyGive(render_task_handle);
+}
+
+void execute(const DrawCommand &cmd) {
+    render_execute(&target, cmd);
+    if (cmd.op == DRAW_FENCE) {
+        xTaskNotifyGive((TaskHandle_t)cmd.waiter);
+    }
+}
+
+void render_task(void *pv) {
+    DrawCommand cmd;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Everything queued since the last wake-up goes out in one transaction
+        target.display->begin_write();
+        while (render_queue_pop(&queue, &cmd)) {
+            execute(cmd);
+        }
+        target.display->end_write();
+    }
+}
+
+void renderer_init(Display *backend) {
+    render_target_init(&target, backend, SCREEN_WIDTH, SCREEN_HEIGHT);
+    render_queue_reset(&queue);
+    xTaskCreatePinnedToCore(render_task, "Render", 4096, NULL, 2, &render_task_handle, 1);
+}
+
+Display *render_display() { return target.display; }
+
+void render_clear(uint16_t color) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_CLEAR;
+    cmd.color = color;
+    submit(cmd);
+}
+
+void render_rect(int x, int y, int w, int h, uint16_t color) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_RECT;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.w = w;
+    cmd.h = h;
+    cmd.color = color;
+    submit(cmd);
+}
+
+void render_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_TEXT;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.color = color;
+    cmd.bg = bg;
+    cmd.size = size;
+    strncpy(cmd.text, text, RENDER_TEXT_MAX - 1);
+    submit(cmd);
+}
+
+void render_blit(int x, int y, int w, int h, const uint16_t *pixels) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_BLIT;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.w = w;
+    cmd.h = h;
+    cmd.pixels = pixels;
+    submit(cmd);
+}
+
+void render_blit_dma(int x, int y, int w, int h, uint16_t *pixels) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_BLIT_DMA;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.w = w;
+    cmd.h = h;
+    cmd.dma_pixels = pixels;
+    submit(cmd);
+}
+
+void render_sprite(TFT_eSprite *sprite, int x, int y, int sx, int sy, int sw, int sh) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_SPRITE;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.w = sw;
+    cmd.h = sh;
+    cmd.sprite_pixels = sprite->getPointer();
+    cmd.sx = sx;
+    cmd.sy = sy;
+    cmd.stride = sprite->width();
+    cmd.depth = sprite->getColorDepth();
+    submit(cmd);
+}
+
+void render_call(void (*fn)(void *), void *arg) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_CALL;
+    cmd.fn = fn;
+    cmd.arg = arg;
+    submit(cmd);
+}
+
+void render_sync() {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_FENCE;
+    cmd.waiter = xTaskGetCurrentTaskHandle();
+    submit(cmd);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include "render_queue.h"
+
+// Single owner of the display. Every module submits draw commands here instead
+// of drawing on the display directly; the render task drains them in one bus
+// transaction. Commands are executed in submission order per task.
+
+void renderer_init(Display *display);
+// The backend, only for drawing from render_call() functions
+Display *render_display();
+
+void render_clear(uint16_t color);
+void render_rect(int x, int y, int w, int h, uint16_t color);
+// Text is copied into the command. bg == color draws without a background.
+void render_text(int x, int y, const char *text, uint16_t color, uint16_t bg, uint8_t size);
+// pixels and sprite are referenced, not copied: keep them unchanged until render_sync()
+void render_blit(int x, int y, int w, int h, const uint16_t *pixels);
+// sprite must be 8 or 16-bit and the area must lie on the screen. 8-bit
+// sprites are expanded a row at a time, so sw is at most SCREEN_WIDTH.
+void render_sprite(TFT_eSprite *sprite, int x, int y, int sx, int sy, int sw, int sh);
+// Starts a DMA transfer of pixels in display byte order (e.g. a 16-bit sprite
+// buffer). The transfer has finished once a later render_sync() returns.
+void render_blit_dma(int x, int y, int w, int h, uint16_t *pixels);
+// Runs fn on the render task with the bus held, for drawing that streams
+// pixels itself. fn must not submit render commands.
+void render_call(void (*fn)(void *), void *arg);
+// Blocks until everything submitted so far has been drawn, DMA transfers included
+void render_sync();
@@ -0,0 +1,221 @@
+#include <malloc.h>
+#include <stdarg.h>
+#include <atomic>
+#include <Arduino.h>
+#include "sim.h"
+
+// The Arduino core for the simulator: virtual time, the button pins, a
+// seeded random source, Serial on stdout and heap figures.
+
+const int PIN_COUNT = 40;
+const int SERIAL_INPUT_SIZE = 256;  // power of two
+const uint32_t SIM_HEAP_SIZE = 320 * 1024;  // what the firmware starts with, roughly, on the device
+
+HardwareSerial Serial;
+EspClass ESP;
+
+struct Pin {
+    int level;
+    int mode;
+    void (*isr)(void *);
+    void (*plain_isr)();
+    void *arg;
+};
+
+static Pin pins[PIN_COUNT];
+static uint32_t random_state = 0;
+
+static char serial_input[SERIAL_INPUT_SIZE];
+static uint32_t serial_head = 0;
+static uint32_t serial_tail = 0;
+
+unsigned long millis() { return (unsigned long)(sim_now_us() / 1000); }
+
+unsigned long micros() { return (unsigned long)sim_now_us(); }
+
+int64_t esp_timer_get_time() { return (int64_t)sim_now_us(); }
+
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+// Busy waits take virtual time like a transfer does
+void delayMicroseconds(uint32_t us) { sim_bus_wait_us(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].level = mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) { return pin < PIN_COUNT ? pins[pin].level : LOW; }
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].isr = isr;
+    pins[pin].plain_isr = nullptr;
+    pins[pin].arg = arg;
+    pins[pin].mode = mode;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].isr = nullptr;
+    pins[pin].plain_isr = isr;
+    pins[pin].mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= PIN_COUNT) return;
+    pins[pin].isr = nullptr;
+    pins[pin].plain_isr = nullptr;
+}
+
+// Raises the pin's interrupt, on the calling task, when the edge matches
+void sim_set_pin(uint8_t pin, int level) {
+    if (pin >= PIN_COUNT || pins[pin].level == level) return;
+    Pin &p = pins[pin];
+    p.level = level;
+
+    const bool edge = p.mode == CHANGE || (p.mode == RISING && level == HIGH) || (p.mode == FALLING && level == LOW);
+    if (!edge) return;
+    if (p.isr) p.isr(p.arg);
+    if (p.plain_isr) p.plain_isr();
+}
+
+uint32_t esp_random() {
+    if (random_state == 0) random_state = sim_options.seed ? sim_options.seed : 1;
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+long random(long max) { return max > 0 ? (long)(esp_random() % (uint32_t)max) : 0; }
+
+long random(long min, long max) { return min >= max ? min : min + random(max - min); }
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) random_state = (uint32_t)seed;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (size--) written += write(*buffer++);
+    return written;
+}
+
+size_t Print::printf(const char *format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write((const uint8_t *)line, min((size_t)length, sizeof(line) - 1));
+}
+
+void sim_serial_input(const char *text) {
+    for (; *text; text++) {
+        if (serial_tail - serial_head == SERIAL_INPUT_SIZE) return;  // Overrun, like a full UART FIFO
+        serial_input[serial_tail++ & (SERIAL_INPUT_SIZE - 1)] = *text;
+    }
+}
+
+int HardwareSerial::available() { return (int)(serial_tail - serial_head); }
+
+int HardwareSerial::read() {
+    if (serial_head == serial_tail) return -1;
+    return (uint8_t)serial_input[serial_head++ & (SERIAL_INPUT_SIZE - 1)];
+}
+
+void HardwareSerial::flush() {
+    if (!sim_options.quiet) fflush(stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (!sim_options.quiet) fwrite(buffer, 1, size, stdout);
+    return size;
+}
+
+uint32_t EspClass::getCycleCount() { return (uint32_t)(sim_now_us() * getCpuFreqMHz()); }
+
+// Heap accounting. malloc and friends are replaced with wrappers around
+// glibc's, which count calls and the usable size of live blocks; new and
+// delete go through them too. The heap the firmware sees is SIM_HEAP_SIZE
+// less what was allocated since the simulation started, so blocks the host
+// libraries hold from before then don't count.
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *block, size_t size);
+void __libc_free(void *block);
+}
+
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<int64_t> live_bytes(0);
+static std::atomic<int64_t> peak_bytes(0);
+static int64_t baseline_bytes = -1;
+
+static void count_allocation(void *block) {
+    if (!block) return;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const int64_t live = live_bytes.fetch_add(malloc_usable_size(block), std::memory_order_relaxed) +
+                         (int64_t)malloc_usable_size(block);
+    int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+static void count_free(void *block) {
+    if (block) live_bytes.fetch_sub(malloc_usable_size(block), std::memory_order_relaxed);
+}
+
+extern "C" {
+void *malloc(size_t size) {
+    void *block = __libc_malloc(size);
+    count_allocation(block);
+    return block;
+}
+
+void *calloc(size_t count, size_t size) {
+    void *block = __libc_calloc(count, size);
+    count_allocation(block);
+    return block;
+}
+
+void *realloc(void *block, size_t size) {
+    count_free(block);
+    void *moved = __libc_realloc(block, size);
+    if (moved) {
+        count_allocation(moved);
+    } else if (block && size) {
+        live_bytes.fetch_add(malloc_usable_size(block), std::memory_order_relaxed);  // Left in place
+    }
+    return moved;
+}
+
+void free(void *block) {
+    count_free(block);
+    __libc_free(block);
+}
+}
+
+SimHeap sim_heap() {
+    if (baseline_bytes < 0) baseline_bytes = live_bytes.load();
+    SimHeap heap = {allocations.load(), live_bytes.load() - baseline_bytes, peak_bytes.load() - baseline_bytes};
+    return heap;
+}
+
+uint32_t EspClass::getHeapSize() { return SIM_HEAP_SIZE; }
+
+uint32_t EspClass::getFreeHeap() {
+    const int64_t used = sim_heap().live_bytes;
+    return used >= (int64_t)SIM_HEAP_SIZE ? 0 : (uint32_t)(SIM_HEAP_SIZE - used);
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    const int64_t peak = sim_heap().peak_bytes;
+    return peak >= (int64_t)SIM_HEAP_SIZE ? 0 : (uint32_t)(SIM_HEAP_SIZE - peak);
+}
+
+// Fragmentation isn't modelled
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+// The ArduinoWebsockets client, connected to the simulator's Live Pixel relay
+// (sim/relay.cpp) instead of a socket. Whatever the URL, connect() reaches the
+// relay unless the simulator runs with --no-server. Messages and events are
+// delivered from poll(), on the polling task, as the library does.
+
+namespace websockets {
+
+enum class WebsocketsEvent { ConnectionOpened, ConnectionClosed, GotPing, GotPong };
+
+class WebsocketsMessage {
+public:
+    WebsocketsMessage(const std::string &raw, bool binary) : raw(&raw), binary(binary) {}
+    const std::string &rawData() const { return *raw; }
+    String data() const { return String(raw->c_str()); }
+    bool isBinary() const { return binary; }
+    bool isText() const { return !binary; }
+
+private:
+    const std::string *raw;  // the relay's buffer, valid during the callback
+    bool binary;
+};
+
+typedef std::function<void(WebsocketsMessage)> MessageCallback;
+typedef std::function<void(WebsocketsEvent, String)> EventCallback;
+
+class WebsocketsClient {
+public:
+    bool connect(const char *url);
+    bool connect(const String &url) { return connect(url.c_str()); }
+    bool available();
+    bool poll();
+    void close();
+
+    void onMessage(MessageCallback callback) { on_message = callback; }
+    void onEvent(EventCallback callback) { on_event = callback; }
+
+    bool send(const char *text) { return send(text, strlen(text)); }
+    bool send(const char *text, size_t length);
+    bool sendBinary(const char *data, size_t length);
+
+    // For the simulator's relay, from poll()
+    void deliver(const std::string &raw, bool binary);
+
+private:
+    void closed();
+
+    MessageCallback on_message;
+    EventCallback on_event;
+    bool open = false;
+};
+
+}  // namespace websockets
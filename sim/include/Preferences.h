@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// Non-volatile storage that lasts as long as the simulation. Implemented in
+// sim/network.cpp.
+
+class Preferences {
+public:
+    bool begin(const char *name, bool read_only = false);
+    void end() {}
+    size_t putString(const char *key, const char *value);
+    // Copies the value and its terminator into buffer, returns the length
+    // copied including the terminator, 0 if there is no such key
+    size_t getString(const char *key, char *buffer, size_t size);
+    String getString(const char *key, const String &default_value);
+
+private:
+    std::string space;
+};
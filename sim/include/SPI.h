@@ -0,0 +1,2 @@
+#pragma once
+// The panel is simulated above the bus, see TFT_eSPI.h
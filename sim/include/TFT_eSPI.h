@@ -0,0 +1,130 @@
+#pragma once
+#include <Arduino.h>
+
+// The TFT_eSPI calls the firmware makes, for the host simulator. TFT_eSPI
+// draws on the simulated panel, a FramebufferDisplay
+// (display_framebuffer.h), and the task drawing waits out the bus time the
+// panel counts. Sprites draw in memory like the library's: 16-bit sprites
+// hold RGB565 in display byte order, 8-bit sprites RGB332. Text is drawn as
+// a solid block per character. Implemented in sim/tft.cpp.
+
+#ifndef TFT_WIDTH
+#define TFT_WIDTH 128
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 160
+#endif
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_MAROON 0x7800
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_ORANGE 0xFDA0
+#define TFT_WHITE 0xFFFF
+
+class TFT_eSPI : public Print {
+public:
+    TFT_eSPI(int16_t width = TFT_WIDTH, int16_t height = TFT_HEIGHT);
+
+    void init() {}
+    void setRotation(uint8_t rotation) { (void)rotation; }
+    int16_t width() const { return panel_width; }
+    int16_t height() const { return panel_height; }
+
+    bool initDMA(bool ctrl_cs = false) {
+        (void)ctrl_cs;
+        return true;
+    }
+    void deInitDMA() {}
+    bool dmaBusy() { return false; }
+    void dmaWait();
+
+    void startWrite();
+    void endWrite();
+
+    void fillScreen(uint32_t color) { fillRect(0, 0, panel_width, panel_height, color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+
+    void setSwapBytes(bool swap) { (void)swap; }
+    bool getSwapBytes() { return false; }
+    void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+    void pushPixels(const void *pixels, uint32_t count);
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *pixels);
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *pixels, uint16_t *buffer = nullptr);
+
+    void setTextSize(uint8_t size) { text_size = size ? size : 1; }
+    void setTextColor(uint16_t color) { text_color = text_bg = color; }
+    void setTextColor(uint16_t color, uint16_t bg, bool fill = false) {
+        (void)fill;
+        text_color = color;
+        text_bg = bg;
+    }
+    void setCursor(int16_t x, int16_t y) {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *text, size_t size) override;
+    using Print::write;
+
+private:
+    void charge_bus();
+
+    int16_t panel_width, panel_height;
+    int write_depth;
+    int16_t cursor_x, cursor_y;
+    uint8_t text_size;
+    uint16_t text_color, text_bg;
+};
+
+class TFT_eSprite : public Print {
+public:
+    explicit TFT_eSprite(TFT_eSPI *tft);
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void *setColorDepth(int8_t depth);
+    int8_t getColorDepth() const { return depth; }
+    void *createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+    void deleteSprite();
+    bool created() const { return pixels != nullptr; }
+    void *getPointer() { return pixels; }
+    int16_t width() const { return sprite_width; }
+    int16_t height() const { return sprite_height; }
+
+    void fillSprite(uint32_t color) { fillRect(0, 0, sprite_width, sprite_height, color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+    // 1-bit bitmap, MSB first, rows padded to whole bytes; clear bits are left alone
+    void drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color);
+
+    void setTextSize(uint8_t size) { text_size = size ? size : 1; }
+    void setTextColor(uint16_t color) { text_color = text_bg = color; }
+    void setTextColor(uint16_t color, uint16_t bg, bool fill = false) {
+        (void)fill;
+        text_color = color;
+        text_bg = bg;
+    }
+    void setCursor(int16_t x, int16_t y) {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+private:
+    TFT_eSPI *tft;
+    int8_t depth;
+    void *pixels;
+    int16_t sprite_width, sprite_height;
+    int16_t cursor_x, cursor_y;
+    uint8_t text_size;
+    uint16_t text_color, text_bg;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+
+// A station that joins the network as soon as it is started, unless the
+// simulator runs with --no-wifi. Implemented in sim/network.cpp.
+
+#define WL_IDLE_STATUS 0
+#define WL_DISCONNECTED 6
+#define WL_CONNECTED 3
+
+#define WIFI_OFF 0
+#define WIFI_STA 1
+#define WIFI_AP 2
+#define WIFI_AP_STA 3
+#define WIFI_POWER_8_5dBm 34
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+    uint8_t operator[](int index) const { return octets[index]; }
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(text);
+    }
+
+private:
+    uint8_t octets[4];
+};
+
+class WiFiClass {
+public:
+    int status();
+    void mode(int mode);
+    void begin();
+    void disconnect(bool wifi_off = false);
+    IPAddress localIP();
+    void softAPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet) {
+        (void)ip;
+        (void)gateway;
+        (void)subnet;
+    }
+    void setTxPower(int power) { (void)power; }
+
+private:
+    int wifi_mode = WIFI_OFF;
+    bool started = false;
+};
+extern WiFiClass WiFi;
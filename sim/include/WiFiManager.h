@@ -0,0 +1,48 @@
+#pragma once
+#include <WiFi.h>
+
+// A configuration portal nobody connects to: startConfigPortal() blocks
+// until stopConfigPortal() and reports nothing was saved.
+
+class WiFiManagerParameter {
+public:
+    WiFiManagerParameter(const char *id, const char *label, const char *value, int length)
+        : value(value ? value : "") {
+        (void)id;
+        (void)label;
+        (void)length;
+    }
+    const char *getValue() { return value.c_str(); }
+
+private:
+    std::string value;
+};
+
+class WiFiManager {
+public:
+    bool startConfigPortal(const char *ap_name) {
+        (void)ap_name;
+        portal_open = true;
+        while (portal_open) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        return false;
+    }
+    void stopConfigPortal() { portal_open = false; }
+
+    void addParameter(WiFiManagerParameter *parameter) { (void)parameter; }
+    void setSaveConfigCallback(void (*callback)()) { (void)callback; }
+    void setAPStaticIPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet) {
+        (void)ip;
+        (void)gateway;
+        (void)subnet;
+    }
+    void setHostname(const char *name) { (void)name; }
+    void setConfigPortalTimeout(int seconds) { (void)seconds; }
+    void setCleanConnect(bool clean) { (void)clean; }
+    void setBreakAfterConfig(bool do_break) { (void)do_break; }
+    void setDebugOutput(bool debug) { (void)debug; }
+
+private:
+    volatile bool portal_open = false;
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+#define ESP_OK 0
+typedef int esp_err_t;
+typedef void (*esp_ipc_func_t)(void *arg);
+
+// One core runs everything, so the function is called in place
+inline esp_err_t esp_ipc_call_blocking(uint32_t core, esp_ipc_func_t func, void *arg) {
+    (void)core;
+    func(arg);
+    return ESP_OK;
+}
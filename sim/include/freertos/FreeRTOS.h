@@ -0,0 +1,48 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// FreeRTOS for the host simulator, with the ESP32 port's types and settings.
+// Implemented in sim/kernel.cpp.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define errQUEUE_FULL 0
+#define errQUEUE_EMPTY 0
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define configMAX_TASK_NAME_LEN 16
+#define configTIMER_TASK_PRIORITY 1
+#define configUSE_TRACE_FACILITY 1
+#define configGENERATE_RUN_TIME_STATS 1
+#define configSTACK_DEPTH_TYPE uint32_t
+
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portNUM_PROCESSORS 2
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// One task runs at a time, so critical sections have nothing to exclude
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) { mux->count++; }
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) { mux->count--; }
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE *mux) { mux->count++; }
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE *mux) { mux->count--; }
+
+// Interrupts run on the task that raises them, which yields when it blocks
+#define portYIELD_FROM_ISR(...) do {} while (0)
+
+BaseType_t xPortGetCoreID();
@@ -0,0 +1,18 @@
+#pragma once
+#include "queue.h"
+
+// Semaphores are queues of empty items, as in FreeRTOS. Mutexes don't track
+// their holder, so there is no priority inheritance.
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+#define vSemaphoreDelete vQueueDelete
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xQueueReceive(semaphore, nullptr, ticks);
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) { return xQueueSend(semaphore, nullptr, 0); }
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken) {
+    return xQueueSendFromISR(semaphore, nullptr, woken);
+}
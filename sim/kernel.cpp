@@ -0,0 +1,627 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+// FreeRTOS on pthreads, one task at a time, like a single core. Every task is
+// a thread, but only the one holding the baton runs; the others wait on their
+// own condition variable. A task hands the baton on when it blocks, or when it
+// wakes a task of higher priority. When no task is ready the clock jumps to
+// the next timeout, so virtual time passes only while every task waits: on a
+// delay, a queue, a notification or the display bus (sim_bus_wait_us).
+// Computation itself takes no virtual time.
+
+const int MAX_TASKS = 64;
+const int MAX_TIMERS = 16;
+const uint64_t NO_TIMEOUT = UINT64_MAX;
+const uint64_t US_PER_TICK = 1000000 / configTICK_RATE_HZ;
+
+enum TaskState { TASK_READY, TASK_BLOCKED, TASK_SUSPENDED, TASK_DELETED };
+
+struct WaitList {
+    tskTaskControlBlock *head;
+};
+
+struct tskTaskControlBlock {
+    pthread_t thread;
+    pthread_cond_t turn;
+    char name[configMAX_TASK_NAME_LEN];
+    TaskFunction_t code;
+    void *arg;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t stack_depth;
+    UBaseType_t number;
+    bool hidden;  // left out of the task list
+
+    TaskState state;
+    uint64_t ready_order;  // first in, first out among equal priorities
+    uint64_t wake_us;      // when a blocked task times out
+    bool timed_out;
+    WaitList *waiting_on;
+    tskTaskControlBlock *next_waiter;
+
+    uint32_t notify_value;
+    bool notify_waiting;
+
+    uint64_t run_us;  // bus time, the only time a task spends running
+};
+
+struct QueueDefinition {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    WaitList senders;
+    WaitList receivers;
+};
+
+struct tmrTimerControl {
+    TickType_t period;
+    bool auto_reload;
+    void *id;
+    TimerCallbackFunction_t callback;
+    bool active;
+    uint64_t expiry_us;
+};
+
+static pthread_mutex_t baton_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t main_turn = PTHREAD_COND_INITIALIZER;
+
+static TaskHandle_t tasks[MAX_TASKS];
+static int task_count = 0;
+static TaskHandle_t current = nullptr;
+static UBaseType_t next_task_number = 1;
+static uint64_t ready_counter = 0;
+static uint64_t switches = 0;
+static int suspend_depth = 0;
+
+static uint64_t now_us = 0;
+static uint64_t end_us = NO_TIMEOUT;
+static double bus_carry_us = 0;
+static struct timespec wall_start;
+
+static tmrTimerControl timers[MAX_TIMERS];
+static int timer_count = 0;
+static TaskHandle_t timer_task = nullptr;
+
+uint64_t sim_now_us() { return now_us; }
+
+uint64_t sim_context_switches() { return switches; }
+
+static TickType_t tick_count() { return (TickType_t)(now_us / US_PER_TICK); }
+
+// Timeouts end on a tick, like FreeRTOS's
+static uint64_t deadline_after(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) return NO_TIMEOUT;
+    return (now_us / US_PER_TICK + ticks) * US_PER_TICK;
+}
+
+static void make_ready(TaskHandle_t task) {
+    task->state = TASK_READY;
+    task->ready_order = ++ready_counter;
+    task->waiting_on = nullptr;
+}
+
+static void wait_list_remove(TaskHandle_t task) {
+    WaitList *list = task->waiting_on;
+    if (!list) return;
+    for (TaskHandle_t *link = &list->head; *link; link = &(*link)->next_waiter) {
+        if (*link == task) {
+            *link = task->next_waiter;
+            break;
+        }
+    }
+    task->waiting_on = nullptr;
+    task->next_waiter = nullptr;
+}
+
+// Wakes the waiter of highest priority, the longest waiting among equals
+static TaskHandle_t wake_one(WaitList *list) {
+    TaskHandle_t best = nullptr;
+    for (TaskHandle_t task = list->head; task; task = task->next_waiter) {
+        if (!best || task->priority > best->priority) best = task;
+    }
+    if (best) {
+        wait_list_remove(best);
+        best->timed_out = false;
+        make_ready(best);
+    }
+    return best;
+}
+
+static TaskHandle_t pick_ready() {
+    TaskHandle_t best = nullptr;
+    for (int i = 0; i < task_count; i++) {
+        TaskHandle_t task = tasks[i];
+        if (task->state != TASK_READY) continue;
+        if (!best || task->priority > best->priority ||
+            (task->priority == best->priority && task->ready_order < best->ready_order)) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+[[noreturn]] static void deadlock() {
+    fprintf(stderr, "sim: deadlock at %.3f s, every task waits for ever\n", now_us / 1e6);
+    sim_print_tasks(stderr);
+    sim_finish(2);
+}
+
+static void pace_to(uint64_t us) {
+    if (sim_options.realtime <= 0) return;
+    const double seconds = us / 1e6 / sim_options.realtime;
+    struct timespec until = wall_start;
+    until.tv_sec += (time_t)seconds;
+    until.tv_nsec += (long)((seconds - (time_t)seconds) * 1e9);
+    if (until.tv_nsec >= 1000000000) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) != 0) {
+    }
+}
+
+// Nothing is ready: moves the clock on to the first timeout and wakes every
+// task waiting for it
+static void advance_clock() {
+    uint64_t wake = NO_TIMEOUT;
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i]->state == TASK_BLOCKED && tasks[i]->wake_us < wake) wake = tasks[i]->wake_us;
+    }
+    if (wake == NO_TIMEOUT) deadlock();
+    if (wake >= end_us) {
+        now_us = end_us;
+        sim_finish(0);
+    }
+
+    pace_to(wake);
+    now_us = wake;
+    for (int i = 0; i < task_count; i++) {
+        TaskHandle_t task = tasks[i];
+        if (task->state == TASK_BLOCKED && task->wake_us <= now_us) {
+            wait_list_remove(task);
+            task->timed_out = true;
+            make_ready(task);
+        }
+    }
+}
+
+// Hands the baton to next and waits for it to come back
+static void switch_to(TaskHandle_t next) {
+    TaskHandle_t previous = current;
+    if (next == previous) return;
+    switches++;
+
+    pthread_mutex_lock(&baton_lock);
+    current = next;
+    pthread_cond_signal(&next->turn);
+    if (!previous) {
+        // The main thread only starts the first task
+        for (;;) pthread_cond_wait(&main_turn, &baton_lock);
+    }
+    if (previous->state == TASK_DELETED) {
+        pthread_mutex_unlock(&baton_lock);
+        pthread_exit(nullptr);
+    }
+    while (current != previous) pthread_cond_wait(&previous->turn, &baton_lock);
+    pthread_mutex_unlock(&baton_lock);
+}
+
+// The running task has blocked or yielded: runs the next ready task
+static void schedule() {
+    TaskHandle_t next;
+    while (!(next = pick_ready())) advance_clock();
+    switch_to(next);
+}
+
+// After waking a task: a higher priority one takes over at once, unless the
+// scheduler is suspended
+static void preempt() {
+    if (!current || suspend_depth > 0) return;
+    TaskHandle_t best = pick_ready();
+    if (best && best != current && best->priority > current->priority) {
+        make_ready(current);
+        switch_to(best);
+    }
+}
+
+// Blocks the running task until it is woken from list or wake_us passes.
+// Returns false on timeout.
+static bool block(WaitList *list, uint64_t wake_us) {
+    TaskHandle_t self = current;
+    self->state = TASK_BLOCKED;
+    self->wake_us = wake_us;
+    self->timed_out = false;
+    self->waiting_on = list;
+    self->next_waiter = nullptr;
+    if (list) {
+        TaskHandle_t *link = &list->head;
+        while (*link) link = &(*link)->next_waiter;
+        *link = self;
+    }
+    schedule();
+    return !self->timed_out;
+}
+
+void sim_sleep_until_us(uint64_t wake_us) {
+    if (wake_us <= now_us) {
+        make_ready(current);
+        schedule();
+        return;
+    }
+    block(nullptr, wake_us);
+}
+
+// Whole microseconds only, the remainder is carried to the next transfer
+void sim_bus_wait_us(double us) {
+    bus_carry_us += us;
+    const uint64_t whole = (uint64_t)bus_carry_us;
+    if (whole == 0) return;
+    bus_carry_us -= whole;
+    current->run_us += whole;
+    sim_sleep_until_us(now_us + whole);
+}
+
+static void *task_thread(void *arg) {
+    TaskHandle_t self = (TaskHandle_t)arg;
+    pthread_mutex_lock(&baton_lock);
+    while (current != self) pthread_cond_wait(&self->turn, &baton_lock);
+    pthread_mutex_unlock(&baton_lock);
+
+    self->code(self->arg);
+    vTaskDelete(nullptr);  // Returning from a task is a bug on the device, tolerated here
+    return nullptr;
+}
+
+static TaskHandle_t create_task(TaskFunction_t code, const char *name, uint32_t stack_depth, void *arg,
+                                UBaseType_t priority, BaseType_t core, bool hidden) {
+    if (task_count == MAX_TASKS) return nullptr;
+
+    TaskHandle_t task = new tskTaskControlBlock();
+    pthread_cond_init(&task->turn, nullptr);
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    task->code = code;
+    task->arg = arg;
+    task->priority = priority < configMAX_PRIORITIES ? priority : configMAX_PRIORITIES - 1;
+    task->core = core == tskNO_AFFINITY ? 0 : core;
+    task->stack_depth = stack_depth;
+    task->number = next_task_number++;
+    task->hidden = hidden;
+    make_ready(task);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&task->thread, &attr, task_thread, task) != 0) {
+        fprintf(stderr, "sim: can't start a thread for task %s\n", name);
+        sim_finish(2);
+    }
+    pthread_attr_destroy(&attr);
+    tasks[task_count++] = task;
+    return task;
+}
+
+void sim_create_hidden_task(void (*code)(void *), const char *name, void *arg, int priority) {
+    create_task(code, name, 0, arg, priority, 0, true);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core) {
+    TaskHandle_t task = create_task(code, name, stack_depth, arg, priority, core, false);
+    if (created) *created = task;
+    if (!task) return pdFAIL;
+    preempt();
+    return pdPASS;
+}
+
+// A task deleted by another stays parked on its condition variable: unwinding
+// its stack from here could run its code alongside the running task
+void vTaskDelete(TaskHandle_t task) {
+    if (!task) task = current;
+    if (task->state == TASK_DELETED) return;
+
+    wait_list_remove(task);
+    task->state = TASK_DELETED;
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i] == task) {
+            tasks[i] = tasks[--task_count];
+            break;
+        }
+    }
+    if (task == current) schedule();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        make_ready(current);  // Behind the other ready tasks of its priority
+        schedule();
+        return;
+    }
+    block(nullptr, deadline_after(ticks));
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    const TickType_t wake = *previous_wake + increment;
+    *previous_wake = wake;
+    if ((int32_t)(wake - tick_count()) <= 0) return pdFALSE;  // Already late
+    block(nullptr, (uint64_t)(now_us / US_PER_TICK + (wake - tick_count())) * US_PER_TICK);
+    return pdTRUE;
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    if (!task) task = current;
+    wait_list_remove(task);
+    task->state = TASK_SUSPENDED;
+    if (task == current) schedule();
+}
+
+void vTaskResume(TaskHandle_t task) {
+    if (task->state != TASK_SUSPENDED) return;
+    make_ready(task);
+    preempt();
+}
+
+void vTaskSuspendAll() { suspend_depth++; }
+
+BaseType_t xTaskResumeAll() {
+    if (--suspend_depth == 0) preempt();
+    return pdFALSE;
+}
+
+TickType_t xTaskGetTickCount() { return tick_count(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return current; }
+
+const char *pcTaskGetName(TaskHandle_t task) { return (task ? task : current)->name; }
+
+// Stack use isn't measured: reports the whole stack as free
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return (task ? task : current)->stack_depth; }
+
+BaseType_t xPortGetCoreID() { return current ? current->core : 0; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    task->notify_value++;
+    if (task->notify_waiting && task->state == TASK_BLOCKED) {
+        task->notify_waiting = false;
+        task->timed_out = false;
+        make_ready(task);
+        preempt();
+    }
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+    if (woken && task->notify_waiting && task->priority > current->priority) *woken = pdTRUE;
+    xTaskNotifyGive(task);
+}
+
+static uint32_t notify_take_until(BaseType_t clear, uint64_t wake_us) {
+    TaskHandle_t self = current;
+    if (self->notify_value == 0 && wake_us > now_us) {
+        self->notify_waiting = true;
+        block(nullptr, wake_us);
+        self->notify_waiting = false;
+    }
+    const uint32_t value = self->notify_value;
+    if (value > 0) self->notify_value = clear ? 0 : value - 1;
+    return value;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    return notify_take_until(clear, ticks == 0 ? now_us : deadline_after(ticks));
+}
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+    UBaseType_t count = 0;
+    for (int i = 0; i < task_count; i++) count += !tasks[i]->hidden;
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint32_t *total_run_time) {
+    if (size < uxTaskGetNumberOfTasks()) return 0;
+
+    UBaseType_t count = 0;
+    for (int i = 0; i < task_count; i++) {
+        TaskHandle_t task = tasks[i];
+        if (task->hidden) continue;
+        TaskStatus_t &s = status[count++];
+        s.xHandle = task;
+        s.pcTaskName = task->name;
+        s.xTaskNumber = task->number;
+        s.eCurrentState = task == current                 ? eRunning
+                          : task->state == TASK_READY     ? eReady
+                          : task->state == TASK_SUSPENDED ? eSuspended
+                                                          : eBlocked;
+        s.uxCurrentPriority = task->priority;
+        s.uxBasePriority = task->priority;
+        s.ulRunTimeCounter = (uint32_t)task->run_us;
+        s.usStackHighWaterMark = task->stack_depth;
+        s.xCoreID = task->core;
+    }
+    if (total_run_time) *total_run_time = (uint32_t)now_us;
+    return count;
+}
+
+void sim_print_tasks(FILE *out) {
+    static const char *STATE_NAMES[] = {"ready", "blocked", "suspended", "deleted"};
+    for (int i = 0; i < task_count; i++) {
+        TaskHandle_t task = tasks[i];
+        fprintf(out, "sim:   %-16s priority %2u, %-9s", task->name, task->priority, STATE_NAMES[task->state]);
+        if (task->state == TASK_BLOCKED) {
+            if (task->wake_us != NO_TIMEOUT) fprintf(out, " until %.3f s", task->wake_us / 1e6);
+            if (task->waiting_on) fprintf(out, " on a queue");
+            if (task->notify_waiting) fprintf(out, " for a notification");
+        }
+        fprintf(out, ", %.3f s on the bus\n", task->run_us / 1e6);
+    }
+}
+
+// Queues and semaphores
+
+static QueueHandle_t create_queue(UBaseType_t length, UBaseType_t item_size, UBaseType_t count) {
+    QueueHandle_t queue = new QueueDefinition();
+    queue->items = item_size ? new uint8_t[length * item_size] : nullptr;
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->count = count;
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return create_queue(length, item_size, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return create_queue(1, 0, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return create_queue(1, 0, 1); }
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete[] queue->items;
+    delete queue;
+}
+
+static void push_item(QueueHandle_t queue, const void *item) {
+    if (queue->item_size) {
+        const UBaseType_t slot = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + slot * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+}
+
+static void pop_item(QueueHandle_t queue, void *item) {
+    if (queue->item_size) {
+        memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    const uint64_t wake_us = deadline_after(ticks);
+    while (queue->count == queue->length) {
+        if (ticks == 0 || !block(&queue->senders, wake_us)) return errQUEUE_FULL;
+    }
+    push_item(queue, item);
+    if (wake_one(&queue->receivers)) preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+    if (queue->count == queue->length) return errQUEUE_FULL;
+    push_item(queue, item);
+    TaskHandle_t task = wake_one(&queue->receivers);
+    if (task && woken && task->priority > current->priority) *woken = pdTRUE;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    const uint64_t wake_us = deadline_after(ticks);
+    while (queue->count == 0) {
+        if (ticks == 0 || !block(&queue->receivers, wake_us)) return errQUEUE_EMPTY;
+    }
+    pop_item(queue, item);
+    if (wake_one(&queue->senders)) preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    queue->count = 0;
+    queue->head = 0;
+    if (wake_one(&queue->senders)) preempt();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) { return queue->count; }
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) { return queue->length - queue->count; }
+
+// Software timers. The timer task sleeps until the first expiry and is
+// notified whenever a timer is started or stopped.
+
+static void timer_daemon(void *) {
+    for (;;) {
+        uint64_t next = NO_TIMEOUT;
+        for (int i = 0; i < timer_count; i++) {
+            if (timers[i].active && timers[i].expiry_us < next) next = timers[i].expiry_us;
+        }
+        if (next > now_us) {
+            notify_take_until(pdTRUE, next);
+            continue;
+        }
+
+        for (int i = 0; i < timer_count; i++) {
+            tmrTimerControl &timer = timers[i];
+            if (!timer.active || timer.expiry_us > now_us) continue;
+            if (timer.auto_reload) {
+                timer.expiry_us += timer.period * US_PER_TICK;
+            } else {
+                timer.active = false;
+            }
+            timer.callback(&timer);
+        }
+    }
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload, void *id,
+                           TimerCallbackFunction_t callback) {
+    (void)name;
+    if (timer_count == MAX_TIMERS || period == 0) return nullptr;
+    tmrTimerControl &timer = timers[timer_count++];
+    timer.period = period;
+    timer.auto_reload = auto_reload;
+    timer.id = id;
+    timer.callback = callback;
+    timer.active = false;
+    return &timer;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks) {
+    (void)ticks;
+    timer->active = true;
+    timer->expiry_us = deadline_after(timer->period);
+    xTaskNotifyGive(timer_task);
+    return pdPASS;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks) { return xTimerReset(timer, ticks); }
+
+BaseType_t xTimerResetFromISR(TimerHandle_t timer, BaseType_t *woken) {
+    timer->active = true;
+    timer->expiry_us = deadline_after(timer->period);
+    vTaskNotifyGiveFromISR(timer_task, woken);
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks) {
+    (void)ticks;
+    timer->active = false;
+    xTaskNotifyGive(timer_task);
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) { return timer->active; }
+
+void *pvTimerGetTimerID(TimerHandle_t timer) { return timer->id; }
+
+// Starts the timer task and the Arduino loop task, then runs tasks until
+// sim_finish() exits
+void sim_kernel_run(void (*loop_task)(void *)) {
+    if (sim_options.seconds > 0) end_us = (uint64_t)(sim_options.seconds * 1e6);
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    timer_task = create_task(timer_daemon, "Tmr Svc", 4096, nullptr, configTIMER_TASK_PRIORITY, 0, false);
+    create_task(loop_task, "loopTask", 8192, nullptr, 1, 1, false);
+    sim_script_start();
+
+    switch_to(pick_ready());
+    abort();  // Not reached, the main thread waits until the process exits
+}
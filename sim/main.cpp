@@ -0,0 +1,150 @@
+// Runs the firmware on the host: the sketch and every module in it, on the
+// stand-ins in sim/include for the ESP32 Arduino core, FreeRTOS, TFT_eSPI,
+// WiFi and the websocket client.
+//
+//   cmake -S sim -B build/sim && cmake --build build/sim
+//   resptro_sim [--seconds S] [--script FILE] [--screenshot FILE.ppm]
+//               [--realtime SPEED] [--seed N] [--quiet] [--no-wifi] [--no-server]
+//               [--draw-rate PX] [--loss FRACTION] [--reconnect-every S]
+//               [--heap-check S]
+//
+// Runs for --seconds of virtual time (10 by default), which passes as fast as
+// the tasks can go unless --realtime paces it to the wall clock, so a run
+// takes the same course every time for a given --seed and script. Serial
+// output goes to stdout, the simulator's report to stderr. --heap-check
+// fails the run if anything is allocated or freed after that many seconds.
+// Exits non-zero on a deadlock, a failed heap check, or when Live Pixel is
+// connected at the end and the panel doesn't show the relay's canvas.
+
+#include <time.h>
+#include <unistd.h>
+#include <Arduino.h>
+#include "display_framebuffer.h"
+#include "sim.h"
+
+void setup();
+void loop();
+
+SimOptions sim_options;
+
+static struct timespec wall_start;
+static bool heap_checked = false;
+static SimHeap heap_at_check;
+
+static bool parse_options(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(option, "--quiet")) {
+            sim_options.quiet = true;
+            continue;
+        } else if (!strcmp(option, "--no-wifi")) {
+            sim_options.wifi = false;
+            continue;
+        } else if (!strcmp(option, "--no-server")) {
+            sim_options.server = false;
+            continue;
+        }
+
+        if (!value) return false;
+        i++;
+        if (!strcmp(option, "--seconds")) {
+            sim_options.seconds = atof(value);
+        } else if (!strcmp(option, "--script")) {
+            sim_options.script = value;
+        } else if (!strcmp(option, "--screenshot")) {
+            sim_options.screenshot = value;
+        } else if (!strcmp(option, "--realtime")) {
+            sim_options.realtime = atof(value);
+        } else if (!strcmp(option, "--seed")) {
+            sim_options.seed = (uint32_t)atol(value) | 1;
+        } else if (!strcmp(option, "--draw-rate")) {
+            sim_options.draw_rate = atof(value);
+        } else if (!strcmp(option, "--loss")) {
+            sim_options.loss = atof(value);
+        } else if (!strcmp(option, "--reconnect-every")) {
+            sim_options.reconnect_every = atof(value);
+        } else if (!strcmp(option, "--heap-check")) {
+            sim_options.heap_check = atof(value);
+        } else {
+            return false;
+        }
+    }
+    return sim_options.seconds > 0 && sim_options.realtime >= 0 && sim_options.draw_rate >= 0;
+}
+
+// The Arduino core's loopTask
+static void loop_task(void *) {
+    setup();
+    for (;;) loop();
+}
+
+static void heap_check_task(void *) {
+    sim_sleep_until_us((uint64_t)(sim_options.heap_check * 1e6));
+    heap_at_check = sim_heap();
+    heap_checked = true;
+}
+
+static bool report_heap() {
+    const SimHeap heap = sim_heap();
+    fprintf(stderr, "sim: heap: %llu allocations, %lld bytes live, %lld at the peak\n",
+            (unsigned long long)heap.allocations, (long long)heap.live_bytes, (long long)heap.peak_bytes);
+    if (sim_options.heap_check < 0) return true;
+    if (!heap_checked) {
+        fprintf(stderr, "sim: heap check at %.0f s is past the end of the run\n", sim_options.heap_check);
+        return false;
+    }
+
+    const uint64_t allocations = heap.allocations - heap_at_check.allocations;
+    fprintf(stderr, "sim: heap since %.0f s: %llu allocations, live bytes %lld -> %lld: %s\n", sim_options.heap_check,
+            (unsigned long long)allocations, (long long)heap_at_check.live_bytes, (long long)heap.live_bytes,
+            allocations == 0 && heap.live_bytes == heap_at_check.live_bytes ? "ok" : "FAILED");
+    return allocations == 0 && heap.live_bytes == heap_at_check.live_bytes;
+}
+
+void sim_finish(int status) {
+    fflush(stdout);
+
+    struct timespec wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    const double wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    const double seconds = sim_now_us() / 1e6;
+    fprintf(stderr, "sim: %.3f s of virtual time in %.3f s, %.0fx real time, %llu context switches\n", seconds, wall,
+            wall > 0 ? seconds / wall : 0, (unsigned long long)sim_context_switches());
+
+    const FramebufferDisplay &panel = sim_panel();
+    const DisplayCounters &counters = panel.get_counters();
+    fprintf(stderr, "sim: panel: %u transactions, %u windows, %llu pixels, %llu bytes, bus busy %.1f%%\n",
+            counters.transactions, counters.windows, (unsigned long long)counters.pixels,
+            (unsigned long long)counters.spi_bytes, seconds > 0 ? 100 * panel.spi_seconds() / seconds : 0);
+    sim_print_tasks(stderr);
+    sim_relay_report(stderr);
+
+    if (!report_heap() && status == 0) status = 1;
+    if (status == 0 && !sim_relay_check_panel(stderr)) status = 1;
+    if (sim_options.screenshot && !sim_write_screenshot(sim_options.screenshot)) {
+        fprintf(stderr, "sim: can't write %s\n", sim_options.screenshot);
+        if (status == 0) status = 1;
+    }
+    fflush(stderr);
+    _exit(status);
+}
+
+int main(int argc, char **argv) {
+    if (!parse_options(argc, argv)) {
+        fprintf(stderr,
+                "usage: %s [--seconds S] [--script FILE] [--screenshot FILE.ppm] [--realtime SPEED] [--seed N]\n"
+                "       [--quiet] [--no-wifi] [--no-server] [--draw-rate PX] [--loss FRACTION]\n"
+                "       [--reconnect-every S] [--heap-check S]\n",
+                argv[0]);
+        return 1;
+    }
+    if (sim_options.script && !sim_script_load(sim_options.script)) return 1;
+
+    sim_relay_init();
+    sim_panel();
+    if (sim_options.heap_check >= 0) sim_create_hidden_task(heap_check_task, "HeapCheck", nullptr, 0);
+    sim_heap();  // Counts from here
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    sim_kernel_run(loop_task);
+}
@@ -0,0 +1,110 @@
+#include <map>
+#include <ArduinoWebsockets.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include "sim.h"
+
+// WiFi, Preferences and the websocket client for the simulator. The client
+// talks to the relay in relay.cpp.
+
+using namespace websockets;
+
+WiFiClass WiFi;
+
+int WiFiClass::status() {
+    return sim_options.wifi && started && (wifi_mode & WIFI_STA) ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+void WiFiClass::mode(int mode) {
+    wifi_mode = mode;
+    if (mode == WIFI_OFF) started = false;
+}
+
+void WiFiClass::begin() {
+    wifi_mode |= WIFI_STA;
+    started = true;
+}
+
+void WiFiClass::disconnect(bool wifi_off) {
+    started = false;
+    if (wifi_off) wifi_mode = WIFI_OFF;
+}
+
+IPAddress WiFiClass::localIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress(); }
+
+static std::map<std::string, std::string> &stored_preferences() {
+    static std::map<std::string, std::string> values;
+    return values;
+}
+
+bool Preferences::begin(const char *name, bool read_only) {
+    (void)read_only;
+    space = name;
+    return true;
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+    stored_preferences()[space + "/" + key] = value;
+    return strlen(value);
+}
+
+size_t Preferences::getString(const char *key, char *buffer, size_t size) {
+    const auto found = stored_preferences().find(space + "/" + key);
+    if (found == stored_preferences().end() || found->second.size() + 1 > size) return 0;
+    memcpy(buffer, found->second.c_str(), found->second.size() + 1);
+    return found->second.size() + 1;
+}
+
+String Preferences::getString(const char *key, const String &default_value) {
+    const auto found = stored_preferences().find(space + "/" + key);
+    return found == stored_preferences().end() ? default_value : String(found->second.c_str());
+}
+
+bool WebsocketsClient::connect(const char *url) {
+    (void)url;
+    if (open) return true;
+    if (!sim_options.server || WiFi.status() != WL_CONNECTED) return false;
+
+    open = true;
+    sim_relay_connect();
+    if (on_event) on_event(WebsocketsEvent::ConnectionOpened, String());
+    return true;
+}
+
+bool WebsocketsClient::available() { return open; }
+
+bool WebsocketsClient::poll() {
+    if (!open) return false;
+    if (!sim_relay_poll(this)) {
+        closed();
+        return false;
+    }
+    return true;
+}
+
+void WebsocketsClient::close() {
+    if (!open) return;
+    sim_relay_disconnect();
+    closed();
+}
+
+void WebsocketsClient::closed() {
+    open = false;
+    if (on_event) on_event(WebsocketsEvent::ConnectionClosed, String());
+}
+
+void WebsocketsClient::deliver(const std::string &raw, bool binary) {
+    if (on_message) on_message(WebsocketsMessage(raw, binary));
+}
+
+bool WebsocketsClient::send(const char *text, size_t length) {
+    if (!open) return false;
+    sim_relay_receive(text, length, false);
+    return true;
+}
+
+bool WebsocketsClient::sendBinary(const char *data, size_t length) {
+    if (!open) return false;
+    sim_relay_receive(data, length, true);
+    return true;
+}
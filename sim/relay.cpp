@@ -0,0 +1,312 @@
+#include <ArduinoWebsockets.h>
+#include "display_framebuffer.h"
+#include "canvas_flush.h"
+#include "pixel_protocol.h"
+#include "sim.h"
+
+// The Live Pixel relay for the simulator, following Server/hub.go: someone
+// draws random strokes at --draw-rate pixels a second, merged into one delta
+// per 16 ms tick, and the connected device is sent keyframes, deltas within
+// its credit and PATCH catch-ups, and is answered when it asks to resync.
+// --loss drops deltas before they are sent, so neither side counts them and
+// the device has to resync, and --reconnect-every closes the connection now
+// and then. Nobody draws in the last second of a run, so the device can
+// catch up before the panel is checked against the canvas.
+
+const uint64_t RELAY_TICK_US = 16000;
+const uint64_t QUIET_TAIL_US = 1000000;
+const int CANVAS_PIXELS = PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE;
+const uint16_t CLEAR_COLOR = 0xFFFF;
+const int STROKE_MIN = 8;
+const int STROKE_MAX = 64;
+const size_t KEYFRAME_SIZE = PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE + CANVAS_PIXELS * PIXEL_PROTO_COLOR_SIZE;
+const size_t MESSAGE_RESERVE = 16384;  // no message is larger, so none allocates
+
+struct RelayStats {
+    uint32_t connections;
+    uint32_t keyframes;
+    uint32_t deltas;
+    uint32_t patches;
+    uint32_t lost;
+    uint32_t held_back;  // ticks the device had no credit for
+    uint32_t resyncs;
+    uint32_t credits;
+    uint32_t telemetry;
+    uint64_t records;
+};
+
+struct Relay {
+    uint16_t pixels[CANVAS_PIXELS];
+    uint32_t changed_at[CANVAS_PIXELS];
+    uint32_t seq;
+
+    // This tick's drawing, at most one record per pixel
+    uint16_t tick_order[CANVAS_PIXELS];
+    uint32_t tick_dirty[PIXEL_CANVAS_SIZE];
+    int tick_count;
+    uint64_t next_tick_us;
+
+    int stroke_x, stroke_y, stroke_left;
+    uint16_t stroke_color;
+    double pixel_budget;
+    uint32_t random_state;
+
+    // The connected device, as hub.go's relayClient
+    bool connected;
+    bool credited;
+    uint32_t limit;
+    uint32_t sent;
+    uint32_t sent_seq;
+    bool behind;
+    bool resync_due;
+    bool keyframe_due;
+    uint64_t closes_at_us;
+
+    std::string message;
+    websockets::WebsocketsClient *client;
+    RelayStats stats;
+};
+
+static Relay relay;
+
+static uint32_t next_random() {
+    relay.random_state ^= relay.random_state << 13;
+    relay.random_state ^= relay.random_state >> 17;
+    relay.random_state ^= relay.random_state << 5;
+    return relay.random_state;
+}
+
+void sim_relay_init() {
+    for (int i = 0; i < CANVAS_PIXELS; i++) relay.pixels[i] = CLEAR_COLOR;
+    relay.random_state = (sim_options.seed * 2654435761u) | 1;
+    relay.message.reserve(MESSAGE_RESERVE);
+}
+
+static void deliver(bool binary) {
+    relay.client->deliver(relay.message, binary);
+}
+
+static void put_u32(uint32_t value) {
+    uint8_t bytes[4];
+    pixel_write_u32(bytes, value);
+    relay.message.append((const char *)bytes, sizeof(bytes));
+}
+
+static void start_frame(uint8_t opcode, uint16_t count) {
+    uint8_t header[PIXEL_PROTO_HEADER_SIZE];
+    pixel_frame_write_header(header, opcode, count);
+    relay.message.assign((const char *)header, sizeof(header));
+}
+
+static void put_record(int index) {
+    const uint16_t color = relay.pixels[index];
+    const char record[PIXEL_PROTO_RECORD_SIZE] = {(char)(index % PIXEL_CANVAS_SIZE), (char)(index / PIXEL_CANVAS_SIZE),
+                                                  (char)(color & 0xFF), (char)(color >> 8)};
+    relay.message.append(record, sizeof(record));
+}
+
+static void send_keyframe() {
+    start_frame(PIXEL_OP_KEYFRAME, CANVAS_PIXELS);
+    put_u32(relay.seq);
+    for (int i = 0; i < CANVAS_PIXELS; i++) {
+        const char color[PIXEL_PROTO_COLOR_SIZE] = {(char)(relay.pixels[i] & 0xFF), (char)(relay.pixels[i] >> 8)};
+        relay.message.append(color, sizeof(color));
+    }
+    relay.stats.keyframes++;
+    deliver(true);
+}
+
+static bool has_credit(int records) { return !relay.credited || (int32_t)(relay.limit - relay.sent) >= records; }
+
+// hub.go's catchUp: a PATCH of the pixels changed since base, or a keyframe
+// if that is smaller or would overrun the credit
+static void catch_up(uint32_t base) {
+    relay.behind = false;
+    relay.sent_seq = relay.seq;
+    if (base == relay.seq) return;
+
+    int records = 0;
+    if (base != 0 && base < relay.seq) {
+        for (int i = 0; i < CANVAS_PIXELS; i++) records += relay.changed_at[i] > base;
+    }
+    const int max_records = relay.credited ? (int32_t)(relay.limit - relay.sent) : CANVAS_PIXELS;
+    const size_t patch_size =
+        PIXEL_PROTO_HEADER_SIZE + 2 * PIXEL_PROTO_SEQ_SIZE + (size_t)records * PIXEL_PROTO_RECORD_SIZE;
+    if (base == 0 || base > relay.seq || records > max_records || patch_size >= KEYFRAME_SIZE) {
+        send_keyframe();
+        return;
+    }
+
+    start_frame(PIXEL_OP_PATCH, (uint16_t)records);
+    put_u32(base);
+    put_u32(relay.seq);
+    for (int i = 0; i < CANVAS_PIXELS; i++) {
+        if (relay.changed_at[i] > base) put_record(i);
+    }
+    relay.sent += records;
+    relay.stats.patches++;
+    relay.stats.records += records;
+    deliver(true);
+}
+
+static void send_delta() {
+    start_frame(PIXEL_OP_DELTA, (uint16_t)relay.tick_count);
+    put_u32(relay.seq);
+    for (int n = 0; n < relay.tick_count; n++) put_record(relay.tick_order[n]);
+    relay.sent += relay.tick_count;
+    relay.sent_seq = relay.seq;
+    relay.stats.deltas++;
+    relay.stats.records += relay.tick_count;
+    deliver(true);
+}
+
+// A random walk in one color, restarted somewhere else now and then
+static void draw_stroke_pixel() {
+    if (relay.stroke_left-- <= 0) {
+        relay.stroke_x = next_random() % PIXEL_CANVAS_SIZE;
+        relay.stroke_y = next_random() % PIXEL_CANVAS_SIZE;
+        relay.stroke_color = (uint16_t)next_random();
+        relay.stroke_left = STROKE_MIN + next_random() % (STROKE_MAX - STROKE_MIN);
+    } else {
+        const uint32_t step = next_random();
+        relay.stroke_x = constrain(relay.stroke_x + (int)(step % 3) - 1, 0, PIXEL_CANVAS_SIZE - 1);
+        relay.stroke_y = constrain(relay.stroke_y + (int)(step / 3 % 3) - 1, 0, PIXEL_CANVAS_SIZE - 1);
+    }
+
+    const int i = relay.stroke_y * PIXEL_CANVAS_SIZE + relay.stroke_x;
+    if (relay.pixels[i] == relay.stroke_color) return;
+    relay.pixels[i] = relay.stroke_color;
+    const uint32_t bit = 1UL << relay.stroke_x;
+    if (!(relay.tick_dirty[relay.stroke_y] & bit)) {
+        relay.tick_dirty[relay.stroke_y] |= bit;
+        relay.tick_order[relay.tick_count++] = (uint16_t)i;
+    }
+}
+
+// One 16 ms tick: this tick's drawing as one delta, as hub.go's broadcastPixels
+static void tick() {
+    const uint64_t end_us = (uint64_t)(sim_options.seconds * 1e6);
+    if (relay.next_tick_us + QUIET_TAIL_US >= end_us) return;
+    // A lost last delta would go unnoticed, nothing follows it to show the gap
+    const bool last = relay.next_tick_us + RELAY_TICK_US + QUIET_TAIL_US >= end_us;
+
+    relay.pixel_budget += sim_options.draw_rate * RELAY_TICK_US / 1e6;
+    for (; relay.pixel_budget >= 1; relay.pixel_budget--) draw_stroke_pixel();
+    if (relay.tick_count == 0) return;
+
+    relay.seq++;
+    for (int n = 0; n < relay.tick_count; n++) relay.changed_at[relay.tick_order[n]] = relay.seq;
+
+    if (relay.connected) {
+        if (relay.behind) {
+            if (has_credit(1)) catch_up(relay.sent_seq);  // Includes this delta
+        } else if (!has_credit(relay.tick_count)) {
+            relay.behind = true;
+            relay.stats.held_back++;
+        } else if (!last && sim_options.loss > 0 && next_random() < sim_options.loss * 4294967296.0) {
+            relay.stats.lost++;  // The device sees the gap on the next delta
+        } else {
+            send_delta();
+        }
+    }
+
+    for (int n = 0; n < relay.tick_count; n++) relay.tick_dirty[relay.tick_order[n] / PIXEL_CANVAS_SIZE] = 0;
+    relay.tick_count = 0;
+}
+
+void sim_relay_connect() {
+    relay.connected = true;
+    relay.credited = false;
+    relay.limit = 0;
+    relay.sent = 0;
+    relay.sent_seq = relay.seq;
+    relay.behind = false;
+    relay.resync_due = false;
+    relay.keyframe_due = true;
+    relay.closes_at_us = sim_options.reconnect_every > 0
+                             ? sim_now_us() + (uint64_t)(sim_options.reconnect_every * 1e6)
+                             : UINT64_MAX;
+    relay.stats.connections++;
+}
+
+void sim_relay_disconnect() { relay.connected = false; }
+
+bool sim_relay_poll(websockets::WebsocketsClient *client) {
+    if (relay.next_tick_us == 0) relay.next_tick_us = sim_now_us() + RELAY_TICK_US;
+    relay.client = client;
+
+    if (relay.keyframe_due) {
+        relay.keyframe_due = false;
+        relay.sent_seq = relay.seq;
+        send_keyframe();
+    }
+    // Requests the device sent since the last poll
+    if (relay.resync_due || (relay.behind && has_credit(1))) {
+        relay.resync_due = false;
+        catch_up(relay.sent_seq);
+    }
+
+    while (relay.next_tick_us <= sim_now_us()) {
+        if (relay.next_tick_us >= relay.closes_at_us) {
+            relay.connected = false;
+            return false;
+        }
+        tick();
+        relay.next_tick_us += RELAY_TICK_US;
+    }
+    return true;
+}
+
+void sim_relay_receive(const char *data, size_t length, bool binary) {
+    if (!binary) {
+        if (strncmp(data, "telemetry;", 10) == 0) relay.stats.telemetry++;
+        return;
+    }
+
+    PixelFrame frame;
+    if (!pixel_frame_parse((const uint8_t *)data, length, &frame)) return;
+    if (frame.opcode == PIXEL_OP_CREDIT) {
+        // pixel_frame_parse only reads the seq of frames the device receives
+        if (length < PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE) return;
+        const uint32_t limit = pixel_read_u32((const uint8_t *)data + PIXEL_PROTO_HEADER_SIZE);
+        if (!relay.credited || (int32_t)(limit - relay.limit) > 0) relay.limit = limit;
+        relay.credited = true;
+        relay.stats.credits++;
+    } else if (frame.opcode == PIXEL_OP_RESYNC) {
+        // The device drops deltas until answered, so anything sent after base is lost
+        relay.sent_seq = frame.seq;
+        relay.behind = true;
+        relay.resync_due = true;
+        relay.stats.resyncs++;
+    }
+}
+
+void sim_relay_report(FILE *out) {
+    const RelayStats &s = relay.stats;
+    fprintf(out, "sim: relay: %u connections, seq %u, %u keyframes, %u deltas, %u patches, %llu records\n",
+            s.connections, relay.seq, s.keyframes, s.deltas, s.patches, (unsigned long long)s.records);
+    fprintf(out, "sim: relay: %u deltas lost, %u ticks held back, %u resyncs, %u credit grants, %u telemetry lines\n",
+            s.lost, s.held_back, s.resyncs, s.credits, s.telemetry);
+}
+
+bool sim_relay_check_panel(FILE *out) {
+    if (!relay.connected) return true;
+
+    const FramebufferDisplay &panel = sim_panel();
+    int wrong = 0;
+    for (int i = 0; i < CANVAS_PIXELS; i++) {
+        const int x = i % PIXEL_CANVAS_SIZE * CANVAS_PIXEL_SIZE;
+        const int y = i / PIXEL_CANVAS_SIZE * CANVAS_PIXEL_SIZE;
+        if (panel.pixel(x, y) != relay.pixels[i]) {
+            if (wrong == 0) {
+                fprintf(out, "sim: panel at (%d, %d) is %04x, the canvas %04x\n", x, y, panel.pixel(x, y),
+                        relay.pixels[i]);
+            }
+            wrong++;
+        }
+    }
+    fprintf(out, "sim: panel %s the relay's canvas", wrong ? "differs from" : "matches");
+    if (wrong) fprintf(out, " in %d of %d pixels", wrong, CANVAS_PIXELS);
+    fprintf(out, "\n");
+    return wrong == 0;
+}
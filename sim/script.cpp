@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <vector>
+#include "common.h"
+#include "sim.h"
+
+// Scripted input. One event per line, at a time in milliseconds from the
+// start, or from the previous line with a leading '+':
+//   500 tap RIGHT       press, and release 100 ms later (or "tap RIGHT 800")
+//   +50 press B         buttons: UP LEFT DOWN RIGHT A B ALT
+//   +800 release B
+//   +10 serial s        the rest of the line arrives on Serial
+//   +10 screenshot menu.ppm
+// '#' starts a comment. Buttons are active low: pressing one drives its pin
+// low and raises the pin's interrupt on the script's task, which runs above
+// every firmware task.
+
+const uint32_t TAP_MS = 100;
+const int SCRIPT_PRIORITY = configMAX_PRIORITIES - 1;
+
+enum ScriptAction { SCRIPT_PIN, SCRIPT_SERIAL, SCRIPT_SCREENSHOT };
+
+struct ScriptEvent {
+    uint64_t at_us;
+    ScriptAction action;
+    uint8_t pin;
+    int level;
+    std::string text;
+};
+
+struct ButtonName {
+    const char *name;
+    uint8_t pin;
+};
+
+static const ButtonName BUTTON_NAMES[] = {{"UP", BTN_UP}, {"LEFT", BTN_LEFT}, {"DOWN", BTN_DOWN}, {"RIGHT", BTN_RIGHT},
+                                          {"A", BTN_A},   {"B", BTN_B},       {"ALT", BTN_ALT}};
+
+static std::vector<ScriptEvent> events;
+
+static bool parse_button(const char *name, uint8_t *pin) {
+    for (const ButtonName &button : BUTTON_NAMES) {
+        if (!strcmp(name, button.name)) {
+            *pin = button.pin;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_line(char *line, uint64_t *last_ms) {
+    line[strcspn(line, "#\r\n")] = '\0';
+    char *p = line + strspn(line, " \t");
+    if (!*p) return true;
+
+    const bool relative = *p == '+';
+    char *end;
+    const unsigned long ms = strtoul(p + relative, &end, 10);
+    if (end == p + relative) return false;
+    *last_ms = relative ? *last_ms + ms : ms;
+
+    char command[16] = "", argument[256] = "";
+    unsigned long hold_ms = TAP_MS;
+    const int fields = sscanf(end, "%15s %255s %lu", command, argument, &hold_ms);
+    if (fields < 2) return false;
+
+    ScriptEvent event = {*last_ms * 1000, SCRIPT_PIN, 0, LOW, ""};
+    if (!strcmp(command, "serial")) {
+        const char *text = strstr(end, "serial") + 6;
+        event.action = SCRIPT_SERIAL;
+        event.text = text + strspn(text, " \t");
+    } else if (!strcmp(command, "screenshot")) {
+        event.action = SCRIPT_SCREENSHOT;
+        event.text = argument;
+    } else if (!parse_button(argument, &event.pin)) {
+        return false;
+    } else if (!strcmp(command, "press")) {
+        event.level = LOW;
+    } else if (!strcmp(command, "release")) {
+        event.level = HIGH;
+    } else if (!strcmp(command, "tap")) {
+        events.push_back(event);
+        event.at_us += hold_ms * 1000;
+        event.level = HIGH;
+    } else {
+        return false;
+    }
+    events.push_back(event);
+    return true;
+}
+
+bool sim_script_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "sim: can't open script %s\n", path);
+        return false;
+    }
+
+    char line[512];
+    uint64_t last_ms = 0;
+    for (int number = 1; fgets(line, sizeof(line), file); number++) {
+        if (!parse_line(line, &last_ms)) {
+            fprintf(stderr, "sim: %s:%d: can't parse the line\n", path, number);
+            fclose(file);
+            return false;
+        }
+    }
+    fclose(file);
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const ScriptEvent &a, const ScriptEvent &b) { return a.at_us < b.at_us; });
+    return true;
+}
+
+static void script_task(void *) {
+    for (const ScriptEvent &event : events) {
+        sim_sleep_until_us(event.at_us);
+        switch (event.action) {
+            case SCRIPT_PIN:
+                sim_set_pin(event.pin, event.level);
+                break;
+            case SCRIPT_SERIAL:
+                sim_serial_input(event.text.c_str());
+                break;
+            case SCRIPT_SCREENSHOT:
+                if (!sim_write_screenshot(event.text.c_str())) {
+                    fprintf(stderr, "sim: can't write %s\n", event.text.c_str());
+                }
+                break;
+        }
+    }
+}
+
+void sim_script_start() {
+    if (!events.empty()) sim_create_hidden_task(script_task, "Script", nullptr, SCRIPT_PRIORITY);
+}
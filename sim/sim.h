@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// What the simulator's parts share: the kernel (kernel.cpp), the Arduino
+// core (arduino.cpp), the panel (tft.cpp), the network and relay
+// (network.cpp, relay.cpp) and the input script (script.cpp). main.cpp fills
+// in the options and runs the firmware.
+
+class FramebufferDisplay;
+
+struct SimOptions {
+    double seconds = 10;          // virtual time to run for
+    double realtime = 0;          // > 0 paces virtual time at this multiple of the wall clock
+    uint32_t seed = 1;
+    const char *script = nullptr;
+    const char *screenshot = nullptr;  // PPM of the panel when the run ends
+    bool quiet = false;                // don't echo Serial
+    bool wifi = true;
+    bool server = true;
+    double draw_rate = 600;         // pixels a second drawn on the relay
+    double loss = 0;                // fraction of relay deltas lost on the way
+    double reconnect_every = 0;     // seconds between relay disconnects
+    double heap_check = -1;         // seconds after which the heap must not change
+};
+extern SimOptions sim_options;
+
+// kernel.cpp. The clock is in microseconds of virtual time.
+uint64_t sim_now_us();
+void sim_sleep_until_us(uint64_t wake_us);
+// The calling task waits out a bus transfer
+void sim_bus_wait_us(double us);
+// A task the firmware can't see in the task list
+void sim_create_hidden_task(void (*code)(void *), const char *name, void *arg, int priority);
+[[noreturn]] void sim_kernel_run(void (*loop_task)(void *));
+void sim_print_tasks(FILE *out);
+uint64_t sim_context_switches();
+
+// main.cpp, from any task: reports and exits with status
+[[noreturn]] void sim_finish(int status);
+
+// arduino.cpp
+void sim_set_pin(uint8_t pin, int level);
+void sim_serial_input(const char *text);
+struct SimHeap {
+    uint64_t allocations;  // malloc, calloc, realloc and new calls so far
+    int64_t live_bytes;
+    int64_t peak_bytes;
+};
+SimHeap sim_heap();
+
+// tft.cpp
+FramebufferDisplay &sim_panel();
+bool sim_write_screenshot(const char *path);
+
+// relay.cpp, driven by the websocket client in network.cpp
+namespace websockets {
+class WebsocketsClient;
+}
+void sim_relay_init();
+void sim_relay_connect();
+void sim_relay_disconnect();
+// Delivers what the relay sent since the last poll. False once the relay
+// has closed the connection.
+bool sim_relay_poll(websockets::WebsocketsClient *client);
+void sim_relay_receive(const char *data, size_t length, bool binary);
+void sim_relay_report(FILE *out);
+// Whether the panel shows the relay's canvas, if a device is connected
+bool sim_relay_check_panel(FILE *out);
+
+// script.cpp
+bool sim_script_load(const char *path);
+void sim_script_start();
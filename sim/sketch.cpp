@@ -0,0 +1,4 @@
+// The sketch, compiled as C++ like the Arduino build does. It includes every
+// header it needs itself, so no prototypes have to be generated.
+#include <Arduino.h>
+#include "Resptro32.ino"
@@ -0,0 +1,192 @@
+#include <TFT_eSPI.h>
+#include "display_framebuffer.h"
+#include "sim.h"
+
+// TFT_eSPI on the simulated panel. Each call goes to the FramebufferDisplay
+// as the library would send it, and the bytes it counts are charged to the
+// drawing task as bus time: once per transaction, at a DMA wait, or after
+// each call made outside a transaction.
+
+// Classic 6x8 GLCD font cell, a 5x7 glyph in its top left corner
+const int GLYPH_WIDTH = 6;
+const int GLYPH_HEIGHT = 8;
+const int TEXT_CHUNK = 64;
+
+static uint64_t charged_bytes = 0;
+
+FramebufferDisplay &sim_panel() {
+    static FramebufferDisplay panel(TFT_WIDTH, TFT_HEIGHT);
+    return panel;
+}
+
+TFT_eSPI::TFT_eSPI(int16_t width, int16_t height)
+    : panel_width(width), panel_height(height), write_depth(0), cursor_x(0), cursor_y(0), text_size(1),
+      text_color(TFT_WHITE), text_bg(TFT_WHITE) {}
+
+void TFT_eSPI::charge_bus() {
+    const uint64_t bytes = sim_panel().get_counters().spi_bytes;
+    const uint64_t unpaid = bytes - charged_bytes;
+    charged_bytes = bytes;
+    if (unpaid) sim_bus_wait_us(unpaid * 8e6 / DISPLAY_SPI_HZ);
+}
+
+void TFT_eSPI::startWrite() {
+    if (write_depth++ == 0) sim_panel().begin_write();
+}
+
+void TFT_eSPI::endWrite() {
+    if (write_depth == 0 || --write_depth > 0) return;
+    sim_panel().end_write();
+    charge_bus();
+}
+
+void TFT_eSPI::dmaWait() { charge_bus(); }
+
+// Clipped to the panel, as the library does before setting the window
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    const int32_t x0 = max(x, (int32_t)0), y0 = max(y, (int32_t)0);
+    const int32_t x1 = min(x + w, (int32_t)panel_width), y1 = min(y + h, (int32_t)panel_height);
+    if (x1 <= x0 || y1 <= y0) return;
+    sim_panel().fill_rect(x0, y0, x1 - x0, y1 - y0, (uint16_t)color);
+    if (write_depth == 0) charge_bus();
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+    sim_panel().set_window(x, y, w, h);
+    if (write_depth == 0) charge_bus();
+}
+
+void TFT_eSPI::pushPixels(const void *pixels, uint32_t count) {
+    sim_panel().push_pixels((const uint16_t *)pixels, count);
+    if (write_depth == 0) charge_bus();
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *pixels) {
+    sim_panel().push_image(x, y, w, h, pixels, w);
+    if (write_depth == 0) charge_bus();
+}
+
+// Charged at the next dmaWait() or endWrite(), so drawing overlaps the transfer
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *pixels, uint16_t *buffer) {
+    (void)buffer;
+    sim_panel().push_image_dma(x, y, w, h, pixels);
+}
+
+size_t TFT_eSPI::write(const uint8_t *text, size_t size) {
+    char chunk[TEXT_CHUNK + 1];
+    size_t length = 0;
+    for (size_t i = 0; i <= size; i++) {
+        const bool newline = i < size && text[i] == '\n';
+        if (i < size && !newline && length < TEXT_CHUNK) {
+            chunk[length++] = (char)text[i];
+            continue;
+        }
+
+        if (length > 0) {
+            chunk[length] = '\0';
+            sim_panel().draw_text(cursor_x, cursor_y, chunk, text_color, text_bg, text_size);
+            cursor_x += (int16_t)(length * GLYPH_WIDTH * text_size);
+            length = 0;
+        }
+        if (newline) {
+            cursor_x = 0;
+            cursor_y += GLYPH_HEIGHT * text_size;
+        } else if (i < size) {
+            chunk[length++] = (char)text[i];  // The chunk was full
+        }
+    }
+    if (write_depth == 0) charge_bus();
+    return size;
+}
+
+TFT_eSprite::TFT_eSprite(TFT_eSPI *tft)
+    : tft(tft), depth(16), pixels(nullptr), sprite_width(0), sprite_height(0), cursor_x(0), cursor_y(0),
+      text_size(1), text_color(TFT_WHITE), text_bg(TFT_WHITE) {}
+
+void *TFT_eSprite::setColorDepth(int8_t bits) {
+    depth = bits == 8 ? 8 : 16;
+    return pixels;
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t frames) {
+    (void)frames;
+    if (pixels) return pixels;
+    pixels = calloc((size_t)w * h, depth / 8);
+    if (pixels) {
+        sprite_width = w;
+        sprite_height = h;
+    }
+    return pixels;
+}
+
+void TFT_eSprite::deleteSprite() {
+    free(pixels);
+    pixels = nullptr;
+    sprite_width = 0;
+    sprite_height = 0;
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    if (!pixels) return;
+    const int32_t x0 = max(x, (int32_t)0), y0 = max(y, (int32_t)0);
+    const int32_t x1 = min(x + w, (int32_t)sprite_width), y1 = min(y + h, (int32_t)sprite_height);
+
+    if (depth == 8) {
+        // TFT_eSPI's color16to8()
+        const uint8_t c = (uint8_t)((color & 0xE000) >> 8 | (color & 0x0700) >> 6 | (color & 0x0018) >> 3);
+        uint8_t *buffer = (uint8_t *)pixels;
+        for (int32_t row = y0; row < y1; row++) {
+            for (int32_t col = x0; col < x1; col++) buffer[row * sprite_width + col] = c;
+        }
+        return;
+    }
+
+    const uint16_t c = (uint16_t)(color << 8 | (color & 0xFFFF) >> 8);
+    uint16_t *buffer = (uint16_t *)pixels;
+    for (int32_t row = y0; row < y1; row++) {
+        for (int32_t col = x0; col < x1; col++) buffer[row * sprite_width + col] = c;
+    }
+}
+
+void TFT_eSprite::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color) {
+    const int stride = (w + 7) / 8;
+    for (int row = 0; row < h; row++) {
+        for (int col = 0; col < w; col++) {
+            if (bitmap[row * stride + col / 8] & (0x80 >> (col & 7))) drawPixel(x + col, y + row, color);
+        }
+    }
+}
+
+size_t TFT_eSprite::write(uint8_t c) {
+    if (c == '\n') {
+        cursor_x = 0;
+        cursor_y += GLYPH_HEIGHT * text_size;
+        return 1;
+    }
+    if (text_bg != text_color) {
+        fillRect(cursor_x, cursor_y, GLYPH_WIDTH * text_size, GLYPH_HEIGHT * text_size, text_bg);
+    }
+    if (c != ' ') {
+        fillRect(cursor_x, cursor_y, (GLYPH_WIDTH - 1) * text_size, (GLYPH_HEIGHT - 1) * text_size, text_color);
+    }
+    cursor_x += GLYPH_WIDTH * text_size;
+    return 1;
+}
+
+// Binary PPM, 8 bits a channel
+bool sim_write_screenshot(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    const FramebufferDisplay &panel = sim_panel();
+    fprintf(file, "P6\n%d %d\n255\n", TFT_WIDTH, TFT_HEIGHT);
+    for (int y = 0; y < TFT_HEIGHT; y++) {
+        for (int x = 0; x < TFT_WIDTH; x++) {
+            const uint16_t c = panel.pixel(x, y);
+            const uint8_t rgb[3] = {(uint8_t)((c >> 11) * 255 / 31), (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+                                    (uint8_t)((c & 0x1F) * 255 / 31)};
+            fwrite(rgb, 1, sizeof(rgb), file);
+        }
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// Snake body kept as a circular buffer of cells plus a 1-bit occupancy grid,
+// so moving, growing and self-collision are O(1) at any length. The free
+// cells are also kept as an indexable set so food can be placed uniformly
+// on a free cell in O(1), however full the board is.
+
+#define SNAKE_COLS 30  // (SCREEN_WIDTH - 2 * BORDER_SIZE) / SNAKE_SEGMENT_SIZE
+#define SNAKE_ROWS 38  // (SCREEN_HEIGHT - 2 * BORDER_SIZE) / SNAKE_SEGMENT_SIZE
+#define SNAKE_CELLS (SNAKE_COLS * SNAKE_ROWS)
+
+struct SnakeCell {
+    uint8_t x;
+    uint8_t y;
+};
+
+struct SnakeBody {
+    SnakeCell cells[SNAKE_CELLS];  // cells[head] is the head, the tail is length - 1 behind it
+    uint16_t head;
+    uint16_t length;
+    uint32_t occupied[(SNAKE_CELLS + 31) / 32];
+
+    // A permutation of all cell indices with the free ones first;
+    // free_slot[cell] is where a cell currently sits in it
+    uint16_t free_cells[SNAKE_CELLS];
+    uint16_t free_slot[SNAKE_CELLS];
+    uint16_t free_count;
+};
+
+inline bool snake_cell_in_board(int x, int y) {
+    return x >= 0 && x < SNAKE_COLS && y >= 0 && y < SNAKE_ROWS;
+}
+
+inline int snake_cell_index(SnakeCell cell) { return cell.y * SNAKE_COLS + cell.x; }
+
+inline bool snake_body_occupied(const SnakeBody *body, SnakeCell cell) {
+    const int i = snake_cell_index(cell);
+    return (body->occupied[i >> 5] >> (i & 31)) & 1;
+}
+
+// Moves cell to slot in the free cell permutation, swapping out whatever was there
+inline void snake_body_move_slot(SnakeBody *body, int cell, int slot) {
+    const int other = body->free_cells[slot];
+    const int from = body->free_slot[cell];
+
+    body->free_cells[from] = other;
+    body->free_slot[other] = from;
+    body->free_cells[slot] = cell;
+    body->free_slot[cell] = slot;
+}
+
+inline void snake_body_mark(SnakeBody *body, SnakeCell cell, bool occupied) {
+    const int i = snake_cell_index(cell);
+    if (occupied) {
+        body->occupied[i >> 5] |= 1u << (i & 31);
+        snake_body_move_slot(body, i, --body->free_count);
+    } else {
+        body->occupied[i >> 5] &= ~(1u << (i & 31));
+        snake_body_move_slot(body, i, body->free_count++);
+    }
+}
+
+inline void snake_body_reset(SnakeBody *body, SnakeCell start) {
+    memset(body->occupied, 0, sizeof(body->occupied));
+    for (int i = 0; i < SNAKE_CELLS; i++) {
+        body->free_cells[i] = i;
+        body->free_slot[i] = i;
+    }
+    body->free_count = SNAKE_CELLS;
+
+    body->head = 0;
+    body->length = 1;
+    body->cells[0] = start;
+    snake_body_mark(body, start, true);
+}
+
+inline SnakeCell snake_body_head(const SnakeBody *body) { return body->cells[body->head]; }
+
+inline SnakeCell snake_body_tail(const SnakeBody *body) {
+    int tail = body->head - (body->length - 1);
+    if (tail < 0) tail += SNAKE_CELLS;
+    return body->cells[tail];
+}
+
+// Moves the head to next, which must be on the board. Unless grow is set the
+// tail is freed first and written to *vacated, so the head may follow it.
+// Returns false, leaving the body unchanged, if the head runs into the body.
+inline bool snake_body_advance(SnakeBody *body, SnakeCell next, bool grow, SnakeCell *vacated) {
+    const SnakeCell tail = snake_body_tail(body);
+    if (!grow) snake_body_mark(body, tail, false);
+
+    if (snake_body_occupied(body, next)) {
+        if (!grow) snake_body_mark(body, tail, true);
+        return false;
+    }
+
+    // A full board always collides above, so growing never overruns cells
+    body->head = body->head + 1 == SNAKE_CELLS ? 0 : body->head + 1;
+    body->cells[body->head] = next;
+    snake_body_mark(body, next, true);
+
+    if (grow) {
+        body->length++;
+    } else {
+        *vacated = tail;
+    }
+    return true;
+}
+
+inline int snake_body_free_count(const SnakeBody *body) { return body->free_count; }
+
+// Returns the index-th free cell, index < snake_body_free_count(). Picking
+// index uniformly picks a free cell uniformly.
+inline SnakeCell snake_body_free_cell(const SnakeBody *body, int index) {
+    const int i = body->free_cells[index];
+    SnakeCell cell = {(uint8_t)(i % SNAKE_COLS), (uint8_t)(i / SNAKE_COLS)};
+    return cell;
+}
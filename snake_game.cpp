@@ -1,170 +1,179 @@
 #include "snake_game.h"
+#include "snake_body.h"
+#include "input.h"
 
+// Positions and directions are in board cells, see snake_body.h
 struct SnakeGame {
-    Position segments[100];
-    Position food;
-    int length;
+    SnakeBody body;
+    SnakeCell food;
     int dx;
     int dy;
+    int next_dx;  // turn queued by the input task for the next step
+    int next_dy;
+    bool turn_pending;
     int speed;
+    bool grow;  // food was eaten, keep the tail on the next move
     uint8_t running;
 };
 
 // Snake game constants
 const int SNAKE_SEGMENT_SIZE = 4;
 const int INITIAL_SNAKE_SPEED = 100;
-const Position START_POSITION = {60, 80};
+const SnakeCell START_CELL = {14, 19};
 
 SnakeGame snake;
+GameLoop snake_loop;
 SemaphoreHandle_t snake_mutex;
-TaskHandle_t snake_task_handle = NULL;
-TaskHandle_t snake_input_task_handle = NULL;
+TaskStop snake_stop;
+TaskStop snake_input_stop;
+QueueHandle_t snake_input;
 
 // Direction vectors: [Up, Left, Down, Right]
 const int DIRECTION_VECTORS[4][2] = {
-    {0, -SNAKE_SEGMENT_SIZE},  // Up
-    {-SNAKE_SEGMENT_SIZE, 0},  // Left
-    {0, SNAKE_SEGMENT_SIZE},   // Down
-    {SNAKE_SEGMENT_SIZE, 0}    // Right
+    {0, -1},  // Up
+    {-1, 0},  // Left
+    {0, 1},   // Down
+    {1, 0}    // Right
 };
 
-volatile int new_dx = 0;
-volatile int new_dy = 0;
-volatile bool input_received = false;
-volatile bool snake_position_updated = false;
 volatile bool self_ate = false;
+volatile bool board_filled = false;
 
-void IRAM_ATTR handle_button_press(int buttonIndex) {
-    int temp_dx = DIRECTION_VECTORS[buttonIndex][0];
-    int temp_dy = DIRECTION_VECTORS[buttonIndex][1];
-    
-    if (snake.dx == temp_dx && snake.dy == temp_dy) {
-        return;
-    }
+// Queues a turn for the next step. One turn per step, and never straight back.
+void handle_direction_press(int direction) {
+    TRACE_INSTANT(TRACE_SNAKE_BUTTON, direction);
+    const int dx = DIRECTION_VECTORS[direction][0];
+    const int dy = DIRECTION_VECTORS[direction][1];
 
-    if (snake_position_updated &&(snake.dx + temp_dx != 0 || snake.dy + temp_dy != 0)) {
-        new_dx = temp_dx;
-        new_dy = temp_dy;
-        input_received = true;
+    xSemaphoreTake(snake_mutex, portMAX_DELAY);
+    const bool same = snake.dx == dx && snake.dy == dy;
+    const bool reverse = snake.dx + dx == 0 && snake.dy + dy == 0;
+    if (!snake.turn_pending && !same && !reverse) {
+        snake.next_dx = dx;
+        snake.next_dy = dy;
+        snake.turn_pending = true;
     }
+    xSemaphoreGive(snake_mutex);
 }
 
-void IRAM_ATTR btnUpISR() { handle_button_press(0); }
-void IRAM_ATTR btnLeftISR() { handle_button_press(1); }
-void IRAM_ATTR btnDownISR() { handle_button_press(2); }
-void IRAM_ATTR btnRightISR() { handle_button_press(3); }
-
 void snake_input_task(void *pv) {
-    while (current_state == STATE_SNAKE) {
-        if (input_received && snake_position_updated) {
-            xSemaphoreTake(snake_mutex, portMAX_DELAY);
-            snake.dx = new_dx;
-            snake.dy = new_dy;
-            input_received = false;
-            snake_position_updated = false;
-            xSemaphoreGive(snake_mutex);
+    InputEvent event;
+
+    while (!task_stop_requested(&snake_input_stop)) {
+        if (xQueueReceive(snake_input, &event, pdMS_TO_TICKS(TASK_STOP_POLL_MS)) != pdTRUE) {
+            continue;
+        }
+        if (event.type == INPUT_PRESS) {
+            handle_direction_press(event.button);  // InputButton arrows match DIRECTION_VECTORS
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
+    task_stop_exit(&snake_input_stop);
+}
+
+void draw_cell(SnakeCell cell, uint16_t color) {
+    render_rect(BORDER_SIZE + cell.x * SNAKE_SEGMENT_SIZE, BORDER_SIZE + cell.y * SNAKE_SEGMENT_SIZE,
+                SNAKE_SEGMENT_SIZE, SNAKE_SEGMENT_SIZE, color);
+}
+
+// Picks a free cell uniformly. Returns false once the snake fills the board.
+bool place_food() {
+    const int free_count = snake_body_free_count(&snake.body);
+    if (free_count == 0) {
+        return false;
+    }
+
+    snake.food = snake_body_free_cell(&snake.body, random(0, free_count));
+    return true;
 }
 
 void initialize_snake_game() {
     xSemaphoreTake(snake_mutex, portMAX_DELAY);
 
-    // Initialize snake state
-    snake = (SnakeGame){.segments = {START_POSITION},
-                        .length = 1,
-                        .dx = SNAKE_SEGMENT_SIZE,
-                        .dy = 0,
-                        .speed = INITIAL_SNAKE_SPEED,
-                        .running = 1};
+    // Initialize snake state. The body is too large to build as a temporary on the task stack.
+    snake_body_reset(&snake.body, START_CELL);
+    snake.dx = 1;
+    snake.dy = 0;
+    snake.turn_pending = false;
+    snake.speed = INITIAL_SNAKE_SPEED;
+    snake.grow = false;
+    snake.running = 1;
 
-    // Calculate play area dimensions
-    const uint16_t play_width = SCREEN_WIDTH - 2 * BORDER_SIZE - SNAKE_SEGMENT_SIZE;
-    const uint16_t play_height = SCREEN_HEIGHT - 2 * BORDER_SIZE - SNAKE_SEGMENT_SIZE;
-
-    // Generate initial food position
-    snake.food.x = BORDER_SIZE + (random(0, play_width / SNAKE_SEGMENT_SIZE) * SNAKE_SEGMENT_SIZE);
-    snake.food.y = BORDER_SIZE + (random(0, play_height / SNAKE_SEGMENT_SIZE) * SNAKE_SEGMENT_SIZE);
+    place_food();
 
     // Draw initial game state
-    tft.fillScreen(TFT_BLACK);
-    tft.fillRect(0, 0, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);   // Top border
-    tft.fillRect(0, 0, BORDER_SIZE, SCREEN_HEIGHT, TFT_WHITE);  // Left border
-    tft.fillRect(SCREEN_WIDTH - BORDER_SIZE, 0, BORDER_SIZE, SCREEN_HEIGHT,
-                 TFT_WHITE);  // Right border
-    tft.fillRect(0, SCREEN_HEIGHT - BORDER_SIZE, SCREEN_WIDTH, BORDER_SIZE,
-                 TFT_WHITE);  // Bottom border
-    tft.fillRect(snake.food.x, snake.food.y, SNAKE_SEGMENT_SIZE, SNAKE_SEGMENT_SIZE, TFT_GREEN);
+    render_clear(TFT_BLACK);
+    render_rect(0, 0, SCREEN_WIDTH, BORDER_SIZE, TFT_WHITE);   // Top border
+    render_rect(0, 0, BORDER_SIZE, SCREEN_HEIGHT, TFT_WHITE);  // Left border
+    render_rect(SCREEN_WIDTH - BORDER_SIZE, 0, BORDER_SIZE, SCREEN_HEIGHT,
+                TFT_WHITE);  // Right border
+    render_rect(0, SCREEN_HEIGHT - BORDER_SIZE, SCREEN_WIDTH, BORDER_SIZE,
+                TFT_WHITE);  // Bottom border
+    draw_cell(snake.food, TFT_GREEN);
 
     xSemaphoreGive(snake_mutex);
 }
 
-void update_snake_position() {
-    // Move body segments
-    for (int i = snake.length - 1; i > 0; i--) {
-        snake.segments[i] = snake.segments[i - 1];
+// Moves the snake one cell. Returns false on a wall or self collision.
+bool update_snake_position() {
+    if (snake.turn_pending) {
+        snake.dx = snake.next_dx;
+        snake.dy = snake.next_dy;
+        snake.turn_pending = false;
     }
 
-    // Update head position
-    snake.segments[0].x += snake.dx;
-    snake.segments[0].y += snake.dy;
-
-    snake_position_updated = true;
-}
-
-bool check_snake_collisions() {
-    const Position head = snake.segments[0];
+    const SnakeCell head = snake_body_head(&snake.body);
+    const int x = head.x + snake.dx;
+    const int y = head.y + snake.dy;
 
     // Wall collision check
-    if (head.x < BORDER_SIZE || head.x >= SCREEN_WIDTH - BORDER_SIZE || head.y < BORDER_SIZE ||
-        head.y >= SCREEN_HEIGHT - BORDER_SIZE) {
-        return true;
+    if (!snake_cell_in_board(x, y)) {
+        return false;
     }
 
-    // Self-collision check
-    for (int i = 1; i < snake.length; i++) {
-        if (head.x == snake.segments[i].x && head.y == snake.segments[i].y) {
-            self_ate = true;
-            return true;
-        }
+    // Self-collision check, the tail moves out of the way unless growing
+    const SnakeCell next = {(uint8_t)x, (uint8_t)y};
+    SnakeCell vacated;
+    const bool grew = snake.grow;
+    if (!snake_body_advance(&snake.body, next, grew, &vacated)) {
+        self_ate = true;
+        return false;
     }
 
-    return false;
+    snake.grow = false;
+    if (!grew) {
+        draw_cell(vacated, TFT_BLACK);
+    }
+    return true;
 }
 
 void handle_food_consumption() {
-    if (snake.segments[0].x == snake.food.x && snake.segments[0].y == snake.food.y) {
-        if (snake.length < 100) {
-            snake.segments[snake.length] = snake.segments[snake.length - 1];
-            snake.length++;
-        }
-
+    const SnakeCell head = snake_body_head(&snake.body);
+    if (head.x == snake.food.x && head.y == snake.food.y) {
+        snake.grow = true;
         snake.speed = (snake.speed > 30) ? snake.speed - 2 : 30;
+        game_loop_set_step(&snake_loop, snake.speed);
 
-        // Generate new food position
-        const uint16_t play_width = SCREEN_WIDTH - 2 * BORDER_SIZE - SNAKE_SEGMENT_SIZE;
-        const uint16_t play_height = SCREEN_HEIGHT - 2 * BORDER_SIZE - SNAKE_SEGMENT_SIZE;
-
-        snake.food.x =
-            BORDER_SIZE + (random(0, play_width / SNAKE_SEGMENT_SIZE) * SNAKE_SEGMENT_SIZE);
-        snake.food.y =
-            BORDER_SIZE + (random(0, play_height / SNAKE_SEGMENT_SIZE) * SNAKE_SEGMENT_SIZE);
-
-        tft.fillRect(snake.food.x, snake.food.y, SNAKE_SEGMENT_SIZE, SNAKE_SEGMENT_SIZE, TFT_GREEN);
+        if (!place_food()) {
+            board_filled = true;
+            snake.running = 0;
+            return;
+        }
+        draw_cell(snake.food, TFT_GREEN);
     }
 }
 
 void snake_gameover() {
-    tft.fillScreen(TFT_BLACK);
-    if (self_ate) {
+    render_clear(TFT_BLACK);
+    if (board_filled) {
+        draw_centered_text("You Win!", 60, TFT_WHITE, 2);
+    } else if (self_ate) {
         draw_centered_text("Fake Over!", 60, TFT_WHITE, 2);
     } else {
         draw_centered_text("Game Over!", 60, TFT_WHITE, 2);
     }
 
     char score[20];
-    snprintf(score, sizeof(score), "Score: %d", snake.length - 1);
+    snprintf(score, sizeof(score), "Score: %d", snake.body.length - 1);
     draw_centered_text(score, 85, TFT_WHITE, 1);
     draw_centered_text("Press A", 105, TFT_WHITE, 1);
 
@@ -173,66 +182,58 @@ void snake_gameover() {
 
 void snake_task(void *pv) {
     initialize_snake_game();
-    static int prev_length = 1;
 
-    while (current_state == STATE_SNAKE) {
+    // The snake is drawn incrementally on every step, so there is no separate render pacing
+    game_loop_start(&snake_loop, INITIAL_SNAKE_SPEED, 0);
+
+    while (game_loop_wait(&snake_loop, &snake_stop)) {
+        TRACE_BEGIN(TRACE_SNAKE_TICK);
         xSemaphoreTake(snake_mutex, portMAX_DELAY);
 
         if (!snake.running) {
             xSemaphoreGive(snake_mutex);  
             snake_gameover();
-            vTaskSuspend(NULL);
-            vTaskSuspend(snake_input_task_handle);          
+            task_stop_wait(&snake_stop);
             break;
         }
 
-        // Clear previous tail if not growing
-        if (snake.length == prev_length) {
-            const Position tail = snake.segments[snake.length - 1];
-            tft.fillRect(tail.x, tail.y, SNAKE_SEGMENT_SIZE, SNAKE_SEGMENT_SIZE, TFT_BLACK);
-        }
-        prev_length = snake.length;
-
-        update_snake_position();
-        snake.running = !check_snake_collisions();
-        handle_food_consumption();
+        snake.running = update_snake_position();
+        if (snake.running) {
+            // Draw new head position
+            draw_cell(snake_body_head(&snake.body), TFT_WHITE);
 
-        // Draw new head position
-        const Position head = snake.segments[0];
-        tft.fillRect(head.x, head.y, SNAKE_SEGMENT_SIZE, SNAKE_SEGMENT_SIZE, TFT_WHITE);
+            handle_food_consumption();
+        }
 
         xSemaphoreGive(snake_mutex);
-        vTaskDelay(pdMS_TO_TICKS(snake.speed));
+        TRACE_END(TRACE_SNAKE_TICK);
+        game_loop_frame_done(&snake_loop);
     }
+    task_stop_exit(&snake_stop);
 }
 
-void snake_init_mutex() { snake_mutex = xSemaphoreCreateMutex(); }
+GameLoopStats snake_get_loop_stats() { return game_loop_get_stats(&snake_loop); }
+
+void snake_init_mutex() {
+    snake_mutex = xSemaphoreCreateMutex();
+    task_stop_init(&snake_stop);
+    task_stop_init(&snake_input_stop);
+    snake_input = input_subscribe(STATE_SNAKE, INPUT_ARROWS);
+}
 
 void snake_launch_tasks() {
     self_ate = false;
+    board_filled = false;
 
-    attachInterrupt(digitalPinToInterrupt(BTN_UP), btnUpISR, FALLING);
-    attachInterrupt(digitalPinToInterrupt(BTN_LEFT), btnLeftISR, FALLING);
-    attachInterrupt(digitalPinToInterrupt(BTN_DOWN), btnDownISR, FALLING);
-    attachInterrupt(digitalPinToInterrupt(BTN_RIGHT), btnRightISR, FALLING);
+    input_flush(snake_input);
 
-    xTaskCreatePinnedToCore(snake_task, "Snake", 4096, NULL, 2, &snake_task_handle, 1);
-    xTaskCreatePinnedToCore(snake_input_task, "SnakeInput", 2048, NULL, 3, &snake_input_task_handle, 0);
+    task_stop_reset(&snake_stop);
+    task_stop_reset(&snake_input_stop);
+    xTaskCreatePinnedToCore(snake_task, "Snake", 4096, NULL, 2, &snake_stop.task, 1);
+    xTaskCreatePinnedToCore(snake_input_task, "SnakeInput", 2048, NULL, 3, &snake_input_stop.task, 0);
 }
 
 void snake_exit() {
-    detachInterrupt(digitalPinToInterrupt(BTN_UP));
-    detachInterrupt(digitalPinToInterrupt(BTN_LEFT));
-    detachInterrupt(digitalPinToInterrupt(BTN_DOWN));
-    detachInterrupt(digitalPinToInterrupt(BTN_RIGHT));
-
-    if (snake_task_handle != NULL) {
-        vTaskDelete(snake_task_handle);
-        snake_task_handle = NULL;
-    }
-    
-    if (snake_input_task_handle != NULL) {
-        vTaskDelete(snake_input_task_handle);
-        snake_input_task_handle = NULL;
-    }
+    task_stop_join(&snake_stop);
+    task_stop_join(&snake_input_stop);
 }
\ No newline at end of file
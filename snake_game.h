@@ -1,6 +1,7 @@
 #pragma once
 #include "common.h"
 
+GameLoopStats snake_get_loop_stats();
 void snake_launch_tasks();
 void snake_init_mutex();
 void snake_exit();
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "task_stop.h"
+
+void task_stop_init(TaskStop *stop) {
+    stop->task = NULL;
+    stop->requested = false;
+    stop->done = xSemaphoreCreateBinary();
+}
+
+void task_stop_reset(TaskStop *stop) {
+    stop->task = NULL;
+    stop->requested = false;
+    xSemaphoreTake(stop->done, 0);
+}
+
+bool task_stop_requested(const TaskStop *stop) {
+    return stop->requested;
+}
+
+void task_stop_wait(const TaskStop *stop) {
+    while (!stop->requested) {
+        vTaskDelay(pdMS_TO_TICKS(TASK_STOP_POLL_MS));
+    }
+}
+
+void task_stop_exit(TaskStop *stop) {
+    xSemaphoreGive(stop->done);
+    vTaskDelete(NULL);
+}
+
+void task_stop_join(TaskStop *stop) {
+    if (stop->task == NULL) return;
+
+    stop->requested = true;
+    xSemaphoreTake(stop->done, portMAX_DELAY);
+    stop->task = NULL;
+}
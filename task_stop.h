@@ -0,0 +1,35 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+// Stops a task at a point of its choosing. Deleting a task from outside can
+// catch it holding a mutex, or waiting in render_sync() for a fence the render
+// task would then signal on a freed task. Instead the owner asks it to stop
+// and waits: the task checks task_stop_requested() at least every
+// TASK_STOP_POLL_MS, blocking waits included, and ends with task_stop_exit().
+//
+//   task_stop_reset(&stop);
+//   xTaskCreate(task, "Task", 4096, NULL, 1, &stop.task);
+//   ...
+//   task_stop_join(&stop);  // from another task
+
+#define TASK_STOP_POLL_MS 50
+
+struct TaskStop {
+    TaskHandle_t task;  // pass &stop.task to xTaskCreate
+    volatile bool requested;
+    SemaphoreHandle_t done;
+};
+
+// Once, at startup
+void task_stop_init(TaskStop *stop);
+// Before creating the task
+void task_stop_reset(TaskStop *stop);
+bool task_stop_requested(const TaskStop *stop);
+// Parks the calling task until it is asked to stop, e.g. after a game over
+void task_stop_wait(const TaskStop *stop);
+// The task's last call: wakes task_stop_join() and deletes the calling task
+void task_stop_exit(TaskStop *stop);
+// Asks the task to stop and waits until it has. Does nothing if it isn't running.
+void task_stop_join(TaskStop *stop);
@@ -0,0 +1,230 @@
+#include "telemetry.h"
+#include "input.h"
+#include "live_pixel.h"
+#include "pixel_ring.h"
+#include "snake_game.h"
+
+const int OVERLAY_Y = SCREEN_HEIGHT - 8;
+
+static TelemetrySnapshot snapshot;
+static portMUX_TYPE snapshot_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool serial_enabled = true;
+static volatile bool websocket_enabled = false;
+static volatile bool overlay_enabled = false;
+static QueueHandle_t overlay_input;
+
+// Per task figures, formatted by other tasks too
+static TaskTelemetry *task_list = NULL;
+static int task_count = 0;
+static SemaphoreHandle_t task_list_lock;
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+// Room for tasks created between counting them and taking their status
+const int TASK_SLACK = 4;
+
+// This sample's and the previous sample's status of every task, to turn run
+// time totals into percentages. Grown along with task_list.
+static TaskStatus_t *status_now = NULL;
+static TaskStatus_t *status_prev = NULL;
+static int task_capacity = 0;
+static int prev_count = 0;
+static uint32_t prev_total = 0;
+
+bool reserve_tasks(int capacity) {
+    if (capacity <= task_capacity) return true;
+
+    // realloc() leaves the old buffer in place when it fails
+    TaskStatus_t *now = (TaskStatus_t *)realloc(status_now, capacity * sizeof(TaskStatus_t));
+    if (now) status_now = now;
+    TaskStatus_t *prev = (TaskStatus_t *)realloc(status_prev, capacity * sizeof(TaskStatus_t));
+    if (prev) status_prev = prev;
+    xSemaphoreTake(task_list_lock, portMAX_DELAY);
+    TaskTelemetry *list = (TaskTelemetry *)realloc(task_list, capacity * sizeof(TaskTelemetry));
+    if (list) task_list = list;
+    xSemaphoreGive(task_list_lock);
+
+    if (!now || !prev || !list) return false;
+    task_capacity = capacity;
+    return true;
+}
+
+uint32_t previous_counter(TaskHandle_t handle) {
+    for (int i = 0; i < prev_count; i++) {
+        if (status_prev[i].xHandle == handle) return status_prev[i].ulRunTimeCounter;
+    }
+    return 0;  // Created since the previous sample
+}
+
+void sample_tasks() {
+    uint32_t total = 0;
+    int count = 0;
+    // uxTaskGetSystemState() returns 0 if the tasks don't fit, so count again
+    // if more were created than the slack allows for
+    for (int attempt = 0; attempt < 2 && count == 0; attempt++) {
+        if (!reserve_tasks(uxTaskGetNumberOfTasks() + TASK_SLACK)) return;
+        count = uxTaskGetSystemState(status_now, task_capacity, &total);
+    }
+    const uint32_t elapsed = (total - prev_total) * portNUM_PROCESSORS;
+
+    xSemaphoreTake(task_list_lock, portMAX_DELAY);
+    for (int i = 0; i < count; i++) {
+        TaskTelemetry &task = task_list[i];
+        const uint32_t ran = status_now[i].ulRunTimeCounter - previous_counter(status_now[i].xHandle);
+
+        strncpy(task.name, status_now[i].pcTaskName, sizeof(task.name) - 1);
+        task.name[sizeof(task.name) - 1] = '\0';
+        task.cpu_percent = elapsed ? min((uint32_t)100, (uint32_t)((uint64_t)ran * 100 / elapsed)) : 0;
+        task.stack_free = status_now[i].usStackHighWaterMark;
+    }
+    task_count = count;
+    xSemaphoreGive(task_list_lock);
+
+    TaskStatus_t *previous = status_prev;
+    status_prev = status_now;
+    status_now = previous;
+    prev_count = count;
+    prev_total = total;
+}
+#else
+void sample_tasks() {}
+#endif
+
+void take_snapshot() {
+    static TelemetrySnapshot sample;
+    sample_tasks();
+
+    sample.uptime_ms = millis();
+    sample.heap_free = ESP.getFreeHeap();
+    sample.heap_largest = ESP.getMaxAllocHeap();
+    sample.heap_min_free = ESP.getMinFreeHeap();
+
+    const LivePixelStats pixel_stats = live_pixel_get_stats();
+    sample.ring_used = pixel_stats.ring_used;
+    sample.ring_overflows = pixel_stats.ring_overflows;
+    sample.flush_us_max = pixel_stats.flush_us_max;
+    sample.sync_gaps = pixel_stats.sync_gaps;
+
+    sample.render = PongRenderStats();
+    if (current_state == STATE_SNAKE) {
+        sample.frame = snake_get_loop_stats();
+    } else if (current_state == STATE_PONG) {
+        sample.frame = pong_get_loop_stats();
+        sample.render = pong_get_render_stats();
+    } else {
+        sample.frame = GameLoopStats();
+    }
+
+    portENTER_CRITICAL(&snapshot_lock);
+    snapshot = sample;
+    portEXIT_CRITICAL(&snapshot_lock);
+}
+
+TelemetrySnapshot telemetry_get() {
+    portENTER_CRITICAL(&snapshot_lock);
+    const TelemetrySnapshot copy = snapshot;
+    portEXIT_CRITICAL(&snapshot_lock);
+    return copy;
+}
+
+int telemetry_format(char *buf, size_t size) {
+    const TelemetrySnapshot s = telemetry_get();
+
+    // up heap=free/largest/min ring=used/size+overflows flush gaps frame=mean/p99/max/overruns
+    // [render=mode/mean/max/spi wait mean] tasks=name:cpu%:stack
+    int len = snprintf(buf, size, "up=%lu heap=%lu/%lu/%lu ring=%lu/%u+%lu flush=%lu gaps=%lu frame=%lu/%lu/%lu/%lu",
+                       (unsigned long)s.uptime_ms / 1000, (unsigned long)s.heap_free,
+                       (unsigned long)s.heap_largest, (unsigned long)s.heap_min_free,
+                       (unsigned long)s.ring_used, PIXEL_RING_SIZE, (unsigned long)s.ring_overflows,
+                       (unsigned long)s.flush_us_max, (unsigned long)s.sync_gaps, (unsigned long)s.frame.frame_us_mean,
+                       (unsigned long)s.frame.frame_us_p99, (unsigned long)s.frame.frame_us_max,
+                       (unsigned long)s.frame.overruns);
+
+    if (s.render.frames > 0 && len < (int)size) {
+        len += snprintf(buf + len, size - len, " render=%s/%lu/%lu/%lu",
+                        s.render.mode == PONG_RENDER_SPRITE ? "sprite" : "direct",
+                        (unsigned long)(s.render.frame_us_total / s.render.frames),
+                        (unsigned long)s.render.frame_us_max,
+                        (unsigned long)(s.render.spi_wait_us_total / s.render.frames));
+    }
+    if (len < (int)size) {
+        len += snprintf(buf + len, size - len, " tasks=");
+    }
+
+    xSemaphoreTake(task_list_lock, portMAX_DELAY);
+    for (int i = 0; i < task_count && len < (int)size; i++) {
+        len += snprintf(buf + len, size - len, "%s%s:%u:%lu", i ? "," : "", task_list[i].name,
+                        task_list[i].cpu_percent, (unsigned long)task_list[i].stack_free);
+    }
+    xSemaphoreGive(task_list_lock);
+    return min(len, (int)size - 1);
+}
+
+void draw_overlay() {
+    const TelemetrySnapshot s = telemetry_get();
+    char text[RENDER_TEXT_MAX];
+
+    // Clamped to fit the 21 columns of size 1 text, at most "H9999k R9999 F999ms"
+    snprintf(text, sizeof(text), "H%luk R%lu F%lums", min((unsigned long)s.heap_free / 1024, 9999UL),
+             min((unsigned long)s.ring_used, 9999UL), min((unsigned long)s.frame.frame_us_p99 / 1000, 999UL));
+    render_rect(0, OVERLAY_Y, SCREEN_WIDTH, 8, TFT_BLACK);
+    render_text(0, OVERLAY_Y, text, TFT_YELLOW, TFT_BLACK, 1);
+}
+
+void erase_overlay() {
+    render_rect(0, OVERLAY_Y, SCREEN_WIDTH, 8, TFT_BLACK);
+}
+
+void telemetry_task(void *pv) {
+    static char line[TELEMETRY_LINE_MAX];
+    TickType_t next_sample = xTaskGetTickCount() + pdMS_TO_TICKS(TELEMETRY_PERIOD_MS);
+    InputEvent event;
+
+    while (true) {
+        // BTN_ALT toggles the overlay while waiting for the next sample. Only
+        // this task draws it, so it can't be drawn again after being erased.
+        const TickType_t now = xTaskGetTickCount();
+        const TickType_t wait = (int32_t)(next_sample - now) > 0 ? next_sample - now : 0;
+        if (xQueueReceive(overlay_input, &event, wait) == pdTRUE) {
+            if (event.type == INPUT_PRESS) {
+                overlay_enabled = !overlay_enabled;
+                if (overlay_enabled) {
+                    draw_overlay();
+                } else {
+                    erase_overlay();
+                }
+            }
+            continue;
+        }
+        next_sample += pdMS_TO_TICKS(TELEMETRY_PERIOD_MS);
+        take_snapshot();
+
+        if (serial_enabled) {
+            telemetry_format(line, sizeof(line));
+            Serial.print("T ");
+            Serial.println(line);
+        }
+        if (overlay_enabled) {
+            draw_overlay();
+        }
+    }
+}
+
+void telemetry_init() {
+    task_list_lock = xSemaphoreCreateMutex();
+    overlay_input = input_subscribe(INPUT_ANY_STATE, INPUT_MASK(INPUT_ALT));
+    xTaskCreatePinnedToCore(telemetry_task, "Telemetry", 3072, NULL, 1, NULL, 0);
+}
+
+void telemetry_set_serial(bool enabled) { serial_enabled = enabled; }
+
+bool telemetry_serial_enabled() { return serial_enabled; }
+
+void telemetry_set_websocket(bool enabled) { websocket_enabled = enabled; }
+
+bool telemetry_websocket_enabled() { return websocket_enabled; }
+
+// Handled by telemetry_task as if BTN_ALT was pressed
+void telemetry_toggle_overlay() {
+    const InputEvent press = {INPUT_ALT, INPUT_PRESS, (uint32_t)micros()};
+    xQueueSend(overlay_input, &press, 0);
+}
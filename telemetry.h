@@ -0,0 +1,44 @@
+#pragma once
+#include "common.h"
+#include "pong_game.h"
+
+// Periodic snapshot of task CPU use and stack headroom, heap, the Live Pixel
+// ring and the running game's frame times. Printed as one line over Serial,
+// optionally sent to the Live Pixel server, and shown as an overlay toggled
+// with BTN_ALT. The Serial commands in Resptro32.ino switch each output.
+
+#define TELEMETRY_PERIOD_MS 2000
+#define TELEMETRY_LINE_MAX 512
+
+struct TaskTelemetry {
+    char name[configMAX_TASK_NAME_LEN];
+    uint8_t cpu_percent;  // of both cores, since the previous sample
+    uint32_t stack_free;  // high-water mark, bytes never used
+};
+
+// Everything but the per task figures, which are kept in a list sized from
+// the number of tasks and only reach telemetry_format(). They are left out
+// if the FreeRTOS run time stats are not enabled.
+struct TelemetrySnapshot {
+    uint32_t uptime_ms;
+    uint32_t heap_free;
+    uint32_t heap_largest;   // largest allocatable block
+    uint32_t heap_min_free;  // low-water mark since boot
+    uint32_t ring_used;
+    uint32_t ring_overflows;
+    uint32_t flush_us_max;   // Live Pixel canvas flush
+    uint32_t sync_gaps;      // Live Pixel deltas recovered by a resync
+    GameLoopStats frame;     // the running game, zero outside Snake and Pong
+    PongRenderStats render;  // zero outside Pong
+};
+
+void telemetry_init();
+TelemetrySnapshot telemetry_get();
+// Formats the latest snapshot as a single line. Returns its length.
+int telemetry_format(char *buf, size_t size);
+void telemetry_set_serial(bool enabled);
+bool telemetry_serial_enabled();
+void telemetry_set_websocket(bool enabled);
+bool telemetry_websocket_enabled();
+// Shows or erases the overlay, from any task
+void telemetry_toggle_overlay();
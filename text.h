@@ -0,0 +1,88 @@
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Fixed-capacity text, for anything the firmware formats at run time instead
+// of Arduino String. The storage is part of the object, so building text
+// never touches the heap however long the device runs. Text that doesn't
+// fit is cut off, and the writer returns false.
+
+#define TEXT_IP_MAX 16    // "255.255.255.255"
+#define TEXT_LINE_MAX 32  // one screen line, and a little more
+#define TEXT_URL_MAX 64
+
+template <size_t N>
+struct Text {
+    char data[N];
+    size_t length;
+
+    const char *c_str() const { return data; }
+};
+
+template <size_t N>
+inline void text_clear(Text<N> *text) {
+    text->data[0] = '\0';
+    text->length = 0;
+}
+
+template <size_t N>
+inline bool text_append(Text<N> *text, const char *s) {
+    const size_t n = strlen(s);
+    const size_t room = N - 1 - text->length;
+    const size_t copied = n < room ? n : room;
+
+    memcpy(text->data + text->length, s, copied);
+    text->length += copied;
+    text->data[text->length] = '\0';
+    return copied == n;
+}
+
+template <size_t N>
+inline bool text_vappendf(Text<N> *text, const char *format, va_list args) {
+    const size_t room = N - text->length;
+    const int n = vsnprintf(text->data + text->length, room, format, args);
+    if (n < 0) {
+        text->data[text->length] = '\0';
+        return false;
+    }
+
+    text->length += (size_t)n < room ? (size_t)n : room - 1;
+    return (size_t)n < room;
+}
+
+template <size_t N>
+inline bool text_appendf(Text<N> *text, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    const bool fits = text_vappendf(text, format, args);
+    va_end(args);
+    return fits;
+}
+
+template <size_t N>
+inline bool text_set(Text<N> *text, const char *s) {
+    text_clear(text);
+    return text_append(text, s);
+}
+
+template <size_t N>
+inline bool text_printf(Text<N> *text, const char *format, ...) {
+    text_clear(text);
+
+    va_list args;
+    va_start(args, format);
+    const bool fits = text_vappendf(text, format, args);
+    va_end(args);
+    return fits;
+}
+
+// Copies a C string into a plain char array, always terminated
+inline bool text_copy(char *dest, size_t size, const char *src) {
+    const size_t n = strlen(src);
+    const size_t copied = n < size - 1 ? n : size - 1;
+    memcpy(dest, src, copied);
+    dest[copied] = '\0';
+    return copied == n;
+}
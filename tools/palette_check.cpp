@@ -0,0 +1,34 @@
+// Checks the renderer's RGB332 palette against TFT_eSPI's color8to16(), so
+// 8-bit sprites pushed by the renderer match ones pushed by TFT_eSPI.
+//
+//   g++ -O2 -o palette_check tools/palette_check.cpp
+//   palette_check
+//
+// Exits non-zero and lists the entries that differ.
+
+#include <stdio.h>
+#include "../color332.h"
+
+// TFT_eSPI::color8to16(), copied as written
+static uint16_t color8to16(uint8_t color) {
+    uint8_t blue[] = {0, 11, 21, 31};
+    uint16_t color16 = 0;
+
+    color16 = (color & 0x1C) << 6 | (color & 0xC0) << 5 | (color & 0xE0) << 8;
+    color16 |= (color & 0x1C) << 3 | blue[color & 0x03];
+    return color16;
+}
+
+int main() {
+    int failures = 0;
+    for (int c = 0; c < 256; c++) {
+        const uint16_t expected = color8to16((uint8_t)c);
+        const uint16_t actual = color332_to_565((uint8_t)c);
+        if (actual != expected) {
+            printf("0x%02x: 0x%04x, expected 0x%04x\n", c, actual, expected);
+            failures++;
+        }
+    }
+    printf("%d of 256 palette entries differ\n", failures);
+    return failures ? 1 : 0;
+}
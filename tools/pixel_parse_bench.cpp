@@ -0,0 +1,243 @@
+// Measures how fast the firmware's Live Pixel decoders in pixel_protocol.h
+// get through a message, and how many heap allocations each makes, next to
+// the String/substring/sscanf parsing they replaced.
+//
+//   g++ -O2 -o pixel_parse_bench tools/pixel_parse_bench.cpp
+//   pixel_parse_bench [--records N] [--seconds S]
+//
+// The replaced parsing is redone with std::string, which keeps short
+// substrings inline where Arduino's String always allocates, so its
+// allocation counts are a lower bound. Every decoder must produce the same
+// pixels; it exits non-zero if one doesn't.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include "../pixel_protocol.h"
+#include "tool_common.h"
+
+static long allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Order-dependent sum of the decoded pixels, to compare decoders
+struct Checksum {
+    uint64_t value = 0;
+    long pixels = 0;
+    void add(int x, int y, uint16_t color) {
+        value = value * 31 + (uint64_t)((x << 24) | (y << 16) | color);
+        pixels++;
+    }
+};
+
+struct Message {
+    std::string text;
+    std::vector<uint8_t> binary;
+};
+
+// The same records as a "chunk;" message and a PIXELS frame
+static Message make_records(int count, uint32_t seed) {
+    Message msg;
+    msg.text = "chunk;0;1;" + std::to_string(count) + ";";
+    msg.binary.resize(PIXEL_PROTO_HEADER_SIZE + count * PIXEL_PROTO_RECORD_SIZE);
+    pixel_frame_write_header(msg.binary.data(), PIXEL_OP_PIXELS, (uint16_t)count);
+
+    char record[32];
+    for (int i = 0; i < count; i++) {
+        const uint32_t r = next_random(&seed);
+        const PixelRecord pixel = {(uint8_t)(r % PIXEL_CANVAS_SIZE), (uint8_t)(r / 32 % PIXEL_CANVAS_SIZE),
+                                   (uint16_t)(r >> 16)};
+        snprintf(record, sizeof(record), "%s%d,%d,%x", i ? ";" : "", pixel.x, pixel.y, pixel.color);
+        msg.text += record;
+        pixel_frame_write_record(msg.binary.data(), (uint16_t)i, pixel);
+    }
+    return msg;
+}
+
+// The same canvas as a "full," message and a KEYFRAME
+static Message make_full_frame(uint32_t seed) {
+    Message msg;
+    msg.text = "full,";
+    const size_t offset = PIXEL_PROTO_HEADER_SIZE + PIXEL_PROTO_SEQ_SIZE;
+    msg.binary.resize(offset + PIXEL_KEYFRAME_COLORS * PIXEL_PROTO_COLOR_SIZE);
+    pixel_frame_write_header(msg.binary.data(), PIXEL_OP_KEYFRAME, PIXEL_KEYFRAME_COLORS);
+    pixel_write_u32(msg.binary.data() + PIXEL_PROTO_HEADER_SIZE, 1);
+
+    char color[8];
+    for (int i = 0; i < PIXEL_KEYFRAME_COLORS; i++) {
+        const uint16_t c = (uint16_t)(next_random(&seed) >> 8);
+        snprintf(color, sizeof(color), "%s%x", i ? "," : "", c);
+        msg.text += color;
+        msg.binary[offset + i * 2] = c & 0xFF;
+        msg.binary[offset + i * 2 + 1] = c >> 8;
+    }
+    return msg;
+}
+
+// The "chunk;" branch as it was: indexOf, substring and sscanf per record
+static void legacy_chunk(const std::string &msg, Checksum *sum) {
+    const size_t first = msg.find(';');
+    const size_t second = msg.find(';', first + 1);
+    const size_t third = msg.find(';', second + 1);
+    const size_t fourth = msg.find(';', third + 1);
+    const int count = atoi(msg.substr(third + 1, fourth - third - 1).c_str());
+    std::string data = msg.substr(fourth + 1);
+
+    for (int i = 0; i < count; i++) {
+        std::string info;
+        const size_t semi = data.find(';');
+        if (semi != std::string::npos) {
+            info = data.substr(0, semi);
+            data = data.substr(semi + 1);
+        } else {
+            info = data;
+        }
+        int x, y;
+        unsigned short color;
+        sscanf(info.c_str(), "%d,%d,%hx", &x, &y, &color);
+        sum->add(x, y, color);
+    }
+}
+
+// handle_message()'s "chunk;" branch
+static void text_chunk(const std::string &msg, Checksum *sum) {
+    const char *end = msg.data() + msg.size();
+    const char *p = pixel_text_skip_fields(msg.data(), end, 3);
+    int count;
+    if (!p || !(p = pixel_text_parse_int(p, end, &count)) || p >= end || *p != ';') return;
+    p++;
+
+    int x, y;
+    uint16_t color;
+    while (count > 0 && p < end) {
+        p = pixel_text_parse_record(p, end, &x, &y, &color);
+        if (!p) return;
+        sum->add(x, y, color);
+        count--;
+    }
+}
+
+// queue_binary_frame(), less the queueing
+static void binary_records(const std::vector<uint8_t> &buf, Checksum *sum) {
+    PixelFrame frame;
+    if (!pixel_frame_parse(buf.data(), buf.size(), &frame)) return;
+    for (uint16_t i = 0; i < frame.count; i++) {
+        const PixelRecord pixel = pixel_frame_record(frame, i);
+        sum->add(pixel.x, pixel.y, pixel.color);
+    }
+}
+
+// The "full," branch as it was: a substring per color into a canvas array
+static void legacy_full(const std::string &msg, Checksum *sum) {
+    uint16_t colors[PIXEL_KEYFRAME_COLORS];
+    std::string data = msg.substr(5);
+    for (int i = 0; i < PIXEL_KEYFRAME_COLORS; i++) {
+        std::string hex;
+        const size_t comma = data.find(',');
+        if (comma != std::string::npos) {
+            hex = data.substr(0, comma);
+            data = data.substr(comma + 1);
+        } else {
+            hex = data;
+        }
+        colors[i] = (uint16_t)strtol(hex.c_str(), NULL, 16);
+    }
+    for (int i = 0; i < PIXEL_KEYFRAME_COLORS; i++) {
+        sum->add(i % PIXEL_CANVAS_SIZE, i / PIXEL_CANVAS_SIZE, colors[i]);
+    }
+}
+
+// draw_full_frame(): one row at a time
+static void text_full(const std::string &msg, Checksum *sum) {
+    uint16_t row[PIXEL_CANVAS_SIZE];
+    const char *p = msg.data() + 5;
+    const char *end = msg.data() + msg.size();
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        p = pixel_text_decode_row(p, end, row, PIXEL_CANVAS_SIZE);
+        if (!p) return;
+        for (int x = 0; x < PIXEL_CANVAS_SIZE; x++) sum->add(x, y, row[x]);
+    }
+}
+
+// draw_keyframe()
+static void binary_keyframe(const std::vector<uint8_t> &buf, Checksum *sum) {
+    PixelFrame frame;
+    if (!pixel_frame_parse(buf.data(), buf.size(), &frame)) return;
+    for (int i = 0; i < PIXEL_KEYFRAME_COLORS; i++) {
+        sum->add(i % PIXEL_CANVAS_SIZE, i / PIXEL_CANVAS_SIZE, pixel_frame_color(frame, (uint16_t)i));
+    }
+}
+
+// Decodes the message until seconds have passed and prints the rate
+template <typename Decode>
+static Checksum bench(const char *name, double seconds, Decode decode) {
+    Checksum once;
+    const long before = allocations;
+    decode(&once);
+    const long per_message = allocations - before;
+
+    Checksum sum;
+    long messages = 0;
+    const auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < seconds) {
+        for (int i = 0; i < 64; i++) decode(&sum);
+        messages += 64;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    printf("%-16s %8.2f Mpx/s  %9.2f us/message  %5ld allocations/message\n", name,
+           sum.pixels / elapsed / 1e6, elapsed * 1e6 / messages, per_message);
+    return once;
+}
+
+static bool same(const char *name, const Checksum &a, const Checksum &b) {
+    if (a.value == b.value && a.pixels == b.pixels) return true;
+    printf("%s decoded different pixels: %ld, expected %ld\n", name, a.pixels, b.pixels);
+    return false;
+}
+
+int main(int argc, char **argv) {
+    int records = 256;
+    double seconds = 0.5;
+    const bool parsed = parse_options(argc, argv, [&](const char *name, const char *value) {
+        if (!strcmp(name, "--records")) {
+            records = atoi(value);
+        } else if (!strcmp(name, "--seconds")) {
+            seconds = atof(value);
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (!parsed || records <= 0 || records > 0xFFFF || seconds <= 0) {
+        fprintf(stderr, "usage: %s [--records N] [--seconds S]\n", argv[0]);
+        return 1;
+    }
+
+    bool ok = true;
+    const Message chunk = make_records(records, 12345);
+    printf("%d records: %zu text bytes, %zu binary bytes\n", records, chunk.text.size(), chunk.binary.size());
+    const Checksum legacy = bench("legacy chunk", seconds, [&](Checksum *s) { legacy_chunk(chunk.text, s); });
+    ok &= same("text chunk", bench("text chunk", seconds, [&](Checksum *s) { text_chunk(chunk.text, s); }), legacy);
+    ok &= same("binary", bench("binary", seconds, [&](Checksum *s) { binary_records(chunk.binary, s); }), legacy);
+
+    const Message full = make_full_frame(678);
+    printf("full frame: %zu text bytes, %zu binary bytes\n", full.text.size(), full.binary.size());
+    const Checksum legacy_frame = bench("legacy full,", seconds, [&](Checksum *s) { legacy_full(full.text, s); });
+    ok &= same("full,", bench("full, rows", seconds, [&](Checksum *s) { text_full(full.text, s); }), legacy_frame);
+    ok &= same("keyframe", bench("keyframe", seconds, [&](Checksum *s) { binary_keyframe(full.binary, s); }),
+               legacy_frame);
+
+    return ok ? 0 : 1;
+}
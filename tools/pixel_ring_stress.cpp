@@ -0,0 +1,111 @@
+// Stress test for the single-producer single-consumer PixelRing: a producer
+// and a consumer thread run flat out with random batch sizes, and every
+// record must come out once and in order.
+//
+//   g++ -O2 -pthread -o pixel_ring_stress tools/pixel_ring_stress.cpp
+//   pixel_ring_stress [--records N] [--seed N]
+//
+// Build with -fsanitize=thread as well to have ThreadSanitizer check the
+// memory ordering. Records carry a running count in place of a pixel, so a
+// lost, repeated or torn record shows up as a break in the count. Exits
+// non-zero on the first one and prints the throughput otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "../pixel_ring.h"
+#include "tool_common.h"
+
+static PixelRing ring;
+
+// n spread over every field, so a record written halfway is caught too
+static PixelRecord encode(uint32_t n) {
+    PixelRecord pixel = {(uint8_t)n, (uint8_t)(n >> 8), (uint16_t)(n >> 16)};
+    return pixel;
+}
+
+static uint32_t decode(PixelRecord pixel) {
+    return (uint32_t)pixel.x | (uint32_t)pixel.y << 8 | (uint32_t)pixel.color << 16;
+}
+
+// Stages batches of up to a ring's worth and publishes each at once, the way
+// the network task publishes a message. Spins while the ring is full.
+static void produce(uint32_t total, uint32_t seed, long *full) {
+    uint32_t pending = 0;
+    uint32_t n = 0;
+    while (n < total) {
+        uint32_t batch = 1 + next_random(&seed) % PIXEL_RING_SIZE;
+        if (batch > total - n) batch = total - n;
+
+        for (uint32_t i = 0; i < batch; i++) {
+            while (!pixel_ring_stage(&ring, &pending, encode(n))) {
+                pixel_ring_publish(&ring, pending);  // What fit, so the consumer can free room
+                (*full)++;
+                std::this_thread::yield();
+            }
+            n++;
+        }
+        pixel_ring_publish(&ring, pending);
+    }
+}
+
+static bool consume(uint32_t total, uint32_t seed) {
+    static PixelRecord batch[PIXEL_RING_SIZE];
+    uint32_t expected = 0;
+    while (expected < total) {
+        const uint32_t max = 1 + next_random(&seed) % PIXEL_RING_SIZE;
+        const uint32_t count = pixel_ring_consume(&ring, batch, max);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            const uint32_t n = decode(batch[i]);
+            if (n != expected) {
+                printf("record %u: got %u\n", expected, n);
+                return false;
+            }
+            expected++;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t total = 200000000;
+    uint32_t seed = 1;
+    const bool parsed = parse_options(argc, argv, [&](const char *name, const char *value) {
+        if (!strcmp(name, "--records")) {
+            total = (uint32_t)atol(value);
+        } else if (!strcmp(name, "--seed")) {
+            seed = (uint32_t)atol(value) | 1;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (!parsed || total == 0) {
+        fprintf(stderr, "usage: %s [--records N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+
+    pixel_ring_reset(&ring);
+    long full = 0;
+    bool ok = false;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer(produce, total, seed, &full);
+    std::thread consumer([&]() { ok = consume(total, seed * 2654435761u | 1); });
+    producer.join();
+    consumer.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (ok && pixel_ring_used(&ring) != 0) {
+        printf("%u records left in the ring\n", pixel_ring_used(&ring));
+        ok = false;
+    }
+    printf("%u records in %.2f s, %.1f M/s, ring full %ld times: %s\n", total, seconds, total / seconds / 1e6,
+           full, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// Property checks for the Pong physics in pong_physics.h and the AI's
+// intercept solver in pong_ai.h, with a timing of each.
+//
+//   g++ -O2 -o pong_check tools/pong_check.cpp
+//   pong_check [--balls N] [--max-speed PX] [--seed N]
+//
+// Each ball starts between the paddle faces with a random velocity, up to
+// --max-speed pixels a step horizontally, far past PONG_MAX_SPEED_X, and is
+// stepped until it reaches the face it is heading for. Where it should
+// cross the face is worked out in double precision. If the paddle overlaps
+// the ball there by a pixel or more the ball must bounce off it, if it is a
+// pixel or more clear the ball must pass, and the ball must never leave the
+// walls. Every hit is also checked against pong_predict_intercept(). Exits
+// non-zero on the first failure.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "../pong_ai.h"
+#include "tool_common.h"
+
+const int MAX_STEPS = 100000;             // a ball still going after this is stuck
+const double PREDICTION_TOLERANCE = 1.0;  // pixels between the predicted and the actual hit
+const int TIMED_BALLS = 1000;
+const int TIMED_STEPS = 2000;             // per timed ball
+
+struct Results {
+    long hits = 0;
+    long misses = 0;
+    long grazes = 0;  // within a pixel of the paddle's end, either outcome is right
+    long steps = 0;
+    double max_prediction_error = 0;
+};
+
+// Uniform in [lo, hi)
+static double random_range(uint32_t *seed, double lo, double hi) {
+    return lo + (hi - lo) * (next_random(seed) / 4294967296.0);
+}
+
+static double to_double(fix16 v) { return (double)v / FIX16_ONE; }
+
+static fix16 to_fix16(double v) { return (fix16)lround(v * FIX16_ONE); }
+
+// The walls' reflection, in pixels
+static double fold(double y, double lo, double hi) {
+    const double span = hi - lo;
+    double m = fmod(y - lo, 2 * span);
+    if (m < 0) m += 2 * span;
+    return lo + (m > span ? 2 * span - m : m);
+}
+
+static bool fail(long ball, const char *what, const PongBall &start) {
+    printf("ball %ld: %s (x %.4f y %.4f dx %.4f dy %.4f)\n", ball, what, to_double(start.x), to_double(start.y),
+           to_double(start.dx), to_double(start.dy));
+    return false;
+}
+
+static PongBall random_ball(uint32_t *seed, double max_speed) {
+    // Log-uniform, so slow balls are tried as often as fast ones
+    const double speed = exp(random_range(seed, log(0.05), log(max_speed)));
+    PongBall ball;
+    ball.x = to_fix16(random_range(seed, to_double(PONG_PLAYER_FACE), to_double(PONG_AI_FACE)));
+    ball.y = to_fix16(random_range(seed, to_double(PONG_TOP), to_double(PONG_BOTTOM)));
+    ball.dx = to_fix16(next_random(seed) & 1 ? speed : -speed);
+    ball.dy = to_fix16(random_range(seed, -2 * speed, 2 * speed));
+    if (ball.dx == 0) ball.dx = 1;
+    return ball;
+}
+
+static bool check_ball(long n, uint32_t *seed, double max_speed, Results *results) {
+    const PongBall start = random_ball(seed, max_speed);
+    const bool right = start.dx > 0;
+    const fix16 face = right ? PONG_AI_FACE : PONG_PLAYER_FACE;
+
+    // Where the ball reaches the face
+    const double t = (to_double(face) - to_double(start.x)) / to_double(start.dx);
+    const double cross_y = fold(to_double(start.y) + to_double(start.dy) * t, to_double(PONG_TOP),
+                                to_double(PONG_BOTTOM));
+
+    // Half the time in the ball's way, otherwise anywhere it can go
+    const int lowest = PONG_HEIGHT - PONG_BORDER - PONG_PADDLE_HEIGHT;
+    int paddle_y = PONG_BORDER + next_random(seed) % (lowest - PONG_BORDER + 1);
+    if (next_random(seed) & 1) {
+        paddle_y = (int)floor(cross_y) + PONG_BALL_SIZE / 2 - PONG_PADDLE_HEIGHT / 2;
+        paddle_y = paddle_y < PONG_BORDER ? PONG_BORDER : (paddle_y > lowest ? lowest : paddle_y);
+    }
+    const double overlap = fmin(cross_y + PONG_BALL_SIZE, paddle_y + PONG_PADDLE_HEIGHT) - fmax(cross_y, paddle_y);
+
+    fix16 predicted;
+    if (!pong_predict_intercept(&start, face, &predicted)) return fail(n, "no intercept predicted", start);
+
+    // The paddle behind the ball, level with it; it is only solid on its inner face
+    const int other_y = (int)floor(to_double(start.y)) - PONG_PADDLE_HEIGHT / 2;
+    PongBall ball = start;
+    for (int step = 0; step < MAX_STEPS; step++) {
+        const PongContact contact =
+            right ? pong_physics_step(&ball, other_y, paddle_y) : pong_physics_step(&ball, paddle_y, other_y);
+        results->steps++;
+        if (ball.y < PONG_TOP || ball.y > PONG_BOTTOM) return fail(n, "the ball left the walls", start);
+        if (contact.hits & (right ? PONG_HIT_PLAYER : PONG_HIT_AI)) {
+            return fail(n, "the ball hit the paddle it was moving away from", start);
+        }
+
+        if (contact.hits & (right ? PONG_HIT_AI : PONG_HIT_PLAYER)) {
+            if (overlap <= -1) return fail(n, "the ball hit a paddle it should have missed", start);
+            if ((ball.dx > 0) == right) return fail(n, "the ball kept going after a paddle hit", start);
+
+            const fix16 offset = right ? contact.ai_offset : contact.player_offset;
+            const double hit_y = to_double(offset) + paddle_y - PONG_BALL_SIZE / 2.0;
+            const double error = fabs(hit_y - to_double(predicted));
+            if (error > results->max_prediction_error) results->max_prediction_error = error;
+            if (error > PREDICTION_TOLERANCE) return fail(n, "the prediction is off", start);
+
+            overlap < 1 ? results->grazes++ : results->hits++;
+            return true;
+        }
+
+        if (right ? ball.x > face : ball.x < face) {
+            if (overlap >= 1) return fail(n, "the ball tunnelled through the paddle", start);
+            overlap > -1 ? results->grazes++ : results->misses++;
+            return true;
+        }
+    }
+    return fail(n, "the ball never reached the paddle", start);
+}
+
+static volatile fix16 timing_sink;  // keeps the timed calls from being optimized away
+
+// Times pong_physics_step() over whole rallies and pong_predict_intercept() from each ball
+static void time_calls(uint32_t *seed) {
+    static PongBall balls[TIMED_BALLS];
+    for (int i = 0; i < TIMED_BALLS; i++) balls[i] = random_ball(seed, 5.0);  // PONG_MAX_SPEED_X
+
+    // Paddles that follow the ball, so the rally never ends
+    fix16 sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TIMED_BALLS; i++) {
+        PongBall ball = balls[i];
+        for (int step = 0; step < TIMED_STEPS; step++) {
+            const int paddle_y = fix16_floor(ball.y) + PONG_BALL_SIZE / 2 - PONG_PADDLE_HEIGHT / 2;
+            sink += pong_physics_step(&ball, paddle_y, paddle_y).hits;
+        }
+        sink += ball.x;
+    }
+    const double step_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TIMED_BALLS; i++) {
+        PongBall ball = balls[i];
+        fix16 y;
+        for (int step = 0; step < TIMED_STEPS; step++) {
+            if (pong_predict_intercept(&ball, ball.dx > 0 ? PONG_AI_FACE : PONG_PLAYER_FACE, &y)) sink += y;
+            ball.y += step & 1;  // a different ball each call
+        }
+    }
+    const double predict_ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    const double calls = (double)TIMED_BALLS * TIMED_STEPS;
+    timing_sink = sink;
+    printf("%.1f ns per physics step, %.1f ns per intercept prediction\n", step_ns / calls, predict_ns / calls);
+}
+
+int main(int argc, char **argv) {
+    long balls = 1000000;
+    double max_speed = 64;
+    uint32_t seed = 1;
+    const bool parsed = parse_options(argc, argv, [&](const char *name, const char *value) {
+        if (!strcmp(name, "--balls")) {
+            balls = atol(value);
+        } else if (!strcmp(name, "--max-speed")) {
+            max_speed = atof(value);
+        } else if (!strcmp(name, "--seed")) {
+            seed = (uint32_t)atol(value) | 1;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (!parsed || balls <= 0 || max_speed <= 0.05) {
+        fprintf(stderr, "usage: %s [--balls N] [--max-speed PX] [--seed N]\n", argv[0]);
+        return 1;
+    }
+
+    Results results;
+    for (long n = 0; n < balls; n++) {
+        if (!check_ball(n, &seed, max_speed, &results)) return 1;
+    }
+    printf("%ld balls up to %.1f px/step, %ld steps: %ld hits, %ld misses, %ld grazes: ok\n", balls, max_speed,
+           results.steps, results.hits, results.misses, results.grazes);
+    printf("largest prediction error %.4f px\n", results.max_prediction_error);
+    time_calls(&seed);
+    return 0;
+}
@@ -0,0 +1,242 @@
+// Plays the firmware's Pong AI against a scripted player on every core, to
+// calibrate the difficulty table in pong_step.h from data instead of by feel.
+//
+//   g++ -O2 -pthread -o pong_selfplay tools/pong_selfplay.cpp
+//   pong_selfplay [--games N] [--limit N] [--threads N] [--seed N]
+//                 [--player-reaction STEPS] [--player-noise PIXELS]
+//                 [--player-speed-noise PIXELS]
+//
+// Each game is seeded from --seed and its index, so results don't depend on
+// the thread count. For each difficulty it prints the player's win rate,
+// paddle hits per rally and the ball's horizontal speed at each hit. Rallies
+// abandoned as stalemates are counted with the rest.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../pong_step.h"
+#include "tool_common.h"
+
+const char *const NAMES[PONG_DIFFICULTIES] = {"Easy", "Normal", "Hard", "Impossible"};
+const int MAX_POINT_STEPS = 3000;   // 90 s at 30 ms a step: a stalemate, served again
+const int MAX_STALEMATES = 3;       // per game, then it's abandoned as a draw
+const int RALLY_BUCKETS = 64;       // hits per point, the last bucket is "or more"
+const int SPEED_BUCKETS = 11;       // 0.5 px per step wide, up to PONG_MAX_SPEED_X
+
+struct Options {
+    long games = 100000;
+    int limit = 5;
+    int threads = 0;
+    uint32_t seed = 1;
+    PongAiProfile player = {3, 4, PONG_PADDLE_SPEED};
+    int speed_noise = 3;  // more aim noise per pixel a step of ball speed
+};
+
+struct Stats {
+    long games = 0;
+    long player_wins = 0;
+    long draws = 0;
+    long points = 0;
+    long stalemates = 0;
+    long steps = 0;
+    long rallies[RALLY_BUCKETS] = {};
+    long speeds[SPEED_BUCKETS] = {};
+
+    void add(const Stats &other) {
+        games += other.games;
+        player_wins += other.player_wins;
+        draws += other.draws;
+        points += other.points;
+        stalemates += other.stalemates;
+        steps += other.steps;
+        for (int i = 0; i < RALLY_BUCKETS; i++) rallies[i] += other.rallies[i];
+        for (int i = 0; i < SPEED_BUCKETS; i++) speeds[i] += other.speeds[i];
+    }
+};
+
+static uint32_t game_seed(uint32_t seed, int difficulty, long game) {
+    uint64_t x = ((uint64_t)seed << 40) ^ ((uint64_t)difficulty << 32) ^ (uint64_t)game;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x | 1;
+}
+
+// The scripted player is the AI mirrored: it aims at where the ball will
+// reach its face, re-aiming after a delay and with noise of its own. Like a
+// person, it misjudges fast balls more, so it can be beaten.
+static int scripted_move(PongAi *player, const Options &options, const PongBall *ball, int paddle_y,
+                         uint32_t *seed) {
+    PongAiProfile profile = options.player;
+    const int noise = profile.aim_noise + options.speed_noise * fix16_abs(ball->dx) / FIX16_ONE;
+    profile.aim_noise = (uint8_t)(noise < 255 ? noise : 255);
+
+    PongBall mirrored = *ball;
+    mirrored.x = fix16_from_int(PONG_WIDTH - PONG_BALL_SIZE) - ball->x;
+    mirrored.dx = -ball->dx;
+
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    const int target = pong_ai_step(player, &profile, &mirrored, paddle_y, (int)(*seed >> 1));
+    return target > paddle_y ? 1 : (target < paddle_y ? -1 : 0);
+}
+
+static void play_game(const Options &options, int difficulty, long game, Stats *stats) {
+    const PongRules *rules = &PONG_RULES[difficulty];
+    PongState state;
+    pong_reset(&state, rules, game_seed(options.seed, difficulty, game));
+
+    PongAi player;
+    pong_ai_reset(&player, state.player_y);
+    uint32_t player_seed = game_seed(~options.seed, difficulty, game);
+
+    int hits = 0;
+    int point_steps = 0;
+    int stalemates = 0;
+    while (state.player_score < options.limit && state.ai_score < options.limit) {
+        const int move = scripted_move(&player, options, &state.ball, state.player_y, &player_seed);
+        const uint8_t events = pong_step(&state, rules, move);
+        stats->steps++;
+        point_steps++;
+
+        if (events & (PONG_EVENT_PLAYER_HIT | PONG_EVENT_AI_HIT)) {
+            hits++;
+            const int bucket = fix16_abs(state.ball.dx) / (FIX16_ONE / 2);
+            stats->speeds[bucket < SPEED_BUCKETS ? bucket : SPEED_BUCKETS - 1]++;
+        }
+
+        const bool scored = events & (PONG_EVENT_PLAYER_SCORED | PONG_EVENT_AI_SCORED);
+        if (!scored && point_steps < MAX_POINT_STEPS) continue;
+
+        stats->rallies[hits < RALLY_BUCKETS ? hits : RALLY_BUCKETS - 1]++;
+        if (scored) {
+            stats->points++;
+        } else {
+            stats->stalemates++;
+            if (++stalemates == MAX_STALEMATES) {
+                stats->games++;
+                stats->draws++;
+                return;
+            }
+            pong_serve(&state, rules, pong_random(&state) % 2);
+        }
+        hits = 0;
+        point_steps = 0;
+    }
+
+    stats->games++;
+    if (state.player_score >= options.limit) stats->player_wins++;
+}
+
+static int percentile(const long *buckets, int count, double p) {
+    long total = 0;
+    for (int i = 0; i < count; i++) total += buckets[i];
+
+    long seen = 0;
+    for (int i = 0; i < count; i++) {
+        seen += buckets[i];
+        if (seen >= p * total) return i;
+    }
+    return count - 1;
+}
+
+static void print_stats(int difficulty, const Stats &stats) {
+    long hits = 0;
+    long rallies = 0;
+    for (int i = 0; i < RALLY_BUCKETS; i++) {
+        hits += i * stats.rallies[i];
+        rallies += stats.rallies[i];
+    }
+    long speed_total = 0;
+    for (int i = 0; i < SPEED_BUCKETS; i++) speed_total += stats.speeds[i];
+
+    printf("%-10s win %5.1f%%  draw %5.1f%%  games %ld  points %ld  stalemates %ld  steps/point %.0f\n",
+           NAMES[difficulty], 100.0 * stats.player_wins / stats.games, 100.0 * stats.draws / stats.games,
+           stats.games, stats.points, stats.stalemates,
+           stats.points ? (double)stats.steps / stats.points : 0.0);
+    printf("           hits/rally mean %.2f  p50 %d  p90 %d  p99 %d\n",
+           rallies ? (double)hits / rallies : 0.0, percentile(stats.rallies, RALLY_BUCKETS, 0.5),
+           percentile(stats.rallies, RALLY_BUCKETS, 0.9), percentile(stats.rallies, RALLY_BUCKETS, 0.99));
+    printf("           speed at hit:");
+    for (int i = 0; i < SPEED_BUCKETS; i++) {
+        if (stats.speeds[i] == 0) continue;
+        printf("  %.1f %.1f%%", i * 0.5, 100.0 * stats.speeds[i] / speed_total);
+    }
+    printf("\n");
+}
+
+static bool parse_args(int argc, char **argv, Options *options) {
+    const bool parsed = parse_options(argc, argv, [&](const char *name, const char *text) {
+        const long value = atol(text);
+        if (!strcmp(name, "--games")) {
+            options->games = value;
+        } else if (!strcmp(name, "--limit")) {
+            options->limit = (int)value;
+        } else if (!strcmp(name, "--threads")) {
+            options->threads = (int)value;
+        } else if (!strcmp(name, "--seed")) {
+            options->seed = (uint32_t)value;
+        } else if (!strcmp(name, "--player-reaction")) {
+            options->player.reaction_steps = (uint8_t)value;
+        } else if (!strcmp(name, "--player-noise")) {
+            options->player.aim_noise = (uint8_t)value;
+        } else if (!strcmp(name, "--player-speed-noise")) {
+            options->speed_noise = (int)value;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    return parsed && options->games > 0 && options->limit > 0;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse_args(argc, argv, &options)) {
+        fprintf(stderr, "usage: %s [--games N] [--limit N] [--threads N] [--seed N] "
+                        "[--player-reaction STEPS] [--player-noise PIXELS] "
+                        "[--player-speed-noise PIXELS]\n", argv[0]);
+        return 1;
+    }
+    if (options.threads <= 0) options.threads = (int)std::thread::hardware_concurrency();
+    if (options.threads <= 0) options.threads = 1;
+
+    // Workers take games from a shared counter over every difficulty, so
+    // the pool stays busy until the last game however long each one runs
+    const long total = options.games * PONG_DIFFICULTIES;
+    const long CHUNK = 256;
+    std::atomic<long> next(0);
+    std::vector<Stats> results((size_t)options.threads * PONG_DIFFICULTIES);
+    std::vector<std::thread> pool;
+
+    for (int t = 0; t < options.threads; t++) {
+        pool.emplace_back([&, t]() {
+            Stats *mine = &results[(size_t)t * PONG_DIFFICULTIES];
+            while (true) {
+                const long start = next.fetch_add(CHUNK);
+                if (start >= total) break;
+
+                const long end = start + CHUNK < total ? start + CHUNK : total;
+                for (long i = start; i < end; i++) {
+                    const int difficulty = (int)(i / options.games);
+                    play_game(options, difficulty, i % options.games, &mine[difficulty]);
+                }
+            }
+        });
+    }
+    for (std::thread &worker : pool) worker.join();
+
+    printf("%ld games per difficulty to %d, %d threads, player reaction %d noise %d+%d per px/step\n",
+           options.games, options.limit, options.threads, options.player.reaction_steps,
+           options.player.aim_noise, options.speed_noise);
+    for (int d = 0; d < PONG_DIFFICULTIES; d++) {
+        Stats stats;
+        for (int t = 0; t < options.threads; t++) stats.add(results[(size_t)t * PONG_DIFFICULTIES + d]);
+        print_stats(d, stats);
+    }
+    return 0;
+}
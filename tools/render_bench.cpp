@@ -0,0 +1,257 @@
+// Runs the renderer's commands and the Live Pixel canvas flush through a
+// FramebufferDisplay, checks what lands in the framebuffer and prints what
+// each frame would cost on the ST7735's bus.
+//
+//   g++ -O2 -o render_bench tools/render_bench.cpp display_framebuffer.cpp
+//   render_bench
+//
+// Commands go through the firmware's queue and render_execute(), drained in
+// one transaction per frame like the render task does. Exits non-zero if a
+// frame doesn't draw what it should.
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "../display_framebuffer.h"
+#include "../render_queue.h"
+#include "../canvas_flush.h"
+
+const int WIDTH = 128;   // SCREEN_WIDTH
+const int HEIGHT = 160;  // SCREEN_HEIGHT
+const int RUNS = 200;    // timed repetitions of each frame
+
+static RenderQueue queue;
+static RenderTarget target;
+static int failures = 0;
+
+// The render task's loop, run in place
+static void drain() {
+    DrawCommand cmd;
+    target.display->begin_write();
+    while (render_queue_pop(&queue, &cmd)) {
+        render_execute(&target, cmd);
+    }
+    target.display->end_write();
+}
+
+// submit() without the task: a full queue is drained instead of waited on
+static void submit(const DrawCommand &cmd) {
+    while (!render_queue_push(&queue, cmd)) {
+        drain();
+    }
+}
+
+static void submit_rect(int x, int y, int w, int h, uint16_t color) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_RECT;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.w = w;
+    cmd.h = h;
+    cmd.color = color;
+    submit(cmd);
+}
+
+static void expect_pixel(const FramebufferDisplay &display, const char *frame, int x, int y, uint16_t expected) {
+    const uint16_t actual = display.pixel(x, y);
+    if (actual != expected) {
+        printf("%s: pixel %d,%d is 0x%04x, expected 0x%04x\n", frame, x, y, actual, expected);
+        failures++;
+    }
+}
+
+// Draws one frame, RUNS times, and reports the last one's bus cost
+template <typename Frame>
+static void bench(FramebufferDisplay &display, const char *name, Frame frame) {
+    double host_us = 0;
+    for (int run = 0; run < RUNS; run++) {
+        display.reset_counters();
+        const auto start = std::chrono::steady_clock::now();
+        frame();
+        drain();
+        host_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const DisplayCounters &c = display.get_counters();
+    printf("%-22s windows %5u  pixels %6llu  bytes %6llu  spi %6.2f ms  host %7.1f us\n", name, c.windows,
+           (unsigned long long)c.pixels, (unsigned long long)c.spi_bytes, display.spi_seconds() * 1000,
+           host_us / RUNS);
+}
+
+// Live Pixel: a canvas and the pixels marked dirty since the last flush
+struct CanvasFrame {
+    uint16_t canvas[PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE];
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+    CanvasFlush scratch;
+};
+
+static void set_canvas(CanvasFrame *frame, int x, int y, uint16_t color) {
+    frame->canvas[y * PIXEL_CANVAS_SIZE + x] = color;
+    frame->dirty[y] |= 1UL << x;
+}
+
+// What flush_canvas() does on the render task, less the locking
+static void flush_call(void *arg) {
+    CanvasFrame *frame = (CanvasFrame *)arg;
+    canvas_flush(&frame->scratch, target.display, frame->canvas, frame->dirty);
+}
+
+static void submit_flush(CanvasFrame *frame) {
+    DrawCommand cmd = {};
+    cmd.op = DRAW_CALL;
+    cmd.fn = flush_call;
+    cmd.arg = frame;
+    submit(cmd);
+}
+
+static void check_canvas(const FramebufferDisplay &display, const char *name, const CanvasFrame &frame) {
+    for (int y = 0; y < PIXEL_CANVAS_SIZE * CANVAS_PIXEL_SIZE; y++) {
+        for (int x = 0; x < PIXEL_CANVAS_SIZE * CANVAS_PIXEL_SIZE; x++) {
+            const uint16_t expected = frame.canvas[(y / CANVAS_PIXEL_SIZE) * PIXEL_CANVAS_SIZE + x / CANVAS_PIXEL_SIZE];
+            if (display.pixel(x, y) != expected) {
+                expect_pixel(display, name, x, y, expected);
+                return;
+            }
+        }
+    }
+}
+
+static void bench_canvas(FramebufferDisplay &display, const char *name, CanvasFrame *frame) {
+    const int blits = canvas_count_blit_rects(frame->canvas, frame->dirty);
+    const int fills = canvas_collect_fill_rects(frame->canvas, frame->dirty, frame->scratch.fill_rects,
+                                                blits < CANVAS_MAX_FILL_RECTS ? blits : CANVAS_MAX_FILL_RECTS);
+    bench(display, name, [&]() { submit_flush(frame); });
+    check_canvas(display, name, *frame);
+    if (fills >= 0) {
+        printf("%-22s %d fill rects, %d blit rects: filled\n", "", fills, blits);
+    } else {
+        printf("%-22s over %d fill rects, %d blit rects: blitted\n", "", blits, blits);
+    }
+}
+
+static void canvas_frames(FramebufferDisplay &display) {
+    static CanvasFrame frame;
+    uint32_t seed = 1;
+    auto random = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+
+    // The canvas starts out white, as reset_screen() leaves it
+    for (int i = 0; i < PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE; i++) {
+        set_canvas(&frame, i % PIXEL_CANVAS_SIZE, i / PIXEL_CANVAS_SIZE, 0xFFFF);
+    }
+    bench_canvas(display, "canvas clear", &frame);
+
+    memset(frame.dirty, 0, sizeof(frame.dirty));
+    for (int y = 10; y < 15; y++) {
+        for (int x = 10; x < 15; x++) set_canvas(&frame, x, y, 0xF800);
+    }
+    bench_canvas(display, "canvas brush stamp", &frame);
+
+    memset(frame.dirty, 0, sizeof(frame.dirty));
+    for (int x = 2; x < 30; x++) {
+        for (int y = 16; y < 18; y++) set_canvas(&frame, x, y + (x / 4) % 3, 0x001F);
+    }
+    bench_canvas(display, "canvas stroke", &frame);
+
+    memset(frame.dirty, 0, sizeof(frame.dirty));
+    for (int i = 0; i < 200; i++) {
+        set_canvas(&frame, random() % PIXEL_CANVAS_SIZE, random() % PIXEL_CANVAS_SIZE, (uint16_t)random());
+    }
+    bench_canvas(display, "canvas 200 scattered", &frame);
+
+    memset(frame.dirty, 0, sizeof(frame.dirty));
+    for (int i = 0; i < PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE; i++) {
+        set_canvas(&frame, i % PIXEL_CANVAS_SIZE, i / PIXEL_CANVAS_SIZE, (uint16_t)random());
+    }
+    bench_canvas(display, "canvas keyframe", &frame);
+}
+
+// Pong in direct mode: the moving objects erased and redrawn with rectangles
+static void pong_direct_frame(FramebufferDisplay &display) {
+    const int paddle_w = 4, paddle_h = 20, ball = 4;
+    bench(display, "pong direct", [&]() {
+        submit_rect(4, 60, paddle_w, paddle_h, 0x0000);
+        submit_rect(120, 70, paddle_w, paddle_h, 0x0000);
+        submit_rect(60, 80, ball, ball, 0x0000);
+        submit_rect(4, 62, paddle_w, paddle_h, 0xFFFF);
+        submit_rect(120, 68, paddle_w, paddle_h, 0xFFFF);
+        submit_rect(63, 82, ball, ball, 0xFFFF);
+    });
+    expect_pixel(display, "pong direct", 5, 62, 0xFFFF);
+    expect_pixel(display, "pong direct", 5, 61, 0x0000);
+    expect_pixel(display, "pong direct", 63, 82, 0xFFFF);
+}
+
+// Pong in sprite mode: the whole playfield as five 128x32 bands sent with DMA
+static void pong_sprite_frame(FramebufferDisplay &display) {
+    const int band_h = 32;
+    std::vector<uint16_t> bands[2] = {std::vector<uint16_t>(WIDTH * band_h, 0),
+                                      std::vector<uint16_t>(WIDTH * band_h, 0)};
+    bands[1][5 * WIDTH + 7] = 0xE007;  // green in display byte order
+
+    bench(display, "pong sprite bands", [&]() {
+        for (int i = 0; i < HEIGHT / band_h; i++) {
+            DrawCommand cmd = {};
+            cmd.op = DRAW_BLIT_DMA;
+            cmd.y = i * band_h;
+            cmd.w = WIDTH;
+            cmd.h = band_h;
+            cmd.dma_pixels = bands[i & 1].data();
+            submit(cmd);
+
+            cmd = DrawCommand();
+            cmd.op = DRAW_FENCE;
+            submit(cmd);
+        }
+    });
+    expect_pixel(display, "pong sprite bands", 7, band_h + 5, 0x07E0);
+    expect_pixel(display, "pong sprite bands", 7, 5, 0x0000);
+}
+
+// One step of the menu transition: a window of the 8-bit menu strip
+static void menu_strip_frame(FramebufferDisplay &display) {
+    const int strip_w = WIDTH * 5, strip_h = 80, strip_y = 40, sx = 37;
+    std::vector<uint8_t> strip(strip_w * strip_h, 0);
+    strip[3 * strip_w + sx + 2] = 0xFF;
+    strip[4 * strip_w + sx + 2] = 0xE0;
+
+    bench(display, "menu strip step", [&]() {
+        DrawCommand cmd = {};
+        cmd.op = DRAW_SPRITE;
+        cmd.y = strip_y;
+        cmd.w = WIDTH;
+        cmd.h = strip_h;
+        cmd.sprite_pixels = strip.data();
+        cmd.sx = sx;
+        cmd.stride = strip_w;
+        cmd.depth = 8;
+        submit(cmd);
+    });
+    expect_pixel(display, "menu strip step", 2, strip_y + 3, color332_to_565(0xFF));
+    expect_pixel(display, "menu strip step", 2, strip_y + 4, color332_to_565(0xE0));
+    expect_pixel(display, "menu strip step", 2, strip_y + 5, 0x0000);
+}
+
+int main() {
+    FramebufferDisplay display(WIDTH, HEIGHT);
+    render_queue_reset(&queue);
+    render_target_init(&target, &display, WIDTH, HEIGHT);
+
+    bench(display, "clear", []() {
+        DrawCommand cmd = {};
+        cmd.op = DRAW_CLEAR;
+        submit(cmd);
+    });
+    canvas_frames(display);
+    pong_direct_frame(display);
+    pong_sprite_frame(display);
+    menu_strip_frame(display);
+
+    printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+// Checks SnakeBody against a plain std::deque over long runs, up to a full
+// board, times a move, and checks food placement as the board fills up.
+//
+//   g++ -O2 -o snake_check tools/snake_check.cpp
+//   snake_check [--games N] [--seed N]
+//
+// The snake follows a Hamiltonian cycle of the board so it can always fill
+// it, growing at a random interval each game. Now and then it also tries to
+// move into its own body, which must fail and leave the body unchanged.
+// Exits non-zero on the first difference from the reference.
+//
+// Food is placed the way place_food() does it, at fills up to 99%: it must
+// never land on the snake, must be uniform over the free cells (chi-square)
+// and must take the same time however full the board is. Picking random cells
+// until one is free, the obvious alternative, is timed alongside.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "../snake_body.h"
+#include "tool_common.h"
+
+static SnakeBody body;
+static int cycle_next[SNAKE_CELLS];  // the cell after each one on the cycle
+
+static SnakeCell cell_at(int i) {
+    SnakeCell cell = {(uint8_t)(i % SNAKE_COLS), (uint8_t)(i / SNAKE_COLS)};
+    return cell;
+}
+
+// Along row 0, then back and forth over columns 1.. of the other rows, and
+// up column 0. Needs an even number of rows.
+static void build_cycle() {
+    static_assert(SNAKE_ROWS % 2 == 0, "the cycle needs an even number of rows");
+    std::vector<int> order;
+    for (int x = 0; x < SNAKE_COLS; x++) order.push_back(x);
+    for (int y = 1; y < SNAKE_ROWS; y++) {
+        for (int i = 1; i < SNAKE_COLS; i++) {
+            const int x = y % 2 ? SNAKE_COLS - i : i;
+            order.push_back(y * SNAKE_COLS + x);
+        }
+    }
+    for (int y = SNAKE_ROWS - 1; y >= 1; y--) order.push_back(y * SNAKE_COLS);
+
+    for (size_t i = 0; i < order.size(); i++) cycle_next[order[i]] = order[(i + 1) % order.size()];
+}
+
+struct Reference {
+    std::deque<int> cells;  // front is the head
+    std::vector<bool> occupied = std::vector<bool>(SNAKE_CELLS, false);
+};
+
+static bool fail(long move, const char *what) {
+    printf("move %ld: %s\n", move, what);
+    return false;
+}
+
+static bool matches(long move, const Reference &ref, bool full_check) {
+    if (body.length != ref.cells.size()) return fail(move, "length differs");
+    if (snake_cell_index(snake_body_head(&body)) != ref.cells.front()) return fail(move, "head differs");
+    if (snake_cell_index(snake_body_tail(&body)) != ref.cells.back()) return fail(move, "tail differs");
+    if (snake_body_free_count(&body) != SNAKE_CELLS - (int)ref.cells.size()) return fail(move, "free count differs");
+    if (!full_check) return true;
+
+    for (int i = 0; i < SNAKE_CELLS; i++) {
+        if (snake_body_occupied(&body, cell_at(i)) != ref.occupied[i]) return fail(move, "occupancy differs");
+    }
+    for (int slot = 0; slot < SNAKE_CELLS; slot++) {
+        const int i = body.free_cells[slot];
+        if (body.free_slot[i] != slot) return fail(move, "free cell permutation is broken");
+        if (ref.occupied[i] != (slot >= body.free_count)) return fail(move, "free cells out of place");
+    }
+    return true;
+}
+
+// One game from an empty board to a full one. Returns false on a mismatch.
+static bool play(uint32_t *seed, long *moves) {
+    Reference ref;
+    const int start = 0;
+    snake_body_reset(&body, cell_at(start));
+    ref.cells.push_front(start);
+    ref.occupied[start] = true;
+
+    const int grow_every = 1 + next_random(seed) % 8;
+    long step = 0;
+    while (true) {
+        const int next = cycle_next[ref.cells.front()];
+        const bool full = (int)ref.cells.size() == SNAKE_CELLS;
+        const bool grow = !full && step % grow_every == 0;
+        step++;
+
+        // Into the body, anywhere but the tail the move would free
+        if (ref.cells.size() > 2 && next_random(seed) % 16 == 0) {
+            const int target = ref.cells[1 + next_random(seed) % (ref.cells.size() - 2)];
+            SnakeCell vacated;
+            if (snake_body_advance(&body, cell_at(target), false, &vacated)) {
+                return fail(*moves, "moved into the body");
+            }
+            if (!matches(*moves, ref, true)) return false;
+        }
+
+        SnakeCell vacated = {0, 0};
+        const bool moved = snake_body_advance(&body, cell_at(next), grow, &vacated);
+        (*moves)++;
+        if (!moved) return fail(*moves, "a move along the cycle collided");
+
+        if (!grow) {
+            if (snake_cell_index(vacated) != ref.cells.back()) return fail(*moves, "vacated the wrong cell");
+            ref.occupied[ref.cells.back()] = false;
+            ref.cells.pop_back();
+        }
+        ref.cells.push_front(next);
+        ref.occupied[next] = true;
+        if (!matches(*moves, ref, *moves % 997 == 0)) return false;
+
+        // Once full, go round once more chasing the tail, then growing must collide
+        if (full && step % SNAKE_CELLS == 0) {
+            SnakeCell unused;
+            if (snake_body_advance(&body, cell_at(cycle_next[ref.cells.front()]), true, &unused)) {
+                return fail(*moves, "grew past a full board");
+            }
+            return matches(*moves, ref, true);
+        }
+    }
+}
+
+// Moves a half-board snake round the cycle, without the reference
+static double move_ns(long moves) {
+    snake_body_reset(&body, cell_at(0));
+    int head = 0;
+    SnakeCell vacated;
+    for (int i = 1; i < SNAKE_CELLS / 2; i++) {
+        head = cycle_next[head];
+        snake_body_advance(&body, cell_at(head), true, &vacated);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < moves; i++) {
+        head = cycle_next[head];
+        if (!snake_body_advance(&body, cell_at(head), false, &vacated)) return -1;
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / moves;
+}
+
+const int FILL_PERCENTS[] = {0, 50, 90, 95, 99};
+const int PLACEMENTS_PER_CELL = 200;  // expected hits per free cell in the uniformity check
+const long TIMED_PLACEMENTS = 2000000;
+
+// Grows a snake along the cycle to percent of the board
+static void fill_to(int percent) {
+    snake_body_reset(&body, cell_at(0));
+    int head = 0;
+    SnakeCell vacated;
+    const int length = percent ? SNAKE_CELLS * percent / 100 : 1;
+    for (int i = 1; i < length; i++) {
+        head = cycle_next[head];
+        snake_body_advance(&body, cell_at(head), true, &vacated);
+    }
+}
+
+static bool check_food(uint32_t *seed) {
+    std::vector<long> hits(SNAKE_CELLS);
+    for (int percent : FILL_PERCENTS) {
+        fill_to(percent);
+        const int free_count = snake_body_free_count(&body);
+        const long placements = (long)free_count * PLACEMENTS_PER_CELL;
+
+        std::fill(hits.begin(), hits.end(), 0);
+        for (long i = 0; i < placements; i++) {
+            hits[snake_cell_index(snake_body_free_cell(&body, next_random(seed) % free_count))]++;
+        }
+
+        int sink = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < TIMED_PLACEMENTS; i++) {
+            sink += snake_cell_index(snake_body_free_cell(&body, next_random(seed) % free_count));
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (sink < 0) return false;
+
+        // Retrying random cells, for comparison
+        long tries = 0;
+        const auto retry_start = std::chrono::steady_clock::now();
+        for (long i = 0; i < TIMED_PLACEMENTS; i++) {
+            do {
+                tries++;
+            } while (snake_body_occupied(&body, cell_at(next_random(seed) % SNAKE_CELLS)));
+        }
+        const double retry_ns =
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - retry_start).count();
+
+        double chi_square = 0;
+        for (int i = 0; i < SNAKE_CELLS; i++) {
+            if (snake_body_occupied(&body, cell_at(i))) {
+                if (hits[i]) return fail(i, "food placed on the snake");
+                continue;
+            }
+            const double d = hits[i] - PLACEMENTS_PER_CELL;
+            chi_square += d * d / PLACEMENTS_PER_CELL;
+        }
+        // Mean k-1, standard deviation sqrt(2(k-1)); six deviations out is a bias, not chance
+        const double dof = free_count - 1;
+        const bool uniform = free_count == 1 || chi_square < dof + 6 * sqrt(2 * dof);
+        printf("fill %2d%%  %4d free cells  chi-square %7.1f (dof %4.0f)  %5.1f ns/placement  "
+               "retrying %7.1f ns, %6.1f tries\n",
+               percent, free_count, chi_square, dof, ns / TIMED_PLACEMENTS, retry_ns / TIMED_PLACEMENTS,
+               (double)tries / TIMED_PLACEMENTS);
+        if (!uniform) return fail(percent, "food placement isn't uniform");
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int games = 200;
+    uint32_t seed = 1;
+    const bool parsed = parse_options(argc, argv, [&](const char *name, const char *value) {
+        if (!strcmp(name, "--games")) {
+            games = atoi(value);
+        } else if (!strcmp(name, "--seed")) {
+            seed = (uint32_t)atol(value) | 1;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (!parsed || games <= 0) {
+        fprintf(stderr, "usage: %s [--games N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+
+    build_cycle();
+    long moves = 0;
+    for (int game = 0; game < games; game++) {
+        if (!play(&seed, &moves)) return 1;
+    }
+    printf("%d games to a full board, %ld moves: ok\n", games, moves);
+    printf("%.1f ns per move at length %d\n", move_ns(10000000), SNAKE_CELLS / 2);
+    return check_food(&seed) ? 0 : 1;
+}
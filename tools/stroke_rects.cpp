@@ -0,0 +1,187 @@
+// Replays generated brush strokes on the Live Pixel canvas and compares what
+// each flush costs with the rectangle merging in canvas_flush.h against the
+// flush it replaced: one fill_rect per run of same-color dirty pixels on a
+// row, drawn in row order.
+//
+//   g++ -O2 -o stroke_rects tools/stroke_rects.cpp display_framebuffer.cpp
+//   stroke_rects [--strokes N] [--stamps-per-frame N] [--seed N]
+//
+// A stroke is a random walk of square brush stamps in one color. Stamps are
+// grouped into flushes the way they arrive between two canvas frames. For
+// each brush size it prints how often canvas_flush() could use fill_rect, the
+// fill_rect calls, address windows and bus bytes per flush both ways, and
+// exits non-zero if the screens end up different.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../display_framebuffer.h"
+#include "../canvas_flush.h"
+#include "tool_common.h"
+
+const int WIDTH = PIXEL_CANVAS_SIZE * CANVAS_PIXEL_SIZE;
+const int BRUSH_SIZES[] = {1, 2, 3, 5};
+
+struct Options {
+    int strokes = 200;
+    int stamps_per_frame = 4;
+    uint32_t seed = 1;
+};
+
+struct Totals {
+    long flushes = 0;
+    long fill_flushes = 0;  // flushes canvas_flush() drew with fill_rect
+    long merged_windows = 0;
+    long row_windows = 0;
+    int merged_max = 0;     // most address windows in one flush
+    int row_max = 0;
+};
+
+// Counts fill_rect calls apart from blits; both set an address window
+class CountingDisplay : public FramebufferDisplay {
+public:
+    CountingDisplay(int width, int height) : FramebufferDisplay(width, height) {}
+
+    void fill_rect(int x, int y, int w, int h, uint16_t color) override {
+        fill_rects++;
+        FramebufferDisplay::fill_rect(x, y, w, h, color);
+    }
+
+    long fill_rects = 0;
+};
+
+struct Canvas {
+    uint16_t pixels[PIXEL_CANVAS_SIZE * PIXEL_CANVAS_SIZE];
+    uint32_t dirty[PIXEL_CANVAS_SIZE];
+};
+
+// canvas_set(): pixels already that color aren't marked dirty
+static void stamp(Canvas *canvas, int cx, int cy, int size, uint16_t color) {
+    for (int y = cy - size / 2; y < cy - size / 2 + size; y++) {
+        for (int x = cx - size / 2; x < cx - size / 2 + size; x++) {
+            if (!pixel_in_canvas(x, y) || canvas->pixels[y * PIXEL_CANVAS_SIZE + x] == color) continue;
+            canvas->pixels[y * PIXEL_CANVAS_SIZE + x] = color;
+            canvas->dirty[y] |= 1UL << x;
+        }
+    }
+}
+
+// The flush canvas_flush() replaced: dirty pixels in row order, one fill_rect
+// per run of adjacent same-color pixels on a row
+static void flush_rows(Display *display, const Canvas &canvas) {
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) {
+        const uint16_t *row = canvas.pixels + y * PIXEL_CANVAS_SIZE;
+        int x = 0;
+        while (x < PIXEL_CANVAS_SIZE) {
+            if (!(canvas.dirty[y] & (1UL << x))) {
+                x++;
+                continue;
+            }
+            int w = 1;
+            while (x + w < PIXEL_CANVAS_SIZE && (canvas.dirty[y] & (1UL << (x + w))) && row[x + w] == row[x]) w++;
+            display->fill_rect(x * CANVAS_PIXEL_SIZE, y * CANVAS_PIXEL_SIZE, w * CANVAS_PIXEL_SIZE, CANVAS_PIXEL_SIZE,
+                               row[x]);
+            x += w;
+        }
+    }
+}
+
+static void flush(Canvas *canvas, CountingDisplay *merged, CountingDisplay *rows, CanvasFlush *scratch,
+                  Totals *totals) {
+    bool any = false;
+    for (int y = 0; y < PIXEL_CANVAS_SIZE; y++) any |= canvas->dirty[y] != 0;
+    if (!any) return;
+
+    const uint32_t merged_before = merged->get_counters().windows;
+    const uint32_t rows_before = rows->get_counters().windows;
+    const int blits = canvas_count_blit_rects(canvas->pixels, canvas->dirty);
+    const int limit = blits < CANVAS_MAX_FILL_RECTS ? blits : CANVAS_MAX_FILL_RECTS;
+    if (canvas_collect_fill_rects(canvas->pixels, canvas->dirty, scratch->fill_rects, limit) >= 0) {
+        totals->fill_flushes++;
+    }
+
+    canvas_flush(scratch, merged, canvas->pixels, canvas->dirty);
+    flush_rows(rows, *canvas);
+    memset(canvas->dirty, 0, sizeof(canvas->dirty));
+
+    const int merged_windows = (int)(merged->get_counters().windows - merged_before);
+    const int row_windows = (int)(rows->get_counters().windows - rows_before);
+    totals->flushes++;
+    totals->merged_windows += merged_windows;
+    totals->row_windows += row_windows;
+    if (merged_windows > totals->merged_max) totals->merged_max = merged_windows;
+    if (row_windows > totals->row_max) totals->row_max = row_windows;
+}
+
+static bool run(const Options &options, int brush) {
+    static Canvas canvas;
+    static CanvasFlush scratch;
+    CountingDisplay merged(WIDTH, WIDTH);
+    CountingDisplay rows(WIDTH, WIDTH);
+    Totals totals;
+    uint32_t seed = options.seed * 7919 + brush;
+
+    memset(&canvas, 0, sizeof(canvas));
+    int stamps = 0;
+    for (int s = 0; s < options.strokes; s++) {
+        const uint16_t color = (uint16_t)next_random(&seed) | 1;  // never the black the canvas starts in
+        int x = next_random(&seed) % PIXEL_CANVAS_SIZE;
+        int y = next_random(&seed) % PIXEL_CANVAS_SIZE;
+        const int length = 5 + next_random(&seed) % 40;
+
+        for (int i = 0; i < length; i++) {
+            stamp(&canvas, x, y, brush, color);
+            x += (int)(next_random(&seed) % 3) - 1;
+            y += (int)(next_random(&seed) % 3) - 1;
+            if (++stamps % options.stamps_per_frame == 0) {
+                flush(&canvas, &merged, &rows, &scratch, &totals);
+            }
+        }
+    }
+    flush(&canvas, &merged, &rows, &scratch, &totals);
+
+    const DisplayCounters &m = merged.get_counters();
+    const DisplayCounters &r = rows.get_counters();
+    const double n = (double)totals.flushes;
+    printf("brush %d  flushes %5ld  fill_rect %5.1f%%  fill_rects/flush %5.2f vs %5.2f  "
+           "windows/flush %5.2f vs %5.2f  max %3d vs %3d  bytes/flush %6.0f vs %6.0f\n",
+           brush, totals.flushes, 100.0 * totals.fill_flushes / n, merged.fill_rects / n, rows.fill_rects / n,
+           totals.merged_windows / n, totals.row_windows / n, totals.merged_max, totals.row_max, m.spi_bytes / n,
+           r.spi_bytes / n);
+
+    for (int y = 0; y < WIDTH; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            if (merged.pixel(x, y) != rows.pixel(x, y)) {
+                printf("brush %d: screens differ at %d,%d\n", brush, x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    const bool parsed = parse_options(argc, argv, [&](const char *name, const char *value) {
+        if (!strcmp(name, "--strokes")) {
+            options.strokes = atoi(value);
+        } else if (!strcmp(name, "--stamps-per-frame")) {
+            options.stamps_per_frame = atoi(value);
+        } else if (!strcmp(name, "--seed")) {
+            options.seed = (uint32_t)atol(value);
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (!parsed || options.strokes <= 0 || options.stamps_per_frame <= 0) {
+        fprintf(stderr, "usage: %s [--strokes N] [--stamps-per-frame N] [--seed N]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d strokes, %d stamps per flush; merged vs one fill_rect per same-color run of a row\n", options.strokes,
+           options.stamps_per_frame);
+    bool ok = true;
+    for (int brush : BRUSH_SIZES) ok &= run(options, brush);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+
+// Pieces shared by the host tools in this folder.
+
+// xorshift32: the same sequence from the same seed on every host. The seed
+// must not be 0, or every number after it is 0 too.
+inline uint32_t next_random(uint32_t *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+// Walks the "--name value" pairs after argv[0], passing each to
+// set(name, value). Returns false if a name has no value or set() returns
+// false for it, which is how a tool rejects an option it doesn't know.
+template <typename Set>
+inline bool parse_options(int argc, char **argv, Set set) {
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc || !set(argv[i], argv[i + 1])) return false;
+    }
+    return true;
+}
@@ -0,0 +1,123 @@
+// Converts a binary trace dump captured from the board's Serial port into
+// Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+//
+//   g++ -O2 -o trace_to_chrome tools/trace_to_chrome.cpp
+//   trace_to_chrome capture.bin > trace.json
+//
+// The capture may contain other Serial output; the dump is found by its magic.
+// Spans become complete events on the core they began on, since unpinned
+// tasks can end a span on the other core.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "../trace_format.h"
+
+struct Timed {
+    TraceEvent event;
+    double time_us;
+};
+
+static bool find_dump(const std::vector<uint8_t> &data, TraceHeader *header, const TraceEvent **events) {
+    const size_t size = sizeof(TraceHeader) + TRACE_CAPACITY * sizeof(TraceEvent);
+    for (size_t i = 0; i + size <= data.size(); i++) {
+        if (memcmp(&data[i], TRACE_MAGIC, 4) != 0) continue;
+
+        memcpy(header, &data[i], sizeof(*header));
+        if (header->version != TRACE_VERSION || header->count > TRACE_CAPACITY || header->cpu_mhz == 0) {
+            continue;
+        }
+        *events = (const TraceEvent *)&data[i + sizeof(TraceHeader)];
+        return true;
+    }
+    return false;
+}
+
+// Walks each core's events back from its anchor, so the 32-bit cycle
+// counter only has to not wrap between two events on the same core
+static std::vector<Timed> timestamp_events(const TraceHeader &header, const TraceEvent *ring) {
+    std::vector<Timed> events(header.count);
+    uint32_t cycles[TRACE_CORES];
+    double time_us[TRACE_CORES];
+    for (int core = 0; core < TRACE_CORES; core++) {
+        cycles[core] = header.anchors[core].cycles;
+        time_us[core] = (double)header.anchors[core].time_us;
+    }
+
+    for (int i = (int)header.count - 1; i >= 0; i--) {
+        const TraceEvent &event = ring[(header.first + i) & (TRACE_CAPACITY - 1)];
+        const int core = event.core < TRACE_CORES ? event.core : 0;
+
+        time_us[core] -= (double)(uint32_t)(cycles[core] - event.cycles) / header.cpu_mhz;
+        cycles[core] = event.cycles;
+        events[i].event = event;
+        events[i].time_us = time_us[core];
+    }
+    return events;
+}
+
+static const char *event_name(uint8_t id) {
+    return id < TRACE_EVENT_COUNT ? TRACE_EVENT_NAMES[id] : "unknown";
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s capture.bin > trace.json\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    TraceHeader header;
+    const TraceEvent *ring;
+    if (!find_dump(data, &header, &ring)) {
+        fprintf(stderr, "%s: no trace dump found\n", argv[1]);
+        return 1;
+    }
+    const std::vector<Timed> events = timestamp_events(header, ring);
+    const double origin = events.empty() ? 0 : events[0].time_us;
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (int core = 0; core < TRACE_CORES; core++) {
+        printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"Core %d\"}},\n",
+               core, core);
+    }
+
+    // The most recent unmatched begin of each event id
+    int open[TRACE_EVENT_COUNT];
+    for (int id = 0; id < TRACE_EVENT_COUNT; id++) open[id] = -1;
+
+    int written = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        const TraceEvent &event = events[i].event;
+        const double ts = events[i].time_us - origin;
+
+        if (event.type == TRACE_TYPE_INSTANT) {
+            printf("%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"arg\":%u}}",
+                   written++ ? ",\n" : "", event_name(event.id), ts, event.core, event.arg);
+        } else if (event.id < TRACE_EVENT_COUNT && event.type == TRACE_TYPE_BEGIN) {
+            open[event.id] = (int)i;
+        } else if (event.id < TRACE_EVENT_COUNT && event.type == TRACE_TYPE_END && open[event.id] >= 0) {
+            const Timed &begin = events[open[event.id]];
+            printf("%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+                   written++ ? ",\n" : "", event_name(event.id), begin.time_us - origin,
+                   events[i].time_us - begin.time_us, begin.event.core);
+            open[event.id] = -1;
+        }
+    }
+    printf("\n]}\n");
+
+    fprintf(stderr, "%u events, %d written\n", header.count, written);
+    return 0;
+}
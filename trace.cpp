@@ -0,0 +1,63 @@
+#include "common.h"
+#include "trace.h"
+
+#if RESPTRO_TRACE
+#include <atomic>
+#include <esp_ipc.h>
+#include <esp_timer.h>
+
+// Header and events are contiguous so a dump is a single Serial write
+struct TraceBuffer {
+    TraceHeader header;
+    TraceEvent events[TRACE_CAPACITY];
+};
+
+static TraceBuffer trace_buffer;
+static std::atomic<uint32_t> trace_next(0);
+static volatile bool trace_paused = false;
+
+void IRAM_ATTR trace_record(uint8_t id, uint8_t type, uint8_t arg) {
+    if (trace_paused) return;
+
+    // Claiming a slot is the only shared write, so ISRs and both cores can record at once
+    const uint32_t index = trace_next.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent &event = trace_buffer.events[index & (TRACE_CAPACITY - 1)];
+    event.cycles = ESP.getCycleCount();
+    event.id = id;
+    event.type = type;
+    event.core = xPortGetCoreID();
+    event.arg = arg;
+}
+
+void sample_anchor(void *arg) {
+    TraceAnchor *anchor = (TraceAnchor *)arg;
+    anchor->cycles = ESP.getCycleCount();
+    anchor->time_us = esp_timer_get_time();
+    anchor->reserved = 0;
+}
+
+void trace_dump() {
+    trace_paused = true;
+    vTaskDelay(1);  // Let records already past the pause check finish
+
+    TraceHeader &header = trace_buffer.header;
+    const uint32_t next = trace_next.load();
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.cpu_mhz = ESP.getCpuFreqMHz();
+    header.count = min(next, (uint32_t)TRACE_CAPACITY);
+    header.first = next > TRACE_CAPACITY ? next & (TRACE_CAPACITY - 1) : 0;
+
+    // Each core's counter has to be read on that core
+    const int core = xPortGetCoreID();
+    sample_anchor(&header.anchors[core]);
+    esp_ipc_call_blocking(!core, sample_anchor, &header.anchors[!core]);
+
+    Serial.write((const uint8_t *)&trace_buffer, sizeof(trace_buffer));
+    Serial.flush();
+
+    trace_next.store(0);
+    trace_paused = false;
+}
+
+#endif
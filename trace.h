@@ -0,0 +1,30 @@
+#pragma once
+#include "trace_format.h"
+
+// Lock-free trace of timestamped events, safe to record from ISRs on either
+// core. Send 'T' over Serial to dump it in binary, then convert the capture
+// with tools/trace_to_chrome. Compiled out unless RESPTRO_TRACE is 1.
+
+#ifndef RESPTRO_TRACE
+#define RESPTRO_TRACE 0
+#endif
+
+#if RESPTRO_TRACE
+
+void trace_record(uint8_t id, uint8_t type, uint8_t arg);
+// Writes the trace to Serial in binary
+void trace_dump();
+
+#define TRACE_BEGIN(id) trace_record(id, TRACE_TYPE_BEGIN, 0)
+#define TRACE_END(id) trace_record(id, TRACE_TYPE_END, 0)
+#define TRACE_INSTANT(id, arg) trace_record(id, TRACE_TYPE_INSTANT, arg)
+
+#else
+
+inline void trace_dump() {}
+
+#define TRACE_BEGIN(id) do {} while (0)
+#define TRACE_END(id) do {} while (0)
+#define TRACE_INSTANT(id, arg) do {} while (0)
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+
+// Layout of a trace dump, shared by the firmware (trace.h) and the host
+// converter (tools/trace_to_chrome.cpp). Only depends on the C++ standard
+// headers so it can be compiled on the host. Both sides are little-endian.
+//
+// A dump is a TraceHeader followed by TRACE_CAPACITY TraceEvents, of which
+// count are valid, oldest first starting at index first and wrapping.
+
+#define TRACE_MAGIC "RTRC"
+#define TRACE_VERSION 1
+#define TRACE_CAPACITY 1024  // power of two
+#define TRACE_CORES 2
+
+enum TraceEventId : uint8_t {
+    TRACE_MENU_BUTTON,   // A pressed, handled by the menu input task
+    TRACE_SNAKE_BUTTON,  // snake turn received, arg is the direction
+    TRACE_WS_MESSAGE,    // on_msg_callback
+    TRACE_CANVAS_FLUSH,  // display_task pushing the canvas
+    TRACE_SNAKE_TICK,
+    TRACE_PONG_TICK,
+    TRACE_INPUT_EDGE,    // button GPIO interrupt, arg is the InputButton
+    TRACE_EVENT_COUNT
+};
+
+static const char *const TRACE_EVENT_NAMES[TRACE_EVENT_COUNT] = {
+    "menu_button", "snake_button", "ws_message", "canvas_flush", "snake_tick", "pong_tick", "input_edge",
+};
+
+enum TraceEventType : uint8_t {
+    TRACE_TYPE_BEGIN,
+    TRACE_TYPE_END,
+    TRACE_TYPE_INSTANT,
+};
+
+struct TraceEvent {
+    uint32_t cycles;  // CCOUNT of the recording core, wraps every ~18 s at 240 MHz
+    uint8_t id;
+    uint8_t type;
+    uint8_t core;
+    uint8_t arg;
+};
+
+// Each core's cycle counter next to the shared microsecond clock, sampled at
+// dump time. Timestamps are recovered by walking back from it.
+struct TraceAnchor {
+    uint64_t time_us;
+    uint32_t cycles;
+    uint32_t reserved;
+};
+
+struct TraceHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t cpu_mhz;
+    uint32_t count;
+    uint32_t first;
+    TraceAnchor anchors[TRACE_CORES];
+};
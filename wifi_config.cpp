@@ -3,7 +3,7 @@
 TaskHandle_t wifi_task_handle = NULL;
 TaskHandle_t input_task_handle = NULL;
 WiFiManager* wifiManager = NULL;
-String wifi_ip = "Not Connected";
+Text<TEXT_IP_MAX> wifi_ip = {"Not Connected", 13};
 bool wifi_initialized = false;
 bool wifi_config_active = false;
 
@@ -14,8 +14,8 @@ char wsPort[6] = "5173";
 
 void saveWsConfigCallback() {
     
-    strncpy(wsServer, wsServerParam->getValue(), sizeof(wsServer));
-    strncpy(wsPort, wsPortParam->getValue(), sizeof(wsPort));
+    text_copy(wsServer, sizeof(wsServer), wsServerParam->getValue());
+    text_copy(wsPort, sizeof(wsPort), wsPortParam->getValue());
     
     
     Preferences preferences;
@@ -31,21 +31,24 @@ void saveWsConfigCallback() {
 void loadWsConfig() {
     Preferences preferences;
     preferences.begin("livepixel", true);
-    String savedServer = preferences.getString("wsServer", "");
-    String savedPort = preferences.getString("wsPort", "");
+    // Read into the fixed buffers, keeping the defaults when nothing was saved
+    char savedServer[sizeof(wsServer)];
+    char savedPort[sizeof(wsPort)];
+    const size_t server_length = preferences.getString("wsServer", savedServer, sizeof(savedServer));
+    const size_t port_length = preferences.getString("wsPort", savedPort, sizeof(savedPort));
     preferences.end();
 
-    if (savedServer.length() > 0) {
-        strncpy(wsServer, savedServer.c_str(), sizeof(wsServer));
+    if (server_length > 1) {
+        text_copy(wsServer, sizeof(wsServer), savedServer);
     }
-    if (savedPort.length() > 0) {
-        strncpy(wsPort, savedPort.c_str(), sizeof(wsPort));
+    if (port_length > 1) {
+        text_copy(wsPort, sizeof(wsPort), savedPort);
     }
 }
 
 void wifi_config_task(void *pvParameters) {
     if (!wifiManager) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("WiFiManager Init Failed", 60, TFT_RED, 1);
         vTaskDelay(pdMS_TO_TICKS(2000));
         wifi_config_active = false;
@@ -53,7 +56,7 @@ void wifi_config_task(void *pvParameters) {
         return;
     }
 
-    tft.fillScreen(TFT_BLACK);
+    render_clear(TFT_BLACK);
     draw_centered_text("WiFi Config Mode", 10, TFT_WHITE, 1);
     draw_centered_text("Connect to WiFi AP:", 30, TFT_WHITE, 1);
     draw_centered_text("Resptro32-Config", 45, TFT_CYAN, 1);
@@ -80,7 +83,7 @@ void wifi_config_task(void *pvParameters) {
     try {
         connected = wifiManager->startConfigPortal("Resptro32-Config");
     } catch (...) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("Config Portal Failed", 60, TFT_RED, 1);
         vTaskDelay(pdMS_TO_TICKS(2000));
         wifi_config_active = false;
@@ -89,19 +92,20 @@ void wifi_config_task(void *pvParameters) {
     }
 
     if (connected) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("Settings Saved!", 60, TFT_GREEN, 1);
-        wifi_ip = WiFi.localIP().toString();
-        String ipText = "IP: " + wifi_ip;
-        draw_centered_text(ipText.c_str(), 80, TFT_WHITE, 1);
-        String wsText = String("WS: ") + wsServer;
-        draw_centered_text(wsText.c_str(), 100, TFT_WHITE, 1);
-        String portText = String("Port: ") + wsPort;
-        draw_centered_text(portText.c_str(), 110, TFT_WHITE, 1);
+        format_ip(&wifi_ip, WiFi.localIP());
+        Text<TEXT_LINE_MAX> line;
+        text_printf(&line, "IP: %s", wifi_ip.c_str());
+        draw_centered_text(line.c_str(), 80, TFT_WHITE, 1);
+        text_printf(&line, "WS: %s", wsServer);
+        draw_centered_text(line.c_str(), 100, TFT_WHITE, 1);
+        text_printf(&line, "Port: %s", wsPort);
+        draw_centered_text(line.c_str(), 110, TFT_WHITE, 1);
         draw_centered_text("Press A", 130, TFT_WHITE, 1);
         vTaskDelay(pdMS_TO_TICKS(2000));
     } else {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("Setup cancelled", 60, TFT_YELLOW, 1);
         draw_centered_text("Press A", 80, TFT_WHITE, 1);
         vTaskDelay(pdMS_TO_TICKS(2000));
@@ -131,12 +135,12 @@ void wifi_config_launch() {
     try {
         wifiManager = new WiFiManager();
         if (!wifiManager) {
-            tft.fillScreen(TFT_BLACK);
+            render_clear(TFT_BLACK);
             draw_centered_text("Memory allocation failed", 60, TFT_RED, 1);
             return;
         }
     } catch (...) {
-        tft.fillScreen(TFT_BLACK);
+        render_clear(TFT_BLACK);
         draw_centered_text("WiFiManager Init Failed", 60, TFT_RED, 1);
         return;
     }
@@ -163,9 +167,8 @@ void wifi_config_launch() {
 }
 
 void wifi_config_exit() {
-    tft.fillScreen(TFT_BLACK);
-    tft.setCursor(0, 0);
-    tft.println("Exiting...");
+    render_clear(TFT_BLACK);
+    render_text(0, 0, "Exiting...", TFT_WHITE, TFT_BLACK, 1);
 
     static bool exit_in_progress = false;
     if (exit_in_progress || !wifi_config_active) {
@@ -204,11 +207,7 @@ void wifi_config_exit() {
         delay(500);
     }
 
-    if (WiFi.status() == WL_CONNECTED) {
-        wifi_ip = WiFi.localIP().toString();
-    } else {
-        wifi_ip = "Not Connected";
-    }
+    get_wifi_ip();
 
     wifi_config_active = false;
     menu_requested = true;
@@ -219,16 +218,20 @@ bool wifi_is_connected() {
     return WiFi.status() == WL_CONNECTED;
 }
 
-String get_wifi_ip() {
+void format_ip(Text<TEXT_IP_MAX> *text, IPAddress ip) {
+    text_printf(text, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+const char *get_wifi_ip() {
     if (wifi_is_connected()) {
-        wifi_ip = WiFi.localIP().toString();
+        format_ip(&wifi_ip, WiFi.localIP());
     } else {
-        wifi_ip = "Not Connected";
+        text_set(&wifi_ip, "Not Connected");
     }
 
-    return wifi_ip;
+    return wifi_ip.c_str();
 }
 
-String get_ws_url() {
-    return String("ws://") + String(wsServer) + ":" + String(wsPort) + "/ws";
+void get_ws_url(Text<TEXT_URL_MAX> *url) {
+    text_printf(url, "ws://%s:%s/ws", wsServer, wsPort);
 }
@@ -7,8 +7,10 @@
 void wifi_config_launch();
 void wifi_config_exit();
 bool wifi_is_connected();
-String get_wifi_ip();
-String get_ws_url();
+// Refreshes wifi_ip and returns it
+const char *get_wifi_ip();
+void get_ws_url(Text<TEXT_URL_MAX> *url);
+void format_ip(Text<TEXT_IP_MAX> *text, IPAddress ip);
 
 extern bool wifi_config_active;
-extern String wifi_ip;
+extern Text<TEXT_IP_MAX> wifi_ip;